@@ -1374,6 +1374,13 @@ typename dcm::graph::property_map<Color, G, LocalVertex>::value_type    get(cons
     return  map.m_graph->template getProperty<Color>(key);
 };
 
+template<typename G, typename K>
+typename dcm::graph::property_map<Index, G, K>::value_type    get(const dcm::graph::property_map<Index, G, K>& map,
+            const typename dcm::graph::property_map<Index, G, K>::key_type& key)
+{
+    return  map.m_graph->template getProperty<Index>(key);
+};
+
 template<typename G>
 void    put(const dcm::graph::property_map<Group, G, LocalVertex>& map,
             const typename dcm::graph::property_map<Group, G, LocalVertex>::key_type& key,
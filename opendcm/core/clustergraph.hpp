@@ -421,7 +421,7 @@ public:
      * @param e GlobalEdge for which the containing local one is wanted
      * @return fusion::vector<LocalEdge, ClusterGraph*, bool> with the containing LocalEdge, the cluster which holds it and a bool indicator if function was successful.
      **/
-    fusion::vector<LocalEdge, ClusterGraph*, bool> getLocalEdgeGraph(GlobalEdge e);
+    fusion::vector<LocalEdge, std::shared_ptr<ClusterGraph>, bool> getLocalEdgeGraph(GlobalEdge e);
 
      /**
      * @brief Get the local vertex which holds the specified global one and the subcluster in which it is valid.
@@ -705,6 +705,7 @@ template< typename edge_prop, typename globaledge_prop, typename vertex_prop, ty
 std::pair<std::shared_ptr< ClusterGraph<edge_prop, globaledge_prop, vertex_prop, cluster_prop> >, LocalVertex> ClusterGraph<edge_prop, globaledge_prop, vertex_prop, cluster_prop>::createCluster() {
     typename Base::vertex_bundle vp;
     vp.template setProperty<VertexProperty>(m_id->generate());
+    vp.template setProperty<Type>(Cluster);
     LocalVertex v = boost::add_vertex(vp, m_graph);
     std::shared_ptr<ClusterGraph> sp = std::static_pointer_cast<ClusterGraph>(sp_base::shared_from_this());
     return std::pair<std::shared_ptr<ClusterGraph>, LocalVertex> (m_clusters[v] = std::shared_ptr<ClusterGraph> (new ClusterGraph(sp)), v);
@@ -970,7 +971,7 @@ ClusterGraph<edge_prop, globaledge_prop, vertex_prop, cluster_prop>::addEdgeGlob
 };
 
 template< typename edge_prop, typename globaledge_prop, typename vertex_prop, typename cluster_prop>
-fusion::vector<LocalEdge, ClusterGraph<edge_prop, globaledge_prop, vertex_prop, cluster_prop>*, bool>
+fusion::vector<LocalEdge, std::shared_ptr< ClusterGraph<edge_prop, globaledge_prop, vertex_prop, cluster_prop> >, bool>
 ClusterGraph<edge_prop, globaledge_prop, vertex_prop, cluster_prop>::getLocalEdgeGraph(GlobalEdge e) {
     return getContainingEdgeGraph(e);
 };
@@ -1318,7 +1319,7 @@ ClusterGraph<edge_prop, globaledge_prop, vertex_prop, cluster_prop>::getContaini
     if(isCluster(v) && (Base::getGlobalVertex(v) != id))
         return m_clusters[v]->getContainingVertexGraph(id);
     else
-        return fusion::make_vector(v, sp_base::shared_from_this(), true);
+        return fusion::make_vector(v, std::static_pointer_cast<ClusterGraph>(sp_base::shared_from_this()), true);
 };
 
 template< typename edge_prop, typename globaledge_prop, typename vertex_prop, typename cluster_prop>
@@ -25,9 +25,12 @@
 #include <boost/fusion/include/vector.hpp>
 #include <boost/fusion/include/find.hpp>
 #include <boost/fusion/include/at.hpp>
+#include <boost/fusion/include/for_each.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/exception/errinfo_errno.hpp>
 
 #include <iostream>
+#include <type_traits>
 #include "geometry.hpp"
 #include "defines.hpp"
 
@@ -158,8 +161,29 @@ struct Constraint {
     void setDefault() {
         m_storage = m_defaults;
     };
+    
+    //hash of all option values, equal options give equal hashes
+    std::size_t optionHash() const {
+        std::size_t seed = 0;
+        fusion::for_each(m_storage, OptionHasher{seed});
+        return seed;
+    };
        
 protected:
+    struct OptionHasher {
+        std::size_t& seed;
+        
+        template<typename T>
+        typename boost::enable_if<std::is_enum<T>>::type operator()(const T& val) const {
+            boost::hash_combine(seed, static_cast<typename std::underlying_type<T>::type>(val));
+        };
+        template<typename T>
+        typename boost::disable_if<std::is_enum<T>>::type operator()(const T& val) const {
+            boost::hash_combine(seed, val);
+        };
+    };
+    
+
     Options       m_storage;
     const Options m_defaults;
 };
@@ -172,6 +196,11 @@ namespace symbolic {
     
 struct Constraint {
     
+    virtual ~Constraint() {};
+    
+    //hash of the primitive constraints option values
+    virtual std::size_t optionHash() {return 0;};
+    
     int type;
 };
 
@@ -182,6 +211,10 @@ struct TypeConstraint : public Constraint {
         return m_constraint;
     };
     
+    const PrimitiveConstraint& getPrimitveConstraint() const {
+        return m_constraint;
+    };
+    
     void setPrimitiveConstraint(const PrimitiveConstraint& c) {
         //type = id;
         m_constraint = c;
@@ -191,6 +224,10 @@ struct TypeConstraint : public Constraint {
         type = id;
     }
     
+    virtual std::size_t optionHash() override {
+        return m_constraint.optionHash();
+    };
+    
 protected:   
     PrimitiveConstraint m_constraint;
 };
@@ -230,6 +267,110 @@ struct ConstraintBase : public BinaryEquation<Kernel, PG1<Kernel>, PG2<Kernel>,
         typedef PG2<Kernel>                              Geometry2;
         typedef Geometry2                                Derivative2;
 };
+
+/**
+ * @brief Base class for numeric constraints with automatic derivatives
+ * 
+ * Handwritten gradients are slow to write and easy to get wrong. A numeric constraint derived from this
+ * class provides only the error function, the gradients are calculated by forward mode automatic 
+ * differentiation with \ref Dual numbers. The error function gets the values of both geometries as fixed 
+ * size vectors in parameter order and must be generic for the scalar type:
+ * 
+ * \code{.cpp}
+ * template<typename Kernel>
+ * struct Constraint<Kernel, dcm::Distance, Point3, Point3> 
+ *      : public AutoDiffConstraint<Kernel, dcm::Distance, Point3, Point3, Constraint<Kernel, dcm::Distance, Point3, Point3>> {
+ * 
+ *      template<typename T>
+ *      T error(const Eigen::Matrix<T, 3, 1>& g1, const Eigen::Matrix<T, 3, 1>& g2) {
+ *          return (g1-g2).norm() - T(this->distance());
+ *      };
+ * };
+ * \endcode
+ * 
+ * The complete gradient of a geometry is calculated in a single pass with one lane per parameter, a 
+ * directional derivative with a single lane. Derivatives which are not finite, e.g. of a vanishing norm,
+ * are set to zero.
+ * 
+ * \tparam Derived the numeric constraint which provides the error function
+ */
+template<typename Kernel, typename PC, template<class> class PG1, template<class> class PG2, typename Derived>
+struct AutoDiffConstraint : public ConstraintBase<Kernel, PC, PG1, PG2> {
+    
+        typedef ConstraintBase<Kernel, PC, PG1, PG2>     Inherited;
+        typedef typename Kernel::Scalar                  Scalar;
+        typedef typename Inherited::Vector               Vector;
+        typedef typename Inherited::Geometry1            Geometry1;
+        typedef typename Inherited::Derivative1          Derivative1;
+        typedef typename Inherited::Geometry2            Geometry2;
+        typedef typename Inherited::Derivative2          Derivative2;
+        
+        static const int Count1 = detail::ParameterLayout<typename Geometry1::Storage>::Count;
+        static const int Count2 = detail::ParameterLayout<typename Geometry2::Storage>::Count;
+        
+        template<typename T> using Values1 = Eigen::Matrix<T, Count1, 1>;
+        template<typename T> using Values2 = Eigen::Matrix<T, Count2, 1>;
+        
+        Scalar calculateError(Geometry1& g1, Geometry2& g2) {
+            return derived().error(values(g1), values(g2));
+        };
+        
+        Scalar calculateGradientFirst(Geometry1& g1, Geometry2& g2, Derivative1& dg1) {
+            typedef Dual<Scalar, 1> D;
+            Values1<D> v1 = seed<D>(values(g1), values(dg1));
+            Values2<D> v2 = values(g2).template cast<D>();
+            return finite(derived().error(v1, v2).gradient)(0);
+        };
+
+        Scalar calculateGradientSecond(Geometry1& g1, Geometry2& g2, Derivative2& dg2) {
+            typedef Dual<Scalar, 1> D;
+            Values1<D> v1 = values(g1).template cast<D>();
+            Values2<D> v2 = seed<D>(values(g2), values(dg2));
+            return finite(derived().error(v1, v2).gradient)(0);
+        };
+
+        Vector calculateGradientFirstComplete(Geometry1& g1, Geometry2& g2) {
+            typedef Dual<Scalar, Count1> D;
+            Values1<D> v1 = seed<D>(values(g1), Eigen::Matrix<Scalar, Count1, Count1>::Identity());
+            Values2<D> v2 = values(g2).template cast<D>();
+            return finite(derived().error(v1, v2).gradient);
+        };
+
+        Vector calculateGradientSecondComplete(Geometry1& g1, Geometry2& g2) {
+            typedef Dual<Scalar, Count2> D;
+            Values1<D> v1 = values(g1).template cast<D>();
+            Values2<D> v2 = seed<D>(values(g2), Eigen::Matrix<Scalar, Count2, Count2>::Identity());
+            return finite(derived().error(v1, v2).gradient);
+        };
+        
+private:
+        Derived& derived() {return static_cast<Derived&>(*this);};
+        
+        template<typename G>
+        Eigen::Matrix<Scalar, detail::ParameterLayout<typename G::Storage>::Count, 1> values(G& g) {
+            Eigen::Matrix<Scalar, detail::ParameterLayout<typename G::Storage>::Count, 1> result;
+            detail::gatherStorage(g.storage(), result.data());
+            return result;
+        };
+        
+        //every row of the seed gives the lanes of one value
+        template<typename D, typename V, typename S>
+        Eigen::Matrix<D, V::RowsAtCompileTime, 1> seed(const V& value, const S& seed) {
+            Eigen::Matrix<D, V::RowsAtCompileTime, 1> result;
+            for(int i=0; i<value.rows(); ++i)
+                result(i) = D(value(i), seed.row(i).transpose());
+            return result;
+        };
+        
+        template<typename G>
+        G finite(G gradient) {
+            for(int i=0; i<gradient.rows(); ++i) {
+                if(!std::isfinite(gradient(i)))
+                    gradient(i) = 0;
+            }
+            return gradient;
+        };
+};
     
 /**
  * @brief Class for numeric evaluation of primitive constraints
@@ -318,6 +459,9 @@ struct Constraint : public ConstraintBase<Kernel, PC, PG1, PG2> {
         };
 };
     
+template<typename Kernel, typename PC, template<class> class PG1, template<class> class PG2, int Lanes>
+struct ConstraintBatch;
+
 /**
 * @brief Numeric handling of error functions
 * 
@@ -341,7 +485,6 @@ struct ConstraintEquationBase : public numeric::Constraint<Kernel, PC, PG1, PG2>
      
     virtual void init(LinearSystem<Kernel>& sys) {
 #ifdef DCM_DEBUG
-        dcm_assert(!m_init);
         dcm_assert(Inherited::firstInputEquation() && Inherited::firstInputEquation()->isInitialized());
         dcm_assert(Inherited::secondInputEquation() && Inherited::secondInputEquation()->isInitialized());
         m_init = true;
@@ -349,12 +492,14 @@ struct ConstraintEquationBase : public numeric::Constraint<Kernel, PC, PG1, PG2>
         //setup the residual first to see in which row we are working with this constraint
         residual = sys.mapResidual();
             
-        //Setup the correct jacobi entry for the individual parameter
+        //Setup the correct jacobi entry for the individual parameter, a previous initialisation is replaced
+        g1_derivatives.clear();
+        g2_derivatives.clear();
         for(auto& der : Inherited::firstInputEquation()->derivatives())  
-            g1_derivatives.push_back({&der.first, sys.mapJacobi(residual.Index, der.second.Index)});
+            g1_derivatives.push_back({&der.first, jacobiEntry(sys, der.second)});
     
         for(auto& der : Inherited::secondInputEquation()->derivatives())
-            g2_derivatives.push_back({&der.first, sys.mapJacobi(residual.Index, der.second.Index)});
+            g2_derivatives.push_back({&der.first, jacobiEntry(sys, der.second)});
     };
     
 #ifdef DCM_TESTING
@@ -411,8 +556,8 @@ protected:
     void secondAsComplex() {
         
         for(Derivative2Pack& der : g2_derivatives) 
-            *(der.second.Value) = Inherited::calculateGradientFirst(Inherited::firstInput(),
-                                                                    Inherited::secondInput(), *der.first);
+            *(der.second.Value) = Inherited::calculateGradientSecond(Inherited::firstInput(),
+                                                                     Inherited::secondInput(), *der.first);
     };
 
 #ifdef DCM_DEBUG
@@ -421,7 +566,20 @@ protected:
     Residual                        residual;
     std::vector<Derivative1Pack>    g1_derivatives;
     std::vector<Derivative2Pack>    g2_derivatives;
+    typename Kernel::Scalar         m_fixed;
     
+    //inputs may be fixed in this system, as their parameters belong to annother one which is solved 
+    //already. Their derivatives have no jacobi entry, they are written to a scratch value instead
+    Derivative jacobiEntry(LinearSystem<Kernel>& sys, const VectorEntry<Kernel>& parameter) {
+        if(sys.isParameter(parameter.Value))
+            return sys.mapJacobi(residual.Index, parameter.Index);
+        
+        return {residual.Index, parameter.Index, &m_fixed};
+    };
+    
+    //the batch evaluation writes the results directly into the mapped storage
+    template<typename K, typename C, template<class> class G1, template<class> class G2, int L>
+    friend struct ConstraintBatch;
 };
 
 /**
@@ -499,6 +657,168 @@ struct ConstraintComplexSimplifiedEquation : ConstraintEquationBase<Kernel, PC,
         Inherited::secondAsSimplified();
     };
 };
+/**
+ * @brief Vectorized evaluation of a primitive constraint for multiple geometry combinations at once
+ * 
+ * The batch evaluation of \ref ConstraintBatch works on structure of array buffers, every row is one
+ * constraint (a lane) and every column one parameter of the geometry in the order of its derivatives. To 
+ * enable it for a constraint and geometry combination this class needs to be specialized, the default 
+ * implementation states that no vectorized version exists, and \ref ConstraintBatch falls back to 
+ * evaluate the constraint equations one after another.
+ * 
+ * \code{.cpp}
+ * template<typename Kernel, int Lanes>
+ * struct BatchConstraint<Kernel, dcm::Distance, TPoint3, TPoint3, Lanes> {
+ *     
+ *      static const bool Vectorized = true;
+ *      typedef Eigen::Array<typename Kernel::Scalar, Lanes, 1>              Pack;
+ *      typedef Eigen::Array<typename Kernel::Scalar, Lanes, Eigen::Dynamic> Buffer;
+ * 
+ *      //collect the constraint options of the given lane. The equation is derived from the primitive 
+ *      //constraint, hence all option accessors are available
+ *      void gatherOptions(ConstraintSimplifiedEquation<Kernel, dcm::Distance, TPoint3, TPoint3>& eqn, 
+ *                         int lane) {};
+ *      //calculate the error and the complete gradients for all lanes
+ *      void calculate(const Buffer& g1, const Buffer& g2, Pack& error, Buffer& dg1, Buffer& dg2) {};
+ * }
+ * \endcode
+ * 
+ * \tparam Kernel the math kernel in use
+ * \tparam PC  the primitive constraint in use
+ * \tparam PG1 the first primitive geometry the equation is defined for
+ * \tparam PG2 the second primitive geometry the equation is defined for
+ * \tparam Lanes the amount of constraints calculated at once
+ */
+template<typename Kernel, typename PC, template<class> class PG1, template<class> class PG2, int Lanes>
+struct BatchConstraint {
+    
+    static const bool Vectorized = false;
+};
+
+/**
+ * @brief Batched evaluation of homogeneous constraint equations
+ * 
+ * Evaluating every constraint equation on its own costs a virtual call per constraint and prevents 
+ * vectorisation, as all the small calculations are done with scattered data. If many constraints of the
+ * same type act on the same geometry types this class collects them and calculates them together. The 
+ * geometry values of \a Lanes constraints are gathered into structure of array buffers, evaluated at once 
+ * by the \ref BatchConstraint specialisation and the results are scattered into the residual vector and 
+ * jacobi matrix.
+ * 
+ * Only \ref ConstraintSimplifiedEquation can be batched, as only for simple inputs the complete gradients
+ * give all derivatives. The batch takes the ownership of the added equations, hence they are initialized 
+ * and calculated only by the batch. For the flow graph the batch uses the inputs of all its equations.
+ */
+template<typename Kernel, typename PC, template<class> class PG1, template<class> class PG2, int Lanes = 4>
+struct ConstraintBatch : public Calculatable<Kernel> {
+    
+    typedef typename Kernel::Scalar                                 Scalar;
+    typedef ConstraintSimplifiedEquation<Kernel, PC, PG1, PG2>      Equation;
+    typedef BatchConstraint<Kernel, PC, PG1, PG2, Lanes>            Batch;
+    typedef Eigen::Array<Scalar, Lanes, 1>                          Pack;
+    typedef Eigen::Array<Scalar, Lanes, Eigen::Dynamic>             Buffer;
+    
+    void add(const std::shared_ptr<Equation>& eqn) {
+        m_equations.push_back(eqn);
+    };
+    
+    std::size_t size() {return m_equations.size();};
+    
+    virtual void init(LinearSystem<Kernel>& sys) {
+        
+        for(auto& eqn : m_equations)
+            eqn->init(sys);
+        
+        if(m_equations.empty())
+            return;
+        
+        //the geometries are simple, hence their parameters are the values in storage order
+        m_size1 = m_equations.front()->firstInputEquation()->parameters().size();
+        m_size2 = m_equations.front()->secondInputEquation()->parameters().size();
+        m_geometry1.resize(Lanes, m_size1);
+        m_geometry2.resize(Lanes, m_size2);
+        m_derivative1.resize(Lanes, m_size1);
+        m_derivative2.resize(Lanes, m_size2);
+        
+        //collect all gather and scatter addresses in evaluation order
+        m_values1.clear();
+        m_values2.clear();
+        m_jacobi1.clear();
+        m_jacobi2.clear();
+        m_residuals.clear();
+        for(auto& eqn : m_equations) {
+            dcm_assert(eqn->firstInputEquation()->parameters().size() == m_size1);
+            dcm_assert(eqn->secondInputEquation()->parameters().size() == m_size2);
+            
+            m_residuals.push_back(eqn->residual.Value);
+            for(auto& param : eqn->firstInputEquation()->parameters())
+                m_values1.push_back(param.Value);
+            for(auto& param : eqn->secondInputEquation()->parameters())
+                m_values2.push_back(param.Value);
+            for(auto& der : eqn->g1_derivatives)
+                m_jacobi1.push_back(der.second.Value);
+            for(auto& der : eqn->g2_derivatives)
+                m_jacobi2.push_back(der.second.Value);
+        }
+    };
+    
+    CALCULATE() {
+        calculate(std::integral_constant<bool, Batch::Vectorized>());
+    };
+    
+    virtual void collectInputs(std::vector<Calculatable<Kernel>*>& inputs) {
+        for(auto& eqn : m_equations)
+            eqn->collectInputs(inputs);
+    };
+    
+private:
+    //no vectorized version available, calculate the equations one by one. The qualified call is 
+    //dispatched statically, independent of any override in derived classes
+    void calculate(std::false_type) {
+        for(auto& eqn : m_equations)
+            eqn->Equation::calculate();
+    };
+    
+    void calculate(std::true_type) {
+        
+        const int count = m_equations.size();
+        for(int start = 0; start < count; start += Lanes) {
+            
+            //unused lanes repeat the last constraint to stay numerically valid
+            const int lanes = std::min(Lanes, count-start);
+            for(int l=0; l<Lanes; ++l) {
+                const int c = start + std::min(l, lanes-1);
+                m_batch.gatherOptions(*m_equations[c], l);
+                for(int k=0; k<m_size1; ++k)
+                    m_geometry1(l,k) = *m_values1[c*m_size1 + k];
+                for(int k=0; k<m_size2; ++k)
+                    m_geometry2(l,k) = *m_values2[c*m_size2 + k];
+            }
+            
+            m_batch.calculate(m_geometry1, m_geometry2, m_error, m_derivative1, m_derivative2);
+            
+            for(int l=0; l<lanes; ++l) {
+                const int c = start + l;
+                *m_residuals[c] = m_error(l);
+                for(int k=0; k<m_size1; ++k)
+                    *m_jacobi1[c*m_size1 + k] = m_derivative1(l,k);
+                for(int k=0; k<m_size2; ++k)
+                    *m_jacobi2[c*m_size2 + k] = m_derivative2(l,k);
+            }
+        }
+    };
+    
+    std::vector<std::shared_ptr<Equation>>  m_equations;
+    Batch                                   m_batch;
+    int                                     m_size1 = 0, m_size2 = 0;
+    std::vector<Scalar*>                    m_values1, m_values2, m_jacobi1, m_jacobi2, m_residuals;
+    Buffer                                  m_geometry1, m_geometry2, m_derivative1, m_derivative2;
+    Pack                                    m_error;
+    
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
 /*
 template<typename Kernel>
 struct ConstraintEquationGenerator {
@@ -572,7 +892,8 @@ struct Orientation : public dcm::constraint::Constraint<Orientations> {
     Orientation(){};
     Orientation(const Orientations& i) : Constraint(i) {};
     
-    Orientations& orientation() {return fusion::at_c<0>(m_storage);};
+    Orientations&       orientation() {return fusion::at_c<0>(m_storage);};
+    const Orientations& orientation() const {return fusion::at_c<0>(m_storage);};
 };
 
 struct Angle : public dcm::constraint::Constraint<double> {
@@ -0,0 +1,257 @@
+/*
+    openDCM, dimensional constraint manager
+    Copyright (C) 2016  Stefan Troeger <stefantroeger@gmx.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along
+    with this library; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef DCM_DUAL_H
+#define DCM_DUAL_H
+
+#include <cmath>
+#include <type_traits>
+#include <Eigen/Core>
+
+namespace dcm {
+namespace numeric {
+
+/**
+ * @brief Multi lane dual number for forward mode automatic differentiation
+ *
+ * A dual number carries a value and its directional derivatives for N directions at once. All arithmetic
+ * operations and elementary functions apply the chain rule to all lanes, hence evaluating a function with
+ * dual inputs gives the value and N directional derivatives in a single pass. The lanes are stored in a
+ * fixed size Eigen vector, so the derivative updates are vectorized by Eigen.
+ *
+ * Dual numbers can be used as Eigen scalar type, e.g. Eigen::Matrix<Dual<double, 4>, 3, 1>, including
+ * products, norms and mixed expressions with the underlying scalar type.
+ *
+ * \tparam Scalar The underlying floating point type
+ * \tparam N      The number of derivative lanes
+ */
+template<typename Scalar, int N>
+struct Dual {
+
+    typedef Eigen::Matrix<Scalar, N, 1> Gradient;
+
+    Scalar   value;
+    Gradient gradient;
+
+    Dual() : value(0), gradient(Gradient::Zero()) {};
+    Dual(const Scalar& v) : value(v), gradient(Gradient::Zero()) {};
+    Dual(const Scalar& v, const Gradient& g) : value(v), gradient(g) {};
+
+    Dual& operator+=(const Dual& d) {
+        value += d.value;
+        gradient += d.gradient;
+        return *this;
+    };
+
+    Dual& operator-=(const Dual& d) {
+        value -= d.value;
+        gradient -= d.gradient;
+        return *this;
+    };
+
+    Dual& operator*=(const Dual& d) {
+        gradient = gradient*d.value + value*d.gradient;
+        value *= d.value;
+        return *this;
+    };
+
+    Dual& operator/=(const Dual& d) {
+        gradient = (gradient*d.value - value*d.gradient) / (d.value*d.value);
+        value /= d.value;
+        return *this;
+    };
+
+    Dual operator-() const {
+        return Dual(-value, -gradient);
+    };
+
+    Dual operator+() const {
+        return *this;
+    };
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+template<typename S, int N> Dual<S,N> operator+(Dual<S,N> a, const Dual<S,N>& b) {return a += b;};
+template<typename S, int N> Dual<S,N> operator-(Dual<S,N> a, const Dual<S,N>& b) {return a -= b;};
+template<typename S, int N> Dual<S,N> operator*(Dual<S,N> a, const Dual<S,N>& b) {return a *= b;};
+template<typename S, int N> Dual<S,N> operator/(Dual<S,N> a, const Dual<S,N>& b) {return a /= b;};
+
+//operations with plain scalars do not need to touch the lanes of the scalar
+template<typename S, int N> Dual<S,N> operator+(Dual<S,N> a, const S& b) {a.value += b; return a;};
+template<typename S, int N> Dual<S,N> operator+(const S& a, Dual<S,N> b) {b.value += a; return b;};
+template<typename S, int N> Dual<S,N> operator-(Dual<S,N> a, const S& b) {a.value -= b; return a;};
+template<typename S, int N> Dual<S,N> operator-(const S& a, const Dual<S,N>& b) {return Dual<S,N>(a - b.value, -b.gradient);};
+template<typename S, int N> Dual<S,N> operator*(const Dual<S,N>& a, const S& b) {return Dual<S,N>(a.value*b, a.gradient*b);};
+template<typename S, int N> Dual<S,N> operator*(const S& a, const Dual<S,N>& b) {return Dual<S,N>(a*b.value, a*b.gradient);};
+template<typename S, int N> Dual<S,N> operator/(const Dual<S,N>& a, const S& b) {return Dual<S,N>(a.value/b, a.gradient/b);};
+template<typename S, int N> Dual<S,N> operator/(const S& a, const Dual<S,N>& b) {
+    return Dual<S,N>(a/b.value, (-a/(b.value*b.value))*b.gradient);
+};
+
+//comparisons only regard the value, they are needed for branches and by eigen
+template<typename S, int N> bool operator==(const Dual<S,N>& a, const Dual<S,N>& b) {return a.value == b.value;};
+template<typename S, int N> bool operator!=(const Dual<S,N>& a, const Dual<S,N>& b) {return a.value != b.value;};
+template<typename S, int N> bool operator< (const Dual<S,N>& a, const Dual<S,N>& b) {return a.value <  b.value;};
+template<typename S, int N> bool operator> (const Dual<S,N>& a, const Dual<S,N>& b) {return a.value >  b.value;};
+template<typename S, int N> bool operator<=(const Dual<S,N>& a, const Dual<S,N>& b) {return a.value <= b.value;};
+template<typename S, int N> bool operator>=(const Dual<S,N>& a, const Dual<S,N>& b) {return a.value >= b.value;};
+template<typename S, int N> bool operator< (const Dual<S,N>& a, const S& b) {return a.value <  b;};
+template<typename S, int N> bool operator> (const Dual<S,N>& a, const S& b) {return a.value >  b;};
+template<typename S, int N> bool operator< (const S& a, const Dual<S,N>& b) {return a <  b.value;};
+template<typename S, int N> bool operator> (const S& a, const Dual<S,N>& b) {return a >  b.value;};
+
+//elementary functions, found by argument dependend lookup from generic and eigen code
+template<typename S, int N> Dual<S,N> sqrt(const Dual<S,N>& d) {
+    const S s = std::sqrt(d.value);
+    return Dual<S,N>(s, d.gradient/(2*s));
+};
+
+template<typename S, int N> Dual<S,N> sin(const Dual<S,N>& d) {
+    return Dual<S,N>(std::sin(d.value), std::cos(d.value)*d.gradient);
+};
+
+template<typename S, int N> Dual<S,N> cos(const Dual<S,N>& d) {
+    return Dual<S,N>(std::cos(d.value), -std::sin(d.value)*d.gradient);
+};
+
+template<typename S, int N> Dual<S,N> tan(const Dual<S,N>& d) {
+    const S t = std::tan(d.value);
+    return Dual<S,N>(t, (1 + t*t)*d.gradient);
+};
+
+template<typename S, int N> Dual<S,N> asin(const Dual<S,N>& d) {
+    return Dual<S,N>(std::asin(d.value), d.gradient/std::sqrt(1 - d.value*d.value));
+};
+
+template<typename S, int N> Dual<S,N> acos(const Dual<S,N>& d) {
+    return Dual<S,N>(std::acos(d.value), -d.gradient/std::sqrt(1 - d.value*d.value));
+};
+
+template<typename S, int N> Dual<S,N> atan(const Dual<S,N>& d) {
+    return Dual<S,N>(std::atan(d.value), d.gradient/(1 + d.value*d.value));
+};
+
+template<typename S, int N> Dual<S,N> atan2(const Dual<S,N>& y, const Dual<S,N>& x) {
+    const S r = x.value*x.value + y.value*y.value;
+    return Dual<S,N>(std::atan2(y.value, x.value), (x.value*y.gradient - y.value*x.gradient)/r);
+};
+
+template<typename S, int N> Dual<S,N> exp(const Dual<S,N>& d) {
+    const S e = std::exp(d.value);
+    return Dual<S,N>(e, e*d.gradient);
+};
+
+template<typename S, int N> Dual<S,N> log(const Dual<S,N>& d) {
+    return Dual<S,N>(std::log(d.value), d.gradient/d.value);
+};
+
+template<typename S, int N> Dual<S,N> pow(const Dual<S,N>& d, const S& p) {
+    const S v = std::pow(d.value, p - 1);
+    return Dual<S,N>(v*d.value, (p*v)*d.gradient);
+};
+
+template<typename S, int N> Dual<S,N> abs(const Dual<S,N>& d) {
+    return d.value < 0 ? -d : d;
+};
+
+template<typename S, int N> Dual<S,N> abs2(const Dual<S,N>& d) {
+    return d*d;
+};
+
+template<typename S, int N> bool isfinite(const Dual<S,N>& d) {
+    return std::isfinite(d.value) && d.gradient.allFinite();
+};
+
+/**
+ * @brief Replace the scalar type of a scalar or Eigen matrix type
+ *
+ * Gives the type which has the same structure as \a T but uses \a D as scalar, e.g. to get the dual
+ * version of a equation input or output type.
+ */
+template<typename T, typename D>
+struct rebind_scalar {
+    typedef D type;
+};
+
+template<typename S, int R, int C, int O, int MR, int MC, typename D>
+struct rebind_scalar<Eigen::Matrix<S, R, C, O, MR, MC>, D> {
+    typedef Eigen::Matrix<D, R, C, O, MR, MC> type;
+};
+
+//uniform access to the elements of scalars and eigen matrices, used to seed and extract dual numbers
+template<typename T>
+int elementCount(const Eigen::MatrixBase<T>& m) {return m.size();};
+
+template<typename S>
+typename std::enable_if<std::is_arithmetic<S>::value, int>::type elementCount(const S&) {return 1;};
+
+template<typename S, int N>
+int elementCount(const Dual<S,N>&) {return 1;};
+
+template<typename T>
+typename Eigen::MatrixBase<T>::Scalar& element(Eigen::MatrixBase<T>& m, int i) {return m.derived().coeffRef(i);};
+
+template<typename S>
+typename std::enable_if<std::is_arithmetic<S>::value, S&>::type element(S& s, int) {return s;};
+
+template<typename S, int N>
+Dual<S,N>& element(Dual<S,N>& d, int) {return d;};
+
+} //numeric
+} //dcm
+
+namespace Eigen {
+
+template<typename S, int N>
+struct NumTraits<dcm::numeric::Dual<S, N>> : NumTraits<S> {
+
+    typedef dcm::numeric::Dual<S, N> Real;
+    typedef dcm::numeric::Dual<S, N> NonInteger;
+    typedef dcm::numeric::Dual<S, N> Nested;
+    typedef dcm::numeric::Dual<S, N> Literal;
+
+    enum {
+        IsComplex = 0,
+        IsInteger = 0,
+        IsSigned  = 1,
+        RequireInitialization = 1,
+        ReadCost = 1,
+        AddCost  = N+1,
+        MulCost  = 3*N+1
+    };
+};
+
+#if EIGEN_VERSION_AT_LEAST(3,3,0)
+//allow mixed expressions of dual and scalar matrices
+template<typename S, int N, typename BinaryOp>
+struct ScalarBinaryOpTraits<dcm::numeric::Dual<S, N>, S, BinaryOp> {
+    typedef dcm::numeric::Dual<S, N> ReturnType;
+};
+
+template<typename S, int N, typename BinaryOp>
+struct ScalarBinaryOpTraits<S, dcm::numeric::Dual<S, N>, BinaryOp> {
+    typedef dcm::numeric::Dual<S, N> ReturnType;
+};
+#endif
+
+} //Eigen
+
+#endif //DCM_DUAL_H
@@ -22,12 +22,16 @@
 
 #include <functional>
 #include <memory>
+#include <limits>
+#include <algorithm>
 
 #include <boost/mpl/if.hpp>
+#include <boost/mpl/assert.hpp>
 #include <boost/type_traits.hpp>
 
 #include "defines.hpp"
 #include "kernel.hpp"
+#include "dual.hpp"
 
 namespace dcm {
 
@@ -123,10 +127,14 @@ struct Equation : public mpl::if_<boost::is_pod<Output>, detail::PodBase<Output>
     typedef Kernel                                      KernelType;
     typedef Output                                      OutputType;
     typedef VectorEntry<Kernel>                         Parameter;
-    typedef typename std::vector<Parameter>::iterator   ParameterIterator;
     typedef Output                                      Derivative;
     typedef std::pair<Output, Parameter>                DerivativePack;
     
+    //the storage is allocated from the arena of the system the equation is initialized with
+    typedef std::vector<Parameter, ArenaAllocator<Parameter>>           ParameterVector;
+    typedef std::vector<DerivativePack, ArenaAllocator<DerivativePack>> DerivativeVector;
+    typedef typename ParameterVector::iterator                          ParameterIterator;
+    
     //set values in case this is a fixed equation
     Equation() {};
     Equation(const Output& val) : Base(val) {};
@@ -157,9 +165,9 @@ struct Equation : public mpl::if_<boost::is_pod<Output>, detail::PodBase<Output>
      * may depend on more parameters than the ones given in this vector, as it may also be dependend on other 
      * results. See \ref UnaryEquation and \ref BinaryEqaution for examples. 
      * 
-     * @return std::vector< Parameter >& vector of all mapped free parameters
+     * @return ParameterVector& vector of all mapped free parameters
      */
-    std::vector< Parameter >&      parameters() {
+    ParameterVector&  parameters() {
         return m_parameters;
     };    
     
@@ -171,9 +179,9 @@ struct Equation : public mpl::if_<boost::is_pod<Output>, detail::PodBase<Output>
      * The returned vector allows to access the parameter for which the derivative is calculated 
      * as well as the derivative itself, which is given by the same type as the result itself is. 
      * 
-     * @return std::vector< Parameter >& vector of all mapped free parameters
+     * @return DerivativeVector& vector of all derivatives
      */
-    std::vector< DerivativePack >& derivatives() {
+    DerivativeVector& derivatives() {
         return m_derivatives;
     };
     
@@ -189,6 +197,31 @@ struct Equation : public mpl::if_<boost::is_pod<Output>, detail::PodBase<Output>
      */
     Complexity getComplexity() {return m_complexity;};
     
+    /**
+     * @brief Version of the current output
+     * 
+     * Versioned equations increase the version every time their output was recalculated with changed 
+     * values. Equations using this one as input can compare the version with the one of their last 
+     * calculation and skip all work if it did not change. The output of not versioned equations must be 
+     * assumed to change on every calculation, see \ref isVersioned.
+     * 
+     * @return unsigned int the output version
+     */
+    unsigned int version() {return m_version;};
+    
+    /**
+     * @brief Returns if the equation maintains its output version
+     */
+    bool isVersioned() {return m_versioned;};
+    
+    /**
+     * @brief Force a full recalculation on the next execution
+     * 
+     * Versioned equations only recalculate if their parameters or inputs changed. If the output was 
+     * changed from outside this function ensures it is recalculated anyway.
+     */
+    void invalidate() {m_invalid = true;};
+    
 #ifdef DCM_DEBUG
     bool isInitialized() {
         return m_init;
@@ -197,9 +230,58 @@ struct Equation : public mpl::if_<boost::is_pod<Output>, detail::PodBase<Output>
     
 protected:   
     //storage of derivatives for faster calculation
-    std::vector< Parameter >            m_parameters;
-    std::vector< DerivativePack >       m_derivatives; 
+    ParameterVector                     m_parameters;
+    DerivativeVector                    m_derivatives; 
     Complexity                          m_complexity = Complexity::Fixed;
+    
+    //output versioning, the parameter values are the ones used for the last calculation
+    typedef typename Kernel::Scalar Scalar;
+    unsigned int                                    m_version = 0;
+    bool                                            m_versioned = false, m_invalid = true;
+    std::vector<Scalar, ArenaAllocator<Scalar>>     m_parameterValues;
+    
+    /**
+     * @brief Moves the storage into the arena of the system
+     * 
+     * Must be called in init before any parameter or derivative is stored. As the arena cannot reuse 
+     * memory the storage is reserved with the given sizes upfront, so that it does not grow afterwards.
+     * If the equation is initialized again with the same system the storage already in its arena is 
+     * cleared and reused, hence repeated initialisation does not grow the arena. 
+     * 
+     * @remark The arena is not thread safe, all equations of a system must be initialized by one thread
+     */
+    void allocateStorage(LinearSystem<Kernel>& k, std::size_t parameters, std::size_t derivatives) {
+        
+        if(m_parameters.get_allocator().arena() == k.arena()) {
+            m_parameters.clear();
+            m_derivatives.clear();
+            m_parameterValues.clear();
+        }
+        else {
+            m_parameters      = ParameterVector(ArenaAllocator<Parameter>(k.arena()));
+            m_derivatives     = DerivativeVector(ArenaAllocator<DerivativePack>(k.arena()));
+            m_parameterValues = std::vector<Scalar, ArenaAllocator<Scalar>>(ArenaAllocator<Scalar>(k.arena()));
+        }
+        m_parameters.reserve(parameters);
+        m_parameterValues.reserve(parameters);
+        m_derivatives.reserve(derivatives);
+    };
+    
+    //checks if any own parameter changed since the last call and stores the current values
+    bool parametersChanged() {
+        
+        bool changed = m_invalid || m_parameterValues.size() != m_parameters.size();
+        m_invalid = false;
+        m_parameterValues.resize(m_parameters.size());
+        for(std::size_t i=0; i<m_parameters.size(); ++i) {
+            if(changed || m_parameterValues[i] != *m_parameters[i].Value) {
+                changed = true;
+                m_parameterValues[i] = *m_parameters[i].Value;
+            }
+        }
+        return changed;
+    };
+    
 #ifdef DCM_DEBUG
     bool m_init = false;
 #endif
@@ -247,6 +329,15 @@ struct InputEquation : public Equation<Kernel, Output> {
     
 protected:
     bool m_ownership = false;
+    
+    //checks if the input changed since the version used in the last calculation and updates it
+    template<typename Input>
+    bool inputChanged(Equation<Kernel, Input>& input, unsigned int& used) {
+        
+        const bool changed = !input.isVersioned() || input.version() != used;
+        used = input.version();
+        return changed;
+    };
 };
 
 
@@ -301,6 +392,11 @@ struct UnaryEquation : public InputEquation<Kernel, Output> {
      */    
     std::shared_ptr<InputEqn>   inputEquation() {return m_input;};
     
+    virtual void collectInputs(std::vector<Calculatable<Kernel>*>& inputs) {
+        if(m_input)
+            inputs.push_back(m_input.get());
+    };
+    
     /**
      * @brief Set the input equation 
      * 
@@ -358,48 +454,76 @@ protected:
 };
 
 /**
- * @brief UnaryEquation basen  on expressions
+ * @brief Compile time expression of a unary calculation
  * 
- * This class is a fully defiend unary expression where all calculations are defined by Expressions. 
- * To calculate the result two expressions are needed: one for the result and one for the derivative.
- * The derivative expression is called as often as many parameter this equation depends on. 
+ * Bundles the value and derivative expressions of a unary calculation, see \ref ExpressionUnaryEquation 
+ * for their structure. Expressions can be chained at compile time with \ref compose, the resulting 
+ * expression is evaluated as a whole by a single \ref FusedUnaryEquation. 
  * 
- * An expression is an arbitrary functor object with a special syntax for calculations. The structure
- * of the expression for the function evaluation is given below as lambda example.
- * \code{.cpp}
- * [](const Input& in, Output& out) {
-*      out = 2*in*in;    
-*  },        
- * \endcode
- * The derivatives are calculates as following:
- * \code{.cpp}
- * [](const Input& in, const Input& derivative_in, Output& out) {
- *     out = 4*in*derivative_in;
- * }
- * \endcode
+ * The derivative must only be called after the value was calculated for the same input, as composed 
+ * expressions reuse intermediate values.
+ */
+template<typename Input, typename Output, typename CExp, typename DExp>
+struct UnaryExpression {
+    
+    static const int Arity = 1;
+    typedef Input  InputType;
+    typedef Output OutputType;
+    
+    UnaryExpression(const CExp& c, const DExp& d) : m_cExp(c), m_dExp(d) {};
+    
+    void value(Input& in, Output& out) {
+        m_cExp(in, out);
+    };
+    
+    void derivative(Input& in, Input& din, Output& dout) {
+        m_dExp(in, din, dout);
+    };
+    
+private:
+    CExp m_cExp;
+    DExp m_dExp;
+};
+
+template<typename Input, typename Output, typename CExp, typename DExp>
+UnaryExpression<Input, Output, CExp, DExp> makeUnaryExpression(const CExp& cexpr, const DExp& dexpr) {
+    return UnaryExpression<Input, Output, CExp, DExp>(cexpr, dexpr);
+};
+
+/**
+ * @brief UnaryEquation calculating a unary expression
  * 
- * There is no init expression supportet, hence an ExpressionUnaryEquation cannot have free parameters.
+ * The value and all derivatives of the expression are calculated within a single calculate call. If the 
+ * expression is a composition of multiple expressions all of them are inlined, hence a chain of 
+ * calculations is done without any intermediate equation, virtual call or heap allocation. The 
+ * intermediate results are stored within the expression.
  * 
- * \note The expressions passed to the constructor are copyed, hence using members by value is a bad 
- *       idea.  
+ * There is no init expression supportet, hence an FusedUnaryEquation cannot have free parameters.
  */
-template<typename Kernel, typename Input, typename Output, typename CExp, typename DExp>
-struct ExpressionUnaryEquation : public UnaryEquation<Kernel, Input, Output> {
+template<typename Kernel, typename Expression>
+struct FusedUnaryEquation : public UnaryEquation<Kernel, typename Expression::InputType, 
+                                                         typename Expression::OutputType> {
     
-    typedef UnaryEquation<Kernel, Input, Output> Base;
+    typedef typename Expression::OutputType                                Output;
+    typedef UnaryEquation<Kernel, typename Expression::InputType, Output>  Base;
     
-    ExpressionUnaryEquation(const CExp& c, const DExp& d) : m_cExp(c), m_dExp(d) {}
+    FusedUnaryEquation(const Expression& e) : m_expression(e) {
+        Base::m_versioned = true;
+    }
     
     virtual void init(LinearSystem<Kernel>& k) {
         
         dcm_assert(Base::m_input);
         if(Base::hasInputOwnership())
             Base::m_input->init(k);
+        
+        Base::invalidate();
+        Base::allocateStorage(k, 0, Base::inputEquation()->derivatives().size());
                
-        //copy over the derivative parameters. As we don't add any new parameters this is sufficient
-        Base::m_derivatives.clear();
-        for(const auto& param : Base::inputEquation()->parameters()) 
-            Base::m_derivatives.push_back(std::make_pair(Output(), param));
+        //copy over the derivative parameters, our result depends on all parameters our inputs depend on. 
+        //As we don't add any new parameters this is sufficient
+        for(const auto& der : Base::inputEquation()->derivatives()) 
+            Base::m_derivatives.push_back(std::make_pair(Output(), der.second));
     }
     
     CALCULATE() {
@@ -408,20 +532,63 @@ struct ExpressionUnaryEquation : public UnaryEquation<Kernel, Input, Output> {
         if(Base::hasInputOwnership())
             Base::m_input->execute(); 
         
-        m_cExp(Base::input(), Base::output());
+        //nothing to do if the input is the same as in the last calculation
+        if(!Base::inputChanged(*Base::m_input, m_inputVersion) && !Base::m_invalid)
+            return;
+        
+        Base::m_invalid = false;
+        ++Base::m_version;
+        m_expression.value(Base::input(), Base::output());
         
         auto& vec = Base::m_derivatives;
-        typename std::vector< typename Base::DerivativePack >::iterator it = vec.begin();
+        typename Base::DerivativeVector::iterator it = vec.begin();
         
         for(auto& der : Base::inputEquation()->derivatives()) {
-            m_dExp(Base::input(), der.first, it->first);
+            m_expression.derivative(Base::input(), der.first, it->first);
             ++it;
         }
     };
     
+    Expression& expression() {return m_expression;};
+    
 private:
-    CExp m_cExp;
-    DExp m_dExp;
+    Expression   m_expression;
+    unsigned int m_inputVersion = 0;
+};
+
+/**
+ * @brief UnaryEquation basen  on expressions
+ * 
+ * This class is a fully defiend unary expression where all calculations are defined by Expressions. 
+ * To calculate the result two expressions are needed: one for the result and one for the derivative.
+ * The derivative expression is called as often as many parameter this equation depends on. 
+ * 
+ * An expression is an arbitrary functor object with a special syntax for calculations. The structure
+ * of the expression for the function evaluation is given below as lambda example.
+ * \code{.cpp}
+ * [](const Input& in, Output& out) {
+*      out = 2*in*in;    
+*  },        
+ * \endcode
+ * The derivatives are calculates as following:
+ * \code{.cpp}
+ * [](const Input& in, const Input& derivative_in, Output& out) {
+ *     out = 4*in*derivative_in;
+ * }
+ * \endcode
+ * 
+ * There is no init expression supportet, hence an ExpressionUnaryEquation cannot have free parameters.
+ * 
+ * \note The expressions passed to the constructor are copyed, hence using members by value is a bad 
+ *       idea.  
+ */
+template<typename Kernel, typename Input, typename Output, typename CExp, typename DExp>
+struct ExpressionUnaryEquation : public FusedUnaryEquation<Kernel, UnaryExpression<Input, Output, CExp, DExp>> {
+    
+    typedef FusedUnaryEquation<Kernel, UnaryExpression<Input, Output, CExp, DExp>> Base;
+    
+    ExpressionUnaryEquation(const CExp& c, const DExp& d) 
+        : Base(UnaryExpression<Input, Output, CExp, DExp>(c, d)) {};
 };
 
 /**
@@ -544,6 +711,13 @@ struct BinaryEquation : public InputEquation<Kernel, Output> {
      */ 
     std::shared_ptr<Input2Eqn>  secondInputEquation() {return m_input2;};
     
+    virtual void collectInputs(std::vector<Calculatable<Kernel>*>& inputs) {
+        if(m_input1)
+            inputs.push_back(m_input1.get());
+        if(m_input2)
+            inputs.push_back(m_input2.get());
+    };
+    
     /**
      * @brief Set the first input equation 
      * 
@@ -623,42 +797,68 @@ protected:
 };
 
 /**
- * @brief BinaryEquation basen on expressions
+ * @brief Compile time expression of a binary calculation
  * 
- * This class is a fully defiend binary equation where all calculations are defined by expressions. 
- * To calculate the result three expressions are needed: one for the result and one for each input 
- * derivative. The derivative expressiona are called as often as many parameter this equation depends on. 
+ * Bundles the value and both derivative expressions of a binary calculation, see 
+ * \ref ExpressionBinaryEquation for their structure. Unary expressions can be appended at compile time 
+ * with \ref compose, the result is evaluated as a whole by a single \ref FusedBinaryEquation. 
  * 
- * An expression is an arbitrary functor object with a special syntax for calculations. The structure
- * of the expression for the function evaluation is given below as lambda example.
- * \code{.cpp}
- * [](const Input& in1, const Input2& in2, Output& out) {
-*      out = 2*in1*in2;    
-*  },        
- * \endcode
- * The two derivative expressions are calculates as following:
- * \code{.cpp}
- * [](const Input1& in1, const Input2& in2, const Input1& derivative_in1, Output& out) {
- *     out = 2*derivative_in1*in2;
- * }
- * [](const Input1& in1, const Input2& in2, const Input2& derivative_in2, Output& out) {
- *     out = 2*in1*derivative_in2;
- * }
- * \endcode
+ * The derivatives must only be called after the value was calculated for the same inputs, as composed 
+ * expressions reuse intermediate values.
+ */
+template<typename Input1, typename Input2, typename Output, typename CExp, typename DExp1, typename DExp2>
+struct BinaryExpression {
+    
+    static const int Arity = 2;
+    typedef Input1 InputType1;
+    typedef Input2 InputType2;
+    typedef Output OutputType;
+    
+    BinaryExpression(const CExp& c, const DExp1& d1, const DExp2& d2) : m_cExp(c), m_dExp1(d1), m_dExp2(d2) {};
+    
+    void value(Input1& in1, Input2& in2, Output& out) {
+        m_cExp(in1, in2, out);
+    };
+    
+    void firstDerivative(Input1& in1, Input2& in2, Input1& din1, Output& dout) {
+        m_dExp1(in1, in2, din1, dout);
+    };
+    
+    void secondDerivative(Input1& in1, Input2& in2, Input2& din2, Output& dout) {
+        m_dExp2(in1, in2, din2, dout);
+    };
+    
+private:
+    CExp  m_cExp;
+    DExp1 m_dExp1;
+    DExp2 m_dExp2;
+};
+
+template<typename Input1, typename Input2, typename Output, typename CExp, typename DExp1, typename DExp2>
+BinaryExpression<Input1, Input2, Output, CExp, DExp1, DExp2> 
+makeBinaryExpression(const CExp& cexpr, const DExp1& dexpr1, const DExp2& dexpr2) {
+    return BinaryExpression<Input1, Input2, Output, CExp, DExp1, DExp2>(cexpr, dexpr1, dexpr2);
+};
+
+/**
+ * @brief BinaryEquation calculating a binary expression
  * 
- * There is no init expression supportet, hence an ExpressionBinaryEquation cannot have free parameters.
+ * The binary equivalent of \ref FusedUnaryEquation: the value and all derivatives of the expression, 
+ * including all unary expressions composed to it, are calculated within a single calculate call.
  * 
- * \note The expressions passed to the constructor are copyed, hence using members by value is a bad 
- *       idea.  
+ * There is no init expression supportet, hence an FusedBinaryEquation cannot have free parameters.
  */
-template<typename Kernel, typename Input1, typename Input2, typename Output, 
-         typename CExp, typename DExp1, typename DExp2>
-struct ExpressionBinaryEquation : public BinaryEquation<Kernel, Input1, Input2, Output> {
+template<typename Kernel, typename Expression>
+struct FusedBinaryEquation : public BinaryEquation<Kernel, typename Expression::InputType1, 
+                                                   typename Expression::InputType2, 
+                                                   typename Expression::OutputType> {
     
-    typedef BinaryEquation<Kernel, Input1, Input2, Output> Base;
+    typedef typename Expression::OutputType Output;
+    typedef BinaryEquation<Kernel, typename Expression::InputType1, typename Expression::InputType2, Output> Base;
     
-    ExpressionBinaryEquation(const CExp& c, const DExp1& d1, const DExp2& d2) 
-        : m_cExp(c), m_dExp1(d1), m_dExp2(d2) {}
+    FusedBinaryEquation(const Expression& e) : m_expression(e) {
+        Base::m_versioned = true;
+    }
     
     virtual void init(LinearSystem<Kernel>& k) {
         
@@ -668,17 +868,20 @@ struct ExpressionBinaryEquation : public BinaryEquation<Kernel, Input1, Input2,
             Base::firstInputEquation()->init(k);
             Base::secondInputEquation()->init(k);
         }
+        
+        Base::invalidate();
 
         //we add no own parameters
-        Base::m_parameters.clear();
+        Base::allocateStorage(k, 0, Base::firstInputEquation()->derivatives().size() + 
+                                    Base::secondInputEquation()->derivatives().size());
         
-        //copy over the derivative parameters. As we don't add any new parameters this is sufficient
-        Base::m_derivatives.clear();
-        for(const auto& param : Base::firstInputEquation()->parameters()) 
-            Base::m_derivatives.push_back(std::make_pair(Output(), param));
+        //copy over the derivative parameters, our result depends on all parameters our inputs depend on. 
+        //As we don't add any new parameters this is sufficient
+        for(const auto& der : Base::firstInputEquation()->derivatives()) 
+            Base::m_derivatives.push_back(std::make_pair(Output(), der.second));
         
-        for(const auto& param : Base::secondInputEquation()->parameters()) 
-            Base::m_derivatives.push_back(std::make_pair(Output(), param));
+        for(const auto& der : Base::secondInputEquation()->derivatives()) 
+            Base::m_derivatives.push_back(std::make_pair(Output(), der.second));
     }
     
     CALCULATE() {
@@ -690,27 +893,76 @@ struct ExpressionBinaryEquation : public BinaryEquation<Kernel, Input1, Input2,
             Base::m_input2->execute(); 
         }
         
-        m_cExp(Base::firstInput(), Base::secondInput(), Base::output());
+        //both versions need to be updated, hence no short circuit evaluation
+        const bool changed1 = Base::inputChanged(*Base::m_input1, m_input1Version);
+        const bool changed2 = Base::inputChanged(*Base::m_input2, m_input2Version);
+        if(!changed1 && !changed2 && !Base::m_invalid)
+            return;
+        
+        Base::m_invalid = false;
+        ++Base::m_version;
+        m_expression.value(Base::firstInput(), Base::secondInput(), Base::output());
         
         auto& vec = Base::m_derivatives;
-        typename std::vector< typename Base::DerivativePack >::iterator it = vec.begin();
+        typename Base::DerivativeVector::iterator it = vec.begin();
         
         for(auto& der : Base::firstInputEquation()->derivatives()) {
-            m_dExp1(Base::firstInput(), Base::secondInput(), der.first, it->first);
+            m_expression.firstDerivative(Base::firstInput(), Base::secondInput(), der.first, it->first);
             ++it;
         }
         for(auto& der : Base::secondInputEquation()->derivatives()) {
-            m_dExp2(Base::firstInput(), Base::secondInput(), der.first, it->first);
+            m_expression.secondDerivative(Base::firstInput(), Base::secondInput(), der.first, it->first);
             ++it;
         }
     };
     
+    Expression& expression() {return m_expression;};
+    
 private:
-    CExp  m_cExp;
-    DExp1 m_dExp1;
-    DExp2 m_dExp2;
+    Expression   m_expression;
+    unsigned int m_input1Version = 0, m_input2Version = 0;
 };
 
+/**
+ * @brief BinaryEquation basen on expressions
+ * 
+ * This class is a fully defiend binary equation where all calculations are defined by expressions. 
+ * To calculate the result three expressions are needed: one for the result and one for each input 
+ * derivative. The derivative expressiona are called as often as many parameter this equation depends on. 
+ * 
+ * An expression is an arbitrary functor object with a special syntax for calculations. The structure
+ * of the expression for the function evaluation is given below as lambda example.
+ * \code{.cpp}
+ * [](const Input& in1, const Input2& in2, Output& out) {
+*      out = 2*in1*in2;    
+*  },        
+ * \endcode
+ * The two derivative expressions are calculates as following:
+ * \code{.cpp}
+ * [](const Input1& in1, const Input2& in2, const Input1& derivative_in1, Output& out) {
+ *     out = 2*derivative_in1*in2;
+ * }
+ * [](const Input1& in1, const Input2& in2, const Input2& derivative_in2, Output& out) {
+ *     out = 2*in1*derivative_in2;
+ * }
+ * \endcode
+ * 
+ * There is no init expression supportet, hence an ExpressionBinaryEquation cannot have free parameters.
+ * 
+ * \note The expressions passed to the constructor are copyed, hence using members by value is a bad 
+ *       idea.  
+ */
+template<typename Kernel, typename Input1, typename Input2, typename Output, 
+         typename CExp, typename DExp1, typename DExp2>
+struct ExpressionBinaryEquation 
+    : public FusedBinaryEquation<Kernel, BinaryExpression<Input1, Input2, Output, CExp, DExp1, DExp2>> {
+    
+    typedef BinaryExpression<Input1, Input2, Output, CExp, DExp1, DExp2> Expression;
+    typedef FusedBinaryEquation<Kernel, Expression>                       Base;
+    
+    ExpressionBinaryEquation(const CExp& c, const DExp1& d1, const DExp2& d2) 
+        : Base(Expression(c, d1, d2)) {}
+};
 
 /**
  * @brief Creates a BinaryEquation from expressions
@@ -763,6 +1015,399 @@ std::shared_ptr<BinaryEquation<Kernel, Input1, Input2, Output>> makeBinaryEquati
     return ptr;
 }
 
+/**
+ * @brief Composition of two expressions at compile time
+ * 
+ * The output of the first expression is used as input for the second one, which must be a unary expression.
+ * The intermediate value and derivative are stored inside the composition, no allocation happens when 
+ * evaluating it. The chain rule is applied for the derivatives: the derivative of the first expression is 
+ * calculated and directly passed to the derivative of the second one. The composition is a expression 
+ * itself with the arity of the first expression.
+ */
+template<typename First, typename Second, int Arity = First::Arity>
+struct ComposedExpression;
+
+template<typename First, typename Second>
+struct ComposedExpression<First, Second, 1> {
+    
+    BOOST_MPL_ASSERT((boost::is_same<typename First::OutputType, typename Second::InputType>));
+    
+    static const int Arity = 1;
+    typedef typename First::InputType   InputType;
+    typedef typename Second::OutputType OutputType;
+    typedef typename First::OutputType  Intermediate;
+    
+    ComposedExpression(const First& f, const Second& s) : m_first(f), m_second(s) {};
+    
+    void value(InputType& in, OutputType& out) {
+        m_first.value(in, m_value);
+        m_second.value(m_value, out);
+    };
+    
+    void derivative(InputType& in, InputType& din, OutputType& dout) {
+        m_first.derivative(in, din, m_derivative);
+        m_second.derivative(m_value, m_derivative, dout);
+    };
+    
+private:
+    First        m_first;
+    Second       m_second;
+    Intermediate m_value, m_derivative;
+};
+
+template<typename First, typename Second>
+struct ComposedExpression<First, Second, 2> {
+    
+    BOOST_MPL_ASSERT((boost::is_same<typename First::OutputType, typename Second::InputType>));
+    
+    static const int Arity = 2;
+    typedef typename First::InputType1  InputType1;
+    typedef typename First::InputType2  InputType2;
+    typedef typename Second::OutputType OutputType;
+    typedef typename First::OutputType  Intermediate;
+    
+    ComposedExpression(const First& f, const Second& s) : m_first(f), m_second(s) {};
+    
+    void value(InputType1& in1, InputType2& in2, OutputType& out) {
+        m_first.value(in1, in2, m_value);
+        m_second.value(m_value, out);
+    };
+    
+    void firstDerivative(InputType1& in1, InputType2& in2, InputType1& din1, OutputType& dout) {
+        m_first.firstDerivative(in1, in2, din1, m_derivative);
+        m_second.derivative(m_value, m_derivative, dout);
+    };
+    
+    void secondDerivative(InputType1& in1, InputType2& in2, InputType2& din2, OutputType& dout) {
+        m_first.secondDerivative(in1, in2, din2, m_derivative);
+        m_second.derivative(m_value, m_derivative, dout);
+    };
+    
+private:
+    First        m_first;
+    Second       m_second;
+    Intermediate m_value, m_derivative;
+};
+
+template<typename First, typename... Rest>
+struct composed_type {
+    typedef First type;
+};
+
+template<typename First, typename Second, typename... Rest>
+struct composed_type<First, Second, Rest...> {
+    typedef typename composed_type<ComposedExpression<First, Second>, Rest...>::type type;
+};
+
+/**
+ * @brief Chain any number of expressions
+ * 
+ * The expressions are applied from left to right, only the first one may be a binary expression. 
+ * \code{.cpp}
+ * auto norm = numeric::compose(
+ *     numeric::makeUnaryExpression<Eigen::Vector3d, Eigen::Vector3d>(scale, dscale),
+ *     numeric::makeUnaryExpression<Eigen::Vector3d, double>(norm, dnorm)
+ * );
+ * auto eqn = numeric::makeFusedEquation<K>(geometry, norm);
+ * \endcode
+ */
+template<typename Last>
+Last compose(const Last& last) {
+    return last;
+};
+
+template<typename First, typename Second, typename... Rest>
+typename composed_type<First, Second, Rest...>::type 
+compose(const First& first, const Second& second, const Rest&... rest) {
+    return compose(ComposedExpression<First, Second>(first, second), rest...);
+};
+
+/**
+ * @brief Creates the equation calculating the given unary expression 
+ */
+template<typename Kernel, typename Expression>
+std::shared_ptr<UnaryEquation<Kernel, typename Expression::InputType, typename Expression::OutputType>> 
+makeFusedEquation(const Expression& expression) {
+    
+    typedef UnaryEquation<Kernel, typename Expression::InputType, typename Expression::OutputType> Eqn;
+    return std::shared_ptr<Eqn>(new FusedUnaryEquation<Kernel, Expression>(expression));
+};
+
+/**
+ * @brief Creates the equation calculating the given binary expression 
+ */
+template<typename Kernel, typename Expression>
+std::shared_ptr<BinaryEquation<Kernel, typename Expression::InputType1, typename Expression::InputType2, 
+                               typename Expression::OutputType>> 
+makeFusedEquation(const Expression& expression) {
+    
+    typedef BinaryEquation<Kernel, typename Expression::InputType1, typename Expression::InputType2, 
+                           typename Expression::OutputType> Eqn;
+    return std::shared_ptr<Eqn>(new FusedBinaryEquation<Kernel, Expression>(expression));
+};
+
+/**
+ * @brief Creates the equation calculating the unary expression and prepends the given input
+ */
+template<typename Kernel, typename Expression>
+std::shared_ptr<UnaryEquation<Kernel, typename Expression::InputType, typename Expression::OutputType>> 
+makeFusedEquation(std::shared_ptr<Equation<Kernel, typename Expression::InputType>> eqn, 
+                  const Expression& expression) {
+    
+    auto ptr = makeFusedEquation<Kernel>(expression);
+    ptr->prepend(eqn);
+    return ptr;
+};
+
+/**
+ * @brief Creates the equation calculating the binary expression and prepends the given inputs
+ */
+template<typename Kernel, typename Expression>
+std::shared_ptr<BinaryEquation<Kernel, typename Expression::InputType1, typename Expression::InputType2, 
+                               typename Expression::OutputType>> 
+makeFusedEquation(std::shared_ptr<Equation<Kernel, typename Expression::InputType1>> eqn1, 
+                  std::shared_ptr<Equation<Kernel, typename Expression::InputType2>> eqn2, 
+                  const Expression& expression) {
+    
+    auto ptr = makeFusedEquation<Kernel>(expression);
+    ptr->prepend(eqn1, eqn2);
+    return ptr;
+};
+
+/**
+ * @brief UnaryEquation with automatic derivative calculation
+ * 
+ * Instead of a extra derivative expression only the value calculation is required, the derivatives are 
+ * calculated by forward mode automatic differentiation. For this the calculation is executed with 
+ * \ref Dual numbers which carry the derivatives for \a Lanes parameters at once, hence one evaluation 
+ * of the functor gives the value and the derivatives for up to \a Lanes parameters. Compared to a 
+ * derivative expression which is called once per parameter this also allows vectorisation of the 
+ * derivative calculation.
+ * 
+ * The functor is called with the dual versions of input and output type, see \ref rebind_scalar, hence 
+ * it must be generic for the scalar type. Input and output must be scalars or eigen matrices.
+ * \code{.cpp}
+ * struct Norm {
+ *     template<typename Vector, typename Scalar>
+ *     void operator()(const Vector& in, Scalar& out) const {
+ *         out = in.norm();
+ *     };
+ * };
+ * \endcode
+ * 
+ * There is no init expression supportet, hence an AutoDiffUnaryEquation cannot have free parameters.
+ */
+template<typename Kernel, typename Input, typename Output, typename Functor, int Lanes = 4>
+struct AutoDiffUnaryEquation : public UnaryEquation<Kernel, Input, Output> {
+    
+    typedef UnaryEquation<Kernel, Input, Output>                    Base;
+    typedef Dual<typename Kernel::Scalar, Lanes>                    DualScalar;
+    typedef typename rebind_scalar<Input, DualScalar>::type         DualInput;
+    typedef typename rebind_scalar<Output, DualScalar>::type        DualOutput;
+    
+    AutoDiffUnaryEquation(const Functor& f) : m_functor(f) {
+        Base::m_versioned = true;
+    }
+    
+    virtual void init(LinearSystem<Kernel>& k) {
+        
+        dcm_assert(Base::m_input);
+        if(Base::hasInputOwnership())
+            Base::m_input->init(k);
+        
+        Base::invalidate();
+        Base::allocateStorage(k, 0, Base::inputEquation()->derivatives().size());
+               
+        //copy over the derivative parameters, our result depends on all parameters our inputs depend on. 
+        //As we don't add any new parameters this is sufficient
+        for(const auto& der : Base::inputEquation()->derivatives()) 
+            Base::m_derivatives.push_back(std::make_pair(Output(), der.second));
+    }
+    
+    CALCULATE() {
+        
+        dcm_assert(Base::m_input);        
+        if(Base::hasInputOwnership())
+            Base::m_input->execute(); 
+        
+        //nothing to do if the input is the same as in the last calculation
+        if(!Base::inputChanged(*Base::m_input, m_inputVersion) && !Base::m_invalid)
+            return;
+        
+        Base::m_invalid = false;
+        ++Base::m_version;
+        
+        auto& derivatives = Base::inputEquation()->derivatives();
+        const int count = derivatives.size();
+        const int inputs = elementCount(Base::input());
+        const int outputs = elementCount(Base::output());
+        for(int e=0; e<inputs; ++e)
+            element(m_input, e).value = element(Base::input(), e);
+        
+        //process the derivatives in chunks of lane size, at least once to get the value
+        int start = 0;
+        do {
+            const int lanes = std::min(Lanes, count-start);
+            for(int e=0; e<inputs; ++e) {
+                auto& gradient = element(m_input, e).gradient;
+                for(int l=0; l<lanes; ++l)
+                    gradient(l) = element(derivatives[start+l].first, e);
+                gradient.tail(Lanes-lanes).setZero();
+            }
+            
+            m_functor(m_input, m_output);
+            
+            for(int e=0; e<outputs; ++e) {
+                const DualScalar& result = element(m_output, e);
+                element(Base::output(), e) = result.value;
+                for(int l=0; l<lanes; ++l)
+                    element(Base::m_derivatives[start+l].first, e) = result.gradient(l);
+            }
+            start += Lanes;
+        }
+        while(start < count);
+    };
+    
+private:
+    Functor      m_functor;
+    DualInput    m_input;
+    DualOutput   m_output;
+    unsigned int m_inputVersion = 0;
+    
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+ * @brief BinaryEquation with automatic derivative calculation
+ * 
+ * The binary equivalent of \ref AutoDiffUnaryEquation. The derivatives for the parameters of both inputs
+ * are distributed over the lanes together, the functor is called with the dual versions of both inputs 
+ * and the output.
+ */
+template<typename Kernel, typename Input1, typename Input2, typename Output, typename Functor, int Lanes = 4>
+struct AutoDiffBinaryEquation : public BinaryEquation<Kernel, Input1, Input2, Output> {
+    
+    typedef BinaryEquation<Kernel, Input1, Input2, Output>          Base;
+    typedef Dual<typename Kernel::Scalar, Lanes>                    DualScalar;
+    typedef typename rebind_scalar<Input1, DualScalar>::type        DualInput1;
+    typedef typename rebind_scalar<Input2, DualScalar>::type        DualInput2;
+    typedef typename rebind_scalar<Output, DualScalar>::type        DualOutput;
+    
+    AutoDiffBinaryEquation(const Functor& f) : m_functor(f) {
+        Base::m_versioned = true;
+    }
+    
+    virtual void init(LinearSystem<Kernel>& k) {
+        
+        dcm_assert(Base::m_input1);
+        dcm_assert(Base::m_input2);
+        if(Base::hasInputOwnership()) {
+            Base::firstInputEquation()->init(k);
+            Base::secondInputEquation()->init(k);
+        }
+        
+        Base::invalidate();
+        Base::allocateStorage(k, 0, Base::firstInputEquation()->derivatives().size() + 
+                                    Base::secondInputEquation()->derivatives().size());
+        
+        for(const auto& der : Base::firstInputEquation()->derivatives()) 
+            Base::m_derivatives.push_back(std::make_pair(Output(), der.second));
+        
+        for(const auto& der : Base::secondInputEquation()->derivatives()) 
+            Base::m_derivatives.push_back(std::make_pair(Output(), der.second));
+    }
+    
+    CALCULATE() {
+        
+        dcm_assert(Base::m_input2);        
+        dcm_assert(Base::m_input1); 
+        if(Base::hasInputOwnership())  {
+            Base::m_input1->execute(); 
+            Base::m_input2->execute(); 
+        }
+        
+        //both versions need to be updated, hence no short circuit evaluation
+        const bool changed1 = Base::inputChanged(*Base::m_input1, m_input1Version);
+        const bool changed2 = Base::inputChanged(*Base::m_input2, m_input2Version);
+        if(!changed1 && !changed2 && !Base::m_invalid)
+            return;
+        
+        Base::m_invalid = false;
+        ++Base::m_version;
+        
+        auto& derivatives1 = Base::firstInputEquation()->derivatives();
+        auto& derivatives2 = Base::secondInputEquation()->derivatives();
+        const int count1 = derivatives1.size();
+        const int count  = count1 + derivatives2.size();
+        const int inputs1 = elementCount(Base::firstInput());
+        const int inputs2 = elementCount(Base::secondInput());
+        const int outputs = elementCount(Base::output());
+        for(int e=0; e<inputs1; ++e)
+            element(m_input1, e).value = element(Base::firstInput(), e);
+        for(int e=0; e<inputs2; ++e)
+            element(m_input2, e).value = element(Base::secondInput(), e);
+        
+        //the lanes are distributed over the derivatives of the first and then the second input
+        int start = 0;
+        do {
+            const int lanes = std::min(Lanes, count-start);
+            for(int e=0; e<inputs1; ++e) {
+                auto& gradient = element(m_input1, e).gradient;
+                gradient.setZero();
+                for(int l=0; l<lanes && start+l < count1; ++l)
+                    gradient(l) = element(derivatives1[start+l].first, e);
+            }
+            for(int e=0; e<inputs2; ++e) {
+                auto& gradient = element(m_input2, e).gradient;
+                gradient.setZero();
+                for(int l=std::max(0, count1-start); l<lanes; ++l)
+                    gradient(l) = element(derivatives2[start+l-count1].first, e);
+            }
+            
+            m_functor(m_input1, m_input2, m_output);
+            
+            for(int e=0; e<outputs; ++e) {
+                const DualScalar& result = element(m_output, e);
+                element(Base::output(), e) = result.value;
+                for(int l=0; l<lanes; ++l)
+                    element(Base::m_derivatives[start+l].first, e) = result.gradient(l);
+            }
+            start += Lanes;
+        }
+        while(start < count);
+    };
+    
+private:
+    Functor      m_functor;
+    DualInput1   m_input1;
+    DualInput2   m_input2;
+    DualOutput   m_output;
+    unsigned int m_input1Version = 0, m_input2Version = 0;
+    
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+ * @brief Creates a UnaryEquation with automatic derivatives from the value functor
+ */
+template<typename Kernel, typename Input, typename Output, int Lanes = 4, typename Functor>
+std::shared_ptr<UnaryEquation<Kernel, Input, Output>> makeAutoDiffUnaryEquation(const Functor& functor) {
+    
+    auto ptr = new AutoDiffUnaryEquation<Kernel, Input, Output, Functor, Lanes>(functor);
+    return std::shared_ptr<UnaryEquation<Kernel, Input, Output>>(ptr);
+};
+
+/**
+ * @brief Creates a BinaryEquation with automatic derivatives from the value functor
+ */
+template<typename Kernel, typename Input1, typename Input2, typename Output, int Lanes = 4, typename Functor>
+std::shared_ptr<BinaryEquation<Kernel, Input1, Input2, Output>> makeAutoDiffBinaryEquation(const Functor& functor) {
+    
+    auto ptr = new AutoDiffBinaryEquation<Kernel, Input1, Input2, Output, Functor, Lanes>(functor);
+    return std::shared_ptr<BinaryEquation<Kernel, Input1, Input2, Output>>(ptr);
+};
 
 } //numeric    
 } //dcm
@@ -22,6 +22,7 @@
 #define DCM_GEOMETRY_H
 
 #include <vector>
+#include <type_traits>
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -29,6 +30,9 @@
 #include <boost/mpl/bool.hpp>
 #include <boost/mpl/vector.hpp>
 #include <boost/mpl/range_c.hpp>
+#include <boost/mpl/int.hpp>
+#include <boost/mpl/at.hpp>
+#include <boost/mpl/size.hpp>
 #include <boost/mpl/for_each.hpp>
 #include <boost/fusion/include/vector.hpp>
 #include <boost/fusion/include/make_vector.hpp>
@@ -38,6 +42,7 @@
 
 #include "kernel.hpp"
 #include "equations.hpp"
+#include "mapdatatype.hpp"
 #include "transformation.hpp"
 
 #ifdef DCM_DEBUG
@@ -134,6 +139,9 @@ struct Geometry {
     typedef mpl::vector< StorageTypes... >                               StorageSequence;
     typedef typename fusion::result_of::as_vector<StorageSequence>::type Storage;
     
+    //access all values at once, e.g. to handle them in parameter order
+    Storage& storage() {return m_storage;};
+    
 protected:
     Storage m_storage;
 };
@@ -157,121 +165,280 @@ struct extractor<Base<Kernel>> {
     template<typename K> using  primitive = Base<K>;
 };
 
+/**
+ * @brief Adaptor to handle a primitive geometry template as normal type
+ * 
+ * Primitive geometries are templates on the \ref Kernel, which is only known inside the system. To name 
+ * a primitive without the kernel, for example in the geometry traits of a user type, it is wrapped into 
+ * this adaptor. The primitive is accessible the same way as with \ref extractor.
+ * 
+ * \param Base the primitive geometry which should be wrapped
+ */
+template<template<class> class Base>
+struct adaptor {
+    
+    template<typename K> using  primitive = Base<K>;
+};
+
 }//geometry
 
 namespace detail {
-//helper classes for numeric geometry
-template<typename Kernel, typename StorageType, typename Equation, bool InitDerivative = true>
-struct Initializer {
-
-    typedef typename Kernel::Scalar Scalar;
     
-    numeric::LinearSystem<Kernel>&                  m_system;
-    std::vector<typename Equation::Parameter>&      m_entries;
-    std::vector<typename Equation::DerivativePack>& m_derivatives;
-    StorageType&                                    m_storage;
+//number of parameters a storage entry occupies, known at compile time for all fixed size storages
+template<typename T, bool = std::is_arithmetic<T>::value>
+struct storage_size : mpl::int_<1> {};
 
-    Initializer(numeric::LinearSystem<Kernel>& s, StorageType& st, std::vector<typename Equation::Parameter>& vec,
-                std::vector<typename Equation::DerivativePack>& der) : m_system(s), m_entries(vec),
-        m_derivatives(der), m_storage(st) {};
-
-    template<typename T>
-    void operator()(T t) {
+template<typename T>
+struct storage_size<T, false> : mpl::int_<T::SizeAtCompileTime> {
+    static_assert(T::SizeAtCompileTime != Eigen::Dynamic, "Dynamic size storage is not supported");
+};
 
-        //get the parameter
-        auto& t1 = fusion::at<T>(m_storage);
-        std::vector<typename Equation::Parameter> v = map(t1);
+template<typename T>
+struct storage_size<T*, false> : storage_size<T> {};
 
-        //create and set derivatives
-        for(int i=0; i<v.size(); ++i) {
-            m_derivatives.emplace_back(typename Equation::DerivativePack(typename Equation::OutputType(),  v[i]));
-            
-            if(InitDerivative) {
-                auto& t2 = fusion::at<T>(m_derivatives.back().first.m_storage);
-                setOne(t2, i);
-            }
-        };
+//offset of the storage entry I in the parameter block of the storage sequence
+template<typename Sequence, int I>
+struct storage_offset : mpl::int_<storage_offset<Sequence, I-1>::value + 
+                                  storage_size<typename mpl::at_c<Sequence, I-1>::type>::value> {};
+                                  
+template<typename Sequence>
+struct storage_offset<Sequence, 0> : mpl::int_<0> {};
 
-        //set parameters
-        std::move(v.begin(), v.end(), std::back_inserter(m_entries));
-    }
+/**
+ * @brief Compile time parameter layout of a geometry storage
+ * 
+ * All entries of the storage are mapped as one contiguous block of parameters into the linear system. 
+ * The layout gives the size of this block and the offset of every storage entry inside of it.
+ */
+template<typename Sequence>
+struct ParameterLayout {
+    
+    static constexpr int Count = storage_offset<Sequence, mpl::size<Sequence>::value>::value;
+    
+    template<int I>
+    using offset = storage_offset<Sequence, I>;
+    
+    template<int I>
+    using size = storage_size<typename mpl::at_c<Sequence, I>::type>;
+};
 
-    template<typename T>
-    void setOne(Eigen::MatrixBase<T>& m, int n) {
-        m(n) = 1;
+/**
+ * @brief Contiguous parameter block of a numeric geometry
+ * 
+ * Holds the address of the parameters mapped for a storage sequence and copies them into the storage
+ * with fixed size maps at the compile time offsets. Storage entries which are \ref details::MapMatrix 
+ * are redirected to the parameter block instead, they alias the parameters and need no copy at all. It 
+ * further detects if any parameter changed since the last copy with a single fixed size comparison.
+ */
+template<typename Kernel, typename Storage>
+struct ParameterBlock {
+    
+    typedef typename Kernel::Scalar                                 Scalar;
+    typedef ParameterLayout<Storage>                                Layout;
+    typedef Eigen::Matrix<Scalar, Layout::Count, 1, Eigen::DontAlign> Values;
+    typedef mpl::range_c<int, 0, mpl::size<Storage>::value>         StorageRange;
+    
+    //map the block into the system and let all mappable storage entries alias it
+    void map(numeric::LinearSystem<Kernel>& sys, Storage& storage) {
+        m_data = sys.mapParameterBlock(Layout::Count, m_index);
+        mpl::for_each<StorageRange>(Binder(storage, m_data));
     };
-    void setOne(Scalar& s, int n)               {
-        s = 1;
+    
+    Scalar* data()  {return m_data;};
+    int     index() {return m_index;};
+    
+    //check if the parameters changed since the last call and remember the current ones
+    bool changed(bool force) {
+        Eigen::Map<const Values> current(m_data);
+        if(!force && current == m_values)
+            return false;
+        
+        m_values = current;
+        return true;
     };
     
-    template<typename T>
-    std::vector<typename Equation::Parameter> map(const Eigen::MatrixBase<T>& m) const {
-        std::vector<typename Equation::Parameter> vec(m.rows()*m.cols());
+    //copy the parameters into the storage
+    void assign(Storage& storage) {
+        mpl::for_each<StorageRange>(Assigner(storage, m_data));
+    };
+    
+    //let the mapped storage entries use their own memory again if the block belongs to the system
+    void release(numeric::LinearSystem<Kernel>& sys, Storage& storage) {
+        if(sys.isParameter(m_data))
+            mpl::for_each<StorageRange>(Releaser(storage));
+    };
+    
+private:
+    struct Assigner {
+        
+        Storage& m_storage;
+        Scalar*  m_data;
         
-        for(int i=0; i<(m.rows()*m.cols()); ++i) 
-            vec[i] = m_system.mapParameter();
+        Assigner(Storage& st, Scalar* d) : m_storage(st), m_data(d) {};
+        
+        template<typename I>
+        void operator()(I) const {
+            assign(fusion::at<I>(m_storage), m_data + Layout::template offset<I::value>::value);
+        };
         
-        return vec;
+        template<typename T>
+        void assign(Eigen::MatrixBase<T>& t, const Scalar* data) const {
+            t = Eigen::Map<const typename T::PlainObject>(data);
+        };
+        
+        template<typename T>
+        void assign(T*& t, const Scalar* data) const {
+            assign(*t, data);
+        };
+        
+        void assign(Scalar& t, const Scalar* data) const {
+            t = *data;
+        };
+        
+        //mapped entries alias the parameters, nothing to do as long as they are not redirected
+        template<typename M>
+        void assign(details::MapMatrix<M>& t, const Scalar* data) const {
+            if(t.data() != data)
+                t = Eigen::Map<const M>(data);
+        };
+    };
+    
+    struct Binder {
+        
+        Storage& m_storage;
+        Scalar*  m_data;
+        
+        Binder(Storage& st, Scalar* d) : m_storage(st), m_data(d) {};
+        
+        template<typename I>
+        void operator()(I) const {
+            bind(fusion::at<I>(m_storage), m_data + Layout::template offset<I::value>::value);
+        };
+        
+        //the current value is used as initial parameter value
+        template<typename M>
+        void bind(details::MapMatrix<M>& t, Scalar* data) const {
+            Eigen::Map<M> parameters(data);
+            parameters = t;
+            t.mapTo(data);
+        };
+        
+        template<typename T>
+        void bind(T& /*t*/, Scalar* /*data*/) const {};
     };
     
-    std::vector<typename Equation::Parameter> map(const Scalar& s) const {
-        std::vector<typename Equation::Parameter> vec(1);
-        vec[0] = m_system.mapParameter();
+    struct Releaser {
+        
+        Storage& m_storage;
+        
+        Releaser(Storage& st) : m_storage(st) {};
         
-        return vec;
+        template<typename I>
+        void operator()(I) const {
+            release(fusion::at<I>(m_storage));
+        };
+        
+        template<typename M>
+        void release(details::MapMatrix<M>& t) const {
+            t.mapLocal();
+        };
+        
+        template<typename T>
+        void release(T& /*t*/) const {};
     };
+    
+    Scalar* m_data  = nullptr;
+    int     m_index = -1;
+    Values  m_values;
 };
 
-template<typename Kernel>
-struct Counter {
-
-    typedef typename Kernel::Scalar Scalar;
+//copies the storage entries into a contiguous block, see gatherStorage
+template<typename Storage, typename Scalar>
+struct Gatherer {
     
-    int& count;
-    Counter(int& c) : count(c) {
-        count = 0;
-    }; 
-
-    template<typename T>
-    void operator()(T& t) const {
-        
-        count += size(t);
-    }
+    Storage& m_storage;
+    Scalar*  m_data;
+    
+    Gatherer(Storage& st, Scalar* d) : m_storage(st), m_data(d) {};
+    
+    template<typename I>
+    void operator()(I) const {
+        gather(fusion::at<I>(m_storage), m_data + ParameterLayout<Storage>::template offset<I::value>::value);
+    };
     
     template<typename T>
-    void operator()(T*& t) const {
-        
-        count += size(*t);
-    }
-
+    void gather(const Eigen::MatrixBase<T>& t, Scalar* data) const {
+        Eigen::Map<typename T::PlainObject> target(data);
+        target = t;
+    };
+    
     template<typename T>
-    int size(Eigen::MatrixBase<T>& m) const {
-        return m.rows()*m.cols();
+    void gather(T* t, Scalar* data) const {
+        gather(*t, data);
     };
-    int size(Scalar& s) const {
-        return 1;
+    
+    void gather(const Scalar& t, Scalar* data) const {
+        *data = t;
     };
 };
 
-template<typename Equation>
-struct Assigner {
+/**
+ * @brief Copy all values of a storage contiguously into \a data
+ * 
+ * The values are written in the order of the parameter layout, hence this is the inverse of 
+ * \ref ParameterBlock::assign. It allows to handle all values of a geometry as a single vector.
+ */
+template<typename Storage, typename Scalar>
+void gatherStorage(Storage& storage, Scalar* data) {
+    mpl::for_each<mpl::range_c<int, 0, mpl::size<Storage>::value>>(Gatherer<Storage, Scalar>(storage, data));
+};
 
-    int& m_count;
-    std::vector<typename Equation::Parameter>& m_params;
+//helper classes for numeric geometry
+template<typename Kernel, typename StorageType, typename Equation, bool InitDerivative = true>
+struct Initializer {
 
-    Assigner(std::vector<typename Equation::Parameter>& p, int& c) : m_params(p), m_count(c) {
-        m_count = -1;
-    };
+    typedef typename Kernel::Scalar     Scalar;
+    typedef ParameterLayout<StorageType> Layout;
+    
+    Scalar*                                         m_block;
+    int                                             m_index;
+    typename Equation::ParameterVector&             m_entries;
+    typename Equation::DerivativeVector&            m_derivatives;
+    StorageType&                                    m_storage;
+
+    Initializer(ParameterBlock<Kernel, StorageType>& block, StorageType& st, 
+                typename Equation::ParameterVector& vec, typename Equation::DerivativeVector& der) 
+        : m_block(block.data()), m_index(block.index()), m_entries(vec), m_derivatives(der), m_storage(st) {};
 
     template<typename T>
-    void operator()(Eigen::MatrixBase<T>& t) const {
-        for(int i=0; i<(t.rows()*t.cols()); ++i)
-            t(i) = m_params[++m_count];
-    }
-    
-    void operator()(typename Equation::KernelType::Scalar& t) const {
-        t = m_params[++m_count];
+    void operator()(T t) {
+
+        //the parameters of this entry are at a fixed position in the block
+        const int offset = Layout::template offset<T::value>::value;
+        const int size   = Layout::template size<T::value>::value;
+        
+        for(int i=0; i<size; ++i) {
+            typename Equation::Parameter param = {m_index + offset + i, m_block + offset + i};
+            
+            //create and set derivatives
+            m_derivatives.emplace_back(typename Equation::DerivativePack(typename Equation::OutputType(),  param));
+            if(InitDerivative) {
+                auto& t2 = fusion::at<T>(m_derivatives.back().first.m_storage);
+                setOne(t2, i);
+            }
+            
+            //set parameters
+            m_entries.push_back(param);
+        };
     }
+
+    template<typename T>
+    void setOne(Eigen::MatrixBase<T>& m, int n) {
+        m(n) = 1;
+    };
+    void setOne(Scalar& s, int n)               {
+        s = 1;
+    };
 };
 
 };//detail
@@ -284,6 +451,13 @@ using Vector = Eigen::Matrix<typename Kernel::Scalar, i, 1>;
 template<typename Kernel, int i, int j> 
 using Matrix = Eigen::Matrix<typename Kernel::Scalar, i, j>;
 
+//storage types which alias the parameters of the linear system when used in numeric geometries
+template<typename Kernel, int i> 
+using MappedVector = details::MapMatrix<Eigen::Matrix<typename Kernel::Scalar, i, 1>>;
+
+template<typename Kernel, int i, int j> 
+using MappedMatrix = details::MapMatrix<Eigen::Matrix<typename Kernel::Scalar, i, j>>;
+
 /**
  * @brief Base class for numeric handling of geometry types
  *
@@ -313,7 +487,8 @@ struct Geometry : public Equation<Kernel, Base<Kernel>> {
                 
     Geometry() {
         Inherited::m_complexity = Complexity::Complex;
-        fusion::for_each(Inherited::m_storage, detail::Counter<Kernel>(Inherited::m_parameterCount));
+        Inherited::m_versioned  = true;
+        Inherited::m_parameterCount = detail::ParameterLayout<typename Inherited::Storage>::Count;
     };
     
 
@@ -328,32 +503,48 @@ struct Geometry : public Equation<Kernel, Base<Kernel>> {
     //types must override the initialisaion behaviour
     virtual void init(LinearSystem<Kernel>& sys) {
 #ifdef DCM_DEBUG
-        dcm_assert(!Inherited::m_init);
         Inherited::m_init = true;
 #endif
         //mpl trickery to get a sequence counting from 0 to the size of stroage entries
         typedef mpl::range_c<int,0,
                 mpl::size<typename Inherited::StorageSequence>::value> StorageRange;
+        Inherited::allocateStorage(sys, Inherited::m_parameterCount, Inherited::m_parameterCount);
+        m_block.map(sys, Inherited::m_storage);
+        
         //now iterate that sequence so we can access all storage elements with knowing the position
         //we are at (that is important to access the correct derivative storage position too)
-        mpl::for_each<StorageRange>(detail::Initializer<Kernel, typename Inherited::Storage, Inherited>(sys,
+        mpl::for_each<StorageRange>(detail::Initializer<Kernel, typename Inherited::Storage, Inherited>(m_block,
                                     Inherited::m_storage, Inherited::m_parameters, 
                                     Inherited::m_derivatives));
     };
     
+    /**
+     * @brief Direct access to the contiguous parameters in the linear system
+     * 
+     * The values are stored in the order of the storage entries, see \ref detail::ParameterLayout. 
+     * Only valid after initialisation.
+     */
+    Scalar* parameterBlock() {return m_block.data();};
+    
+    virtual void release(LinearSystem<Kernel>& sys) {
+        m_block.release(sys, Inherited::m_storage);
+    };
+    
     //we actually do not really need to calculate anything, but we need to make sure the mapped 
-    //values are move over to the output
+    //values are move over to the output. This is only needed if they changed.
     CALCULATE() {
         
-        fusion::for_each(Inherited::m_storage, detail::Assigner<Inherited>(Inherited::m_parameters, m_counter));    
+        if(!m_block.changed(Inherited::m_invalid))
+            return;
+        
+        Inherited::m_invalid = false;
+        ++Inherited::m_version;
+        m_block.assign(Inherited::m_storage);
     };
     
 protected:
     bool m_independent = true;
-    
-protected:
-    int m_counter = -1; //we need a counter for every calculate, and we do not want a memory allocation 
-                        //for every recalculate
+    detail::ParameterBlock<Kernel, typename Inherited::Storage> m_block;
 };
 
 /**
@@ -379,35 +570,45 @@ struct ParameterGeometry : public Equation<Kernel, Base<Kernel>> {
     typedef typename geometry::Geometry<Kernel, ParameterStorageTypes...>::Storage ParameterStorage;
     
     ParameterGeometry() {
-        fusion::for_each(m_parameterStorage, detail::Counter<Kernel>(Inherited::m_parameterCount));
+        Inherited::m_versioned = true;
+        Inherited::m_parameterCount = detail::ParameterLayout<ParameterStorage>::Count;
     };
     
     //make sure the parameter storage is used, not the geometry one, for initialisation
     virtual void init(LinearSystem<Kernel>& sys) {
 #ifdef DCM_DEBUG
-        dcm_assert(!Inherited::m_init);
         Inherited::m_init = true;
 #endif
         //mpl trickery to get a sequence counting from 0 to the size of stroage entries
         typedef mpl::range_c<int,0, mpl::size<ParameterStorage>::value> StorageRange;
         
+        Inherited::allocateStorage(sys, Inherited::m_parameterCount, Inherited::m_parameterCount);
+        m_block.map(sys, m_parameterStorage);
+        
         //now iterate that sequence so we can access all storage elements with knowing the position
         //we are at (that is important to access the correct derivative storage position too)
-        mpl::for_each<StorageRange>(detail::Initializer<Kernel, ParameterStorage, Inherited>(sys,
+        mpl::for_each<StorageRange>(detail::Initializer<Kernel, ParameterStorage, Inherited>(m_block,
                                     m_parameterStorage, Inherited::m_parameters, 
                                     Inherited::m_derivatives));
     };
     
+    virtual void release(LinearSystem<Kernel>& sys) {
+        m_block.release(sys, m_parameterStorage);
+    };
+    
     CALCULATE() {
-        fusion::for_each(m_parameterStorage, 
-                         detail::Assigner<Inherited>(Inherited::m_parameters, m_counter));    
+        
+        if(!m_block.changed(Inherited::m_invalid))
+            return;
+        
+        Inherited::m_invalid = false;
+        ++Inherited::m_version;
+        m_block.assign(m_parameterStorage);
     };
 
 protected:
-    ParameterStorage     m_parameterStorage;
-
-    int m_counter = -1; //we need a counter for every calculate, and we do not want a memory allocation 
-                        //for every recalculate
+    ParameterStorage                                m_parameterStorage;
+    detail::ParameterBlock<Kernel, ParameterStorage> m_block;
 };
 
 /**
@@ -435,13 +636,12 @@ struct DependendGeometry : public UnaryEquation<Kernel, Input<Kernel>, Output<Ke
     typedef typename geometry::Geometry<Kernel, ParameterStorageTypes...>::Storage ParameterStorage;
 
     DependendGeometry() {
-        fusion::for_each(m_parameterStorage, detail::Counter<Kernel>(Inherited::m_parameterCount));
+        Inherited::m_parameterCount = detail::ParameterLayout<ParameterStorage>::Count;
     };
     
     //make sure the parameter storage is used, not the geometry one, for initialisation
     virtual void init(LinearSystem<Kernel>& sys) {
 #ifdef DCM_DEBUG
-        dcm_assert(!Inherited::m_init);
         Inherited::m_init = true;
 #endif
         
@@ -454,16 +654,28 @@ struct DependendGeometry : public UnaryEquation<Kernel, Input<Kernel>, Output<Ke
         //mpl trickery to get a sequence counting from 0 to the size of stroage entries
         typedef mpl::range_c<int,0, mpl::size<ParameterStorage>::value> StorageRange;
         
+        Inherited::allocateStorage(sys, Inherited::m_parameterCount, 
+                                   std::max<std::size_t>(Inherited::m_parameterCount, 
+                                                         Inherited::inputEquation()->parameters().size()));
+        m_block.map(sys, m_parameterStorage);
+        
         //now iterate that sequence so we can access all storage elements with knowing the position
         //we are at (that is important to access the correct derivative storage position too)
-        mpl::for_each<StorageRange>(detail::Initializer<Kernel, ParameterStorage, Inherited>(sys,
+        mpl::for_each<StorageRange>(detail::Initializer<Kernel, ParameterStorage, Inherited>(m_block,
                                     m_parameterStorage, Inherited::m_parameters, 
                                     Inherited::m_derivatives));
         
         //now add the derivatives we take over from the input geometry
         Inherited::m_derivatives.clear();
         for(const auto& param : Inherited::inputEquation()->parameters()) 
-            Inherited::m_derivatives.push_back(std::make_pair(Inherited::OutputType(), param));
+            Inherited::m_derivatives.push_back(std::make_pair(typename Inherited::OutputType(), param));
+    };
+    
+    virtual void release(LinearSystem<Kernel>& sys) {
+        if(Inherited::hasInputOwnership())
+            Inherited::m_input->release(sys);
+        
+        m_block.release(sys, m_parameterStorage);
     };
     
     CALCULATE() {
@@ -471,16 +683,17 @@ struct DependendGeometry : public UnaryEquation<Kernel, Input<Kernel>, Output<Ke
         dcm_assert(Inherited::m_input);        
         if(Inherited::hasInputOwnership())
             Inherited::m_input->execute(); 
+        
+        //bring the own parameters into the storage for the derived class
+        m_block.assign(m_parameterStorage);
                 
         //to calculate the real output one needs to know the mathematical equation... this must be done 
         //by the derived class
     };
     
 protected:
-    ParameterStorage     m_parameterStorage;
-
-    int m_counter = -1; //we need a counter for every calculate, and we do not want a memory allocation 
-                        //for every recalculate
+    ParameterStorage                                m_parameterStorage;
+    detail::ParameterBlock<Kernel, ParameterStorage> m_block;
 };
 
 } //numeric
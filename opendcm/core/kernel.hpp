@@ -23,7 +23,18 @@
 #include <Eigen/Core>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
+#include <Eigen/Sparse>
 #include <boost/graph/graph_concepts.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <atomic>
 
 #include "transformation.hpp"
 #include "logging.hpp"
@@ -70,6 +81,179 @@ struct MatrixEntry {
     };
 };
 
+/**
+ * @brief Monotonic memory arena for the equation storage of a \ref LinearSystem
+ * 
+ * Equations allocate their parameter and derivative storage while beeing initialized, which happens in
+ * evaluation order. Serving those allocations from a few big chunks instead of the heap keeps the data 
+ * of subsequent equations close together in memory and avoids tens of thousands of small allocations 
+ * for large systems. Memory is never given back individually, all chunks are released at once when the 
+ * arena is destroyed or \ref release is called.
+ * 
+ * Only the storage of the equations is served from the arena, not the equation objects themself. They are 
+ * created by the graph reduction before the system exists and are cached between solves, hence they need
+ * to outlive the system and its arena.
+ * 
+ * @remark The arena is not thread safe. All equations of a system must therefore be initialized from a 
+ * single thread, in debug builds concurrent allocations are detected by an assert.
+ */
+class Arena {
+    
+public:
+    Arena(std::size_t chunkSize = 64*1024) : m_chunkSize(chunkSize) {};
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    
+    ~Arena() {
+        release();
+    };
+    
+    /**
+     * @brief Allocates \a bytes with the given alignment
+     * 
+     * If the current chunk has not enough space left a new one is created, which is at least as big as 
+     * all chunks before to keep the number of chunks logarithmic to the used memory.
+     */
+    void* allocate(std::size_t bytes, std::size_t alignment) {
+        
+#ifdef DCM_DEBUG
+        //concurrent initialisation of equations of the same system
+        dcm_assert(!m_busy.exchange(true));
+        struct Guard {
+            std::atomic<bool>& busy;
+            ~Guard() {busy = false;};
+        } guard{m_busy};
+#endif
+        if(!m_chunks.empty()) {
+            Chunk& chunk = m_chunks.back();
+            std::size_t offset = align(chunk, alignment);
+            if(offset + bytes <= chunk.capacity) {
+                chunk.used = offset + bytes;
+                m_allocated += bytes;
+                return chunk.data + offset;
+            }
+        }
+        
+        //the chunk start is only aligned for fundamental types, hence reserve space for the alignment
+        std::size_t capacity = std::max(std::max(m_chunkSize, m_capacity), bytes + alignment);
+        m_chunks.push_back({static_cast<char*>(::operator new(capacity)), capacity, 0});
+        m_capacity += capacity;
+        
+        Chunk& chunk = m_chunks.back();
+        std::size_t offset = align(chunk, alignment);
+        chunk.used = offset + bytes;
+        m_allocated += bytes;
+        return chunk.data + offset;
+    };
+    
+    /**
+     * @brief Frees all memory at once
+     * 
+     * All storage allocated from this arena becomes invalid, hence this must only be called if no 
+     * object using the arena is accessed anymore.
+     */
+    void release() {
+        for(Chunk& chunk : m_chunks)
+            ::operator delete(chunk.data);
+        
+        m_chunks.clear();
+        m_capacity  = 0;
+        m_allocated = 0;
+    };
+    
+    std::size_t allocated() const   {return m_allocated;};
+    std::size_t capacity() const    {return m_capacity;};
+    std::size_t chunkCount() const  {return m_chunks.size();};
+    
+    bool contains(const void* ptr) const {
+        const char* c = static_cast<const char*>(ptr);
+        for(const Chunk& chunk : m_chunks) {
+            if(c >= chunk.data && c < chunk.data + chunk.capacity)
+                return true;
+        }
+        return false;
+    };
+    
+private:
+    struct Chunk {
+        char*       data;
+        std::size_t capacity;
+        std::size_t used;
+    };
+    
+    std::size_t align(const Chunk& chunk, std::size_t alignment) {
+        std::size_t address = reinterpret_cast<std::size_t>(chunk.data + chunk.used);
+        return chunk.used + (alignment - address % alignment) % alignment;
+    };
+    
+    std::vector<Chunk> m_chunks;
+    std::size_t        m_chunkSize;
+    std::size_t        m_capacity  = 0;
+    std::size_t        m_allocated = 0;
+#ifdef DCM_DEBUG
+    std::atomic<bool>  m_busy{false};
+#endif
+};
+
+/**
+ * @brief Standard allocator which uses a \ref Arena
+ * 
+ * The allocator shares the ownership of the arena, hence the memory stays valid as long as any container
+ * using it exists. Default constructed allocators are not bound to an arena and use the heap, this allows
+ * to use containers before they are moved into the arena of a \ref LinearSystem.
+ */
+template<typename T>
+struct ArenaAllocator {
+    
+    typedef T               value_type;
+    typedef std::true_type  propagate_on_container_move_assignment;
+    typedef std::true_type  propagate_on_container_swap;
+    
+    template<typename U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+    
+    ArenaAllocator() {};
+    ArenaAllocator(const std::shared_ptr<Arena>& arena) : m_arena(arena) {};
+    
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) {};
+    
+    T* allocate(std::size_t n) {
+        if(m_arena)
+            return static_cast<T*>(m_arena->allocate(n*sizeof(T), alignof(T)));
+        
+        return static_cast<T*>(::operator new(n*sizeof(T)));
+    };
+    
+    void deallocate(T* ptr, std::size_t) {
+        //arena memory is only released all at once
+        if(!m_arena)
+            ::operator delete(ptr);
+    };
+    
+    const std::shared_ptr<Arena>& arena() const {return m_arena;};
+    
+private:
+    std::shared_ptr<Arena> m_arena;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {return a.arena() == b.arena();};
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {return a.arena() != b.arena();};
+
+/**
+ * @brief Storage layout of the jacobi matrix inside a \ref LinearSystem
+ * 
+ * Dense:  The full matrix is allocated, every possible entry has its place in memory
+ * Sparse: Only the entries requested via \ref LinearSystem::mapJacobi are allocated, the sparsity
+ *         pattern is recorded while mapping and the solver gets a Eigen::SparseMatrix
+ */
+enum class JacobiStorage { Dense, Sparse };
+
 template<typename Kernel> 
 struct LinearSystem {
     
@@ -77,9 +261,15 @@ struct LinearSystem {
     typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
     typedef Eigen::Matrix<Scalar, Eigen::Dynamic,
                 Eigen::Dynamic>                      MatrixX;
+    typedef Eigen::SparseMatrix<Scalar>              SparseMatrixX;
+    typedef std::vector<VectorEntry<Kernel>, 
+                ArenaAllocator<VectorEntry<Kernel>>> ParameterVector;
     
-    LinearSystem(int p, int e) : m_parameterCount(p), m_equationCount(e),
-            m_jacobi(e, p), m_parameters(p),  m_residuals(e) {};
+    LinearSystem(int p, int e, JacobiStorage storage = JacobiStorage::Dense) 
+            : m_parameterCount(p), m_equationCount(e), m_storage(storage), m_parameters(VectorX::Zero(p)), 
+              m_residuals(VectorX::Zero(e)),
+              m_jacobi(MatrixX::Zero(storage == JacobiStorage::Dense ? e : 0, storage == JacobiStorage::Dense ? p : 0)), 
+              m_sparseJacobi(e, p), m_arena(std::make_shared<Arena>()) {};
     
     
     VectorEntry<Kernel> mapParameter() {
@@ -87,18 +277,18 @@ struct LinearSystem {
         return {m_parameterOffset, s};
     };                
                
-    std::vector<VectorEntry<Kernel>> mapParameter(Scalar*& s) {
+    ParameterVector mapParameter(Scalar*& s) {
         s = &m_parameters(++m_parameterOffset);
-        std::vector<VectorEntry<Kernel>> result(1);
+        ParameterVector result(1, VectorEntry<Kernel>(), m_arena);
         result[0] = {m_parameterOffset, s};
         return result;
     };
 
     template<typename Derived>
-    std::vector<VectorEntry<Kernel>> mapParameter(Eigen::Map<Derived>& map) {
+    ParameterVector mapParameter(Eigen::Map<Derived>& map) {
         new(&map) Eigen::Map<Derived>(&m_parameters(++m_parameterOffset));
         
-        std::vector<VectorEntry<Kernel>> result(map.rows());
+        ParameterVector result(map.rows(), VectorEntry<Kernel>(), m_arena);
         for (int i = 0; i < map.rows(); ++i)
             result[i] = {m_parameterOffset + i, &m_parameters(m_parameterOffset + i)};
 
@@ -108,6 +298,22 @@ struct LinearSystem {
         return result;
     };
     
+    /**
+     * @brief Maps \a count consecutive parameters
+     * 
+     * @param count the amount of parameters to map
+     * @param index is set to the index of the first parameter
+     * @return Scalar* address of the first parameter, the others follow contiguously
+     */
+    Scalar* mapParameterBlock(int count, int& index) {
+        index = m_parameterOffset + 1;
+        if(count == 0)
+            return nullptr;
+        
+        m_parameterOffset += count;
+        return &m_parameters(index);
+    };
+    
     VectorEntry<Kernel> mapResidual(Scalar*& s) {
         s = &m_residuals(++m_residualOffset);
         return {m_residualOffset, s};
@@ -119,34 +325,181 @@ struct LinearSystem {
     };
     
     MatrixEntry<Kernel> mapJacobi(int row, int col, Scalar*& s) {
-        s = &m_jacobi(row, col);
+        s = jacobiEntry(row, col);
         return {row, col, s};
     };  
     
     MatrixEntry<Kernel> mapJacobi(int row, int col) {
-        Scalar* s = &m_jacobi(row, col);
+        Scalar* s = jacobiEntry(row, col);
         return {row, col, s};
     };   
     
     void setupJacobi() {
-        m_jacobi.setZero();
+        if(m_storage == JacobiStorage::Dense)
+            m_jacobi.setZero();
+        else 
+            std::fill(m_sparseValues.begin(), m_sparseValues.end(), Scalar(0));
     };
     
+    /**
+     * @brief Access a single jacobi entry
+     * 
+     * In sparse mode an entry which was not mapped before is created, hence the sparsity pattern
+     * changes.
+     */
     Scalar& jacobiAt(int row, int col) {
-       return m_jacobi(row, col);  
+       return *jacobiEntry(row, col);  
     };
     
     //access the vectors and matrices
     VectorX& parameter() {return m_parameters;};
     VectorX& residuals() {return m_residuals;};
-    MatrixX& jacobi()    {return m_jacobi;};    
+    
+    /**
+     * @brief Access the dense jacobi matrix
+     * 
+     * Only valid if the system uses \ref JacobiStorage::Dense, in sparse mode the returned matrix is empty.
+     * Use \ref sparseJacobi for storage independent access.
+     */
+    MatrixX& jacobi()    {
+        dcm_assert(m_storage == JacobiStorage::Dense);
+        return m_jacobi;
+    };    
+    
+    /**
+     * @brief Access the jacobi as Eigen::SparseMatrix
+     * 
+     * In sparse mode the matrix structure is build from the mapped entries once after the pattern
+     * changed, afterwards only the values are copied over from the mapped storage. Hence the structure 
+     * of the returned matrix is fixed as long as no new entries are mapped, which allows the solver to 
+     * reuse structural information. In dense mode every entry of the dense matrix is structural, hence 
+     * the returned matrix holds all entries including zeros and its structure does not depend on the values.
+     */
+    SparseMatrixX& sparseJacobi() {
+        
+        if(m_storage == JacobiStorage::Dense) {
+            if(m_patternChanged || m_sparseJacobi.nonZeros() != m_jacobi.size())
+                buildDensePattern();
+            
+            //both are column major, hence the values are in the same order
+            std::copy(m_jacobi.data(), m_jacobi.data() + m_jacobi.size(), m_sparseJacobi.valuePtr());
+            return m_sparseJacobi;
+        }
+        
+        if(m_patternChanged)
+            buildSparsePattern();
+        
+        Scalar* values = m_sparseJacobi.valuePtr();
+        for(std::size_t i=0; i<m_sparseSources.size(); ++i)
+            values[i] = *m_sparseSources[i];
+        
+        return m_sparseJacobi;
+    };
+    
+    /**
+     * @brief The arena all equations initialized with this system allocate their storage from
+     * 
+     * The equations share the ownership of the arena, the memory is released in one step when the system
+     * and all its equations are destroyed.
+     */
+    const std::shared_ptr<Arena>& arena() {return m_arena;};
+    
+    //true if the given address is one of the parameters of this system
+    bool isParameter(const Scalar* s) {
+        return m_parameterCount > 0 && s >= m_parameters.data() && s < m_parameters.data() + m_parameterCount;
+    };
+    
+    JacobiStorage storage()           {return m_storage;};
+    bool          isSparse()          {return m_storage == JacobiStorage::Sparse;};
+    int           parameterCount()    {return m_parameterCount;};
+    int           equationCount()     {return m_equationCount;};
+    
+    /**
+     * @brief Amount of stored jacobi entries
+     * 
+     * For sparse systems this is the number of mapped entries, for dense ones the full matrix size
+     */
+    int jacobiEntryCount() {
+        if(m_storage == JacobiStorage::Dense)
+            return m_jacobi.size();
+        
+        return m_sparseValues.size();
+    };
     
 private:
     int m_parameterCount, m_equationCount;
     int m_parameterOffset = -1, m_residualOffset  = -1;
+    JacobiStorage m_storage;
     VectorX m_parameters;
     VectorX m_residuals;
     MatrixX m_jacobi;
+    
+    //sparse storage: the values are held in a deque as it never invalidates pointers when growing,
+    //this way the addresses handed out in mapJacobi stay valid for the lifetime of the system
+    std::deque<Scalar>                          m_sparseValues;
+    std::unordered_map<long long, Scalar*>      m_sparseMap;
+    std::vector<Scalar*>                        m_sparseSources; //value sources in compressed order
+    SparseMatrixX                               m_sparseJacobi;
+    bool                                        m_patternChanged = true;
+    std::shared_ptr<Arena>                      m_arena;
+    
+    Scalar* jacobiEntry(int row, int col) {
+        
+        if(m_storage == JacobiStorage::Dense)
+            return &m_jacobi(row, col);
+        
+        dcm_assert(row < m_equationCount && col < m_parameterCount);
+        
+        //the same entry must always map to the same memory, equal to the dense storage
+        const long long key = static_cast<long long>(row)*m_parameterCount + col;
+        auto it = m_sparseMap.find(key);
+        if(it != m_sparseMap.end())
+            return it->second;
+        
+        m_sparseValues.push_back(Scalar(0));
+        Scalar* s = &m_sparseValues.back();
+        m_sparseMap[key] = s;
+        m_patternChanged = true;
+        return s;
+    };
+    
+    void buildSparsePattern() {
+        
+        //collect all entries and order them column major, as this is the eigen default storage order
+        std::vector<std::pair<long long, Scalar*>> entries(m_sparseMap.begin(), m_sparseMap.end());
+        const long long rows = m_equationCount;
+        std::sort(entries.begin(), entries.end(), 
+                  [&](const std::pair<long long, Scalar*>& a, const std::pair<long long, Scalar*>& b) {
+            const long long ca = a.first % m_parameterCount, cb = b.first % m_parameterCount;
+            return (ca*rows + a.first / m_parameterCount) < (cb*rows + b.first / m_parameterCount);
+        });
+        
+        Eigen::VectorXi columnCount = Eigen::VectorXi::Zero(m_parameterCount);
+        for(const auto& entry : entries)
+            ++columnCount(entry.first % m_parameterCount);
+        
+        m_sparseJacobi.resize(m_equationCount, m_parameterCount);
+        m_sparseJacobi.reserve(columnCount);
+        m_sparseSources.resize(entries.size());
+        for(std::size_t i=0; i<entries.size(); ++i) {
+            m_sparseJacobi.insert(entries[i].first / m_parameterCount, entries[i].first % m_parameterCount) = 0;
+            m_sparseSources[i] = entries[i].second;
+        }
+        m_sparseJacobi.makeCompressed();
+        m_patternChanged = false;
+    };
+    
+    void buildDensePattern() {
+        
+        m_sparseJacobi.resize(m_jacobi.rows(), m_jacobi.cols());
+        m_sparseJacobi.reserve(Eigen::VectorXi::Constant(m_jacobi.cols(), m_jacobi.rows()));
+        for(int c=0; c<m_jacobi.cols(); ++c) {
+            for(int r=0; r<m_jacobi.rows(); ++r)
+                m_sparseJacobi.insert(r, c) = 0;
+        }
+        m_sparseJacobi.makeCompressed();
+        m_patternChanged = false;
+    };
 };
 
 
@@ -172,7 +525,7 @@ struct Calculatable : shedule::Executable {
      * @param sys LinearSystem the geometry is initalized with
      * @return void
      */
-    virtual void init(LinearSystem<Kernel>& sys) {};
+    virtual void init(LinearSystem<Kernel>& /*sys*/) {};
     
     /**
      * @brief Execution of the calculation
@@ -185,6 +538,44 @@ struct Calculatable : shedule::Executable {
      */
     virtual void execute() {};  
     
+    /**
+     * @brief Collect the calculatables this one uses as input
+     * 
+     * Appends all calculatables whose results are needed for this calculation. They must be executed 
+     * before this one, either by this calculatable if it has the input ownership or by the caller.
+     * 
+     * @param inputs vector the inputs are appended to
+     * @return void
+     */
+    virtual void collectInputs(std::vector<Calculatable<Kernel>*>& /*inputs*/) {};
+    
+    /**
+     * @brief Returns if the inputs are initialized and executed by this calculatable
+     * 
+     * Calculatables without inputs never own any. See \ref InputEquation for details.
+     */
+    virtual bool hasInputOwnership() {return false;};
+    
+    /**
+     * @brief Set the ownership of the inputs
+     * 
+     * Calculatables without inputs ignore this. See \ref InputEquation for details.
+     */
+    virtual void takeInputOwnership(bool /*val*/) {};
+    
+    /**
+     * @brief Detach from the linear system given in \ref init
+     * 
+     * Calculatables may outlive the system they were initialized with, e.g. as reduction results which are
+     * reused for the next system. Outputs which alias the systems memory must be redirected to own storage 
+     * before the system is destroyed, the current values are kept. Calculatables initialized with another 
+     * system meanwhile ignore the call. Before the next execution \ref init must be called again.
+     * 
+     * @param sys LinearSystem which is going to be destroyed
+     * @return void
+     */
+    virtual void release(LinearSystem<Kernel>& /*sys*/) {};
+    
     /**
      * @brief Number of free parameters this equation needs
      * 
@@ -200,6 +591,241 @@ protected:
 };
     
 //the standart solverS
+/**
+ * @brief Gauss-Newton steps from the normal equations
+ * 
+ * Instead of factorizing the jacobi directly the step is calculated from the normal equations, which are
+ * symmetric positive (semi)definite and can therefore be handled by a cholesky factorization. Depending on 
+ * the system shape the smaller of the two possible normal matrices is used:
+ *  - underdetermined (e <= p): h = -J^T (J J^T + mu I)^{-1} F, the minimal norm solution
+ *  - overdetermined  (e > p):  h = -(J^T J + mu I)^{-1} J^T F, the least squares solution
+ * 
+ * The normal matrix is factorized as it is, hence regular systems get the exact gauss-newton step. Only if
+ * the factorization fails or is numerically singular, as for redundant constraint sets, it is redone with 
+ * a small regularization relative to the largest diagonal entry. Sparse jacobis are handled by a sparse 
+ * LDLT, dense ones by a dense one. 
+ * After \ref factorize any number of right hand sides can be solved with \ref solve.
+ * 
+ * The symbolic analysis of the sparse factorization (fill reducing ordering and elimination tree) only 
+ * depends on the jacobi structure. It is therefore cached for the most recently used sparsity patterns and 
+ * only the numeric factorization is redone for each step, also for consecutive solves of different systems
+ * with the same structure.
+ */
+template<typename Kernel>
+struct NormalEquations {
+    
+    typedef typename Kernel::Scalar                  Scalar;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic,
+                Eigen::Dynamic>                      MatrixX;
+    typedef Eigen::SparseMatrix<Scalar>              SparseMatrixX;
+    
+    /**
+     * @brief Factorize the normal matrix of jacobi \a J with additional damping \a mu
+     * 
+     * @return bool false if the factorization failed
+     */
+    bool factorize(const SparseMatrixX& J, Scalar mu) {
+        
+        m_minimalNorm = J.rows() <= J.cols();
+        if(m_minimalNorm)
+            m_normal = J * J.transpose();
+        else
+            m_normal = J.transpose() * J;
+        
+        //the diagonal of a normal matrix holds the squared row/column norms and is therefore never 
+        //structural zero unless a row/column is empty, coeffRef inserts the missing ones. It must be 
+        //part of the pattern also without damping, as a regularization may be added later
+        for(int i=0; i<m_normal.outerSize(); ++i)
+            m_normal.coeffRef(i,i) += mu;
+        m_normal.makeCompressed();
+        
+        //the normal matrix structure depends only on the jacobi structure, hence the symbolic analysis
+        //can be reused for all jacobis with the same pattern and only the numeric factorization is needed
+        m_factorization = &symbolicFactorization(J);
+        m_factorization->factorize(m_normal);
+        ++m_factorizeCount;
+        if(regular(*m_factorization, m_normal.diagonal()))
+            return true;
+        
+        const Scalar reg = regularization(m_normal.diagonal());
+        for(int i=0; i<m_normal.outerSize(); ++i)
+            m_normal.coeffRef(i,i) += reg;
+        
+        m_factorization->factorize(m_normal);
+        return m_factorization->info() == Eigen::Success;
+    };
+    
+    /**
+     * @brief Hash of the sparsity pattern of \a J 
+     * 
+     * Equal patterns always give equal signatures, hence it can be used as key for structural data.
+     */
+    static std::size_t patternSignature(const SparseMatrixX& J) {
+        
+        std::size_t seed = 0;
+        boost::hash_combine(seed, J.rows());
+        boost::hash_combine(seed, J.cols());
+        for(int i=0; i<J.outerSize(); ++i) {
+            boost::hash_combine(seed, i);
+            for(typename SparseMatrixX::InnerIterator it(J, i); it; ++it)
+                boost::hash_combine(seed, it.index());
+        }
+        return seed;
+    };
+    
+    //amount of symbolic analysis done, all other factorizations reused a cached one
+    int  analyzeCount()                 {return m_analyzeCount;};
+    
+    //amount of normal matrices factorized, retries with regularization are not counted
+    int  factorizeCount()               {return m_factorizeCount;};
+    
+    //maximal amount of different sparsity patterns whose symbolic analysis is held
+    void setCacheSize(std::size_t size) {m_cacheSize = std::max(size, std::size_t(1));};
+    
+    bool factorize(const MatrixX& J, Scalar mu) {
+        
+        m_minimalNorm = J.rows() <= J.cols();
+        if(m_minimalNorm)
+            m_denseNormal.noalias() = J * J.transpose();
+        else
+            m_denseNormal.noalias() = J.transpose() * J;
+        
+        m_denseNormal.diagonal().array() += mu;
+        m_denseFactorization.compute(m_denseNormal);
+        ++m_factorizeCount;
+        if(regular(m_denseFactorization, m_denseNormal.diagonal()))
+            return true;
+        
+        m_denseNormal.diagonal().array() += regularization(m_denseNormal.diagonal());
+        m_denseFactorization.compute(m_denseNormal);
+        return m_denseFactorization.info() == Eigen::Success;
+    };
+    
+    /**
+     * @brief Calculate the step for the residual \a F with the last factorization of jacobi \a J
+     * 
+     * @return bool false if the result is not usable
+     */
+    bool solve(const SparseMatrixX& J, const VectorX& F, VectorX& h) {
+        
+        if(m_minimalNorm) 
+            h = -(J.transpose() * m_factorization->solve(F));
+        else
+            h = -m_factorization->solve(J.transpose() * F);
+        
+        return (m_factorization->info() == Eigen::Success) && h.allFinite();
+    };
+    
+    bool solve(const MatrixX& J, const VectorX& F, VectorX& h) {
+        
+        if(m_minimalNorm) 
+            h = -(J.transpose() * m_denseFactorization.solve(F));
+        else
+            h = -m_denseFactorization.solve(J.transpose() * F);
+        
+        return h.allFinite();
+    };
+    
+    /**
+     * @brief Factorize and calculate the damped gauss-newton step in one go
+     * 
+     * @param J the system jacobi
+     * @param F the system residual
+     * @param mu additional damping added to the normal matrix diagonal
+     * @param h the calculated step
+     * @return bool false if the factorization failed and \a h is invalid
+     */
+    template<typename Matrix>
+    bool solve(const Matrix& J, const VectorX& F, Scalar mu, VectorX& h) {
+        return factorize(J, mu) && solve(J, F, h);
+    };
+    
+private:
+    typedef Eigen::SimplicialLDLT<SparseMatrixX> Factorization;
+    
+    //full copy of a sparsity pattern, the signature alone could collide
+    struct Pattern {
+        std::size_t         signature;
+        int                 rows, cols;
+        std::vector<int>    outer, inner;
+        
+        bool operator==(const Pattern& p) const {
+            return signature == p.signature && rows == p.rows && cols == p.cols 
+                    && outer == p.outer && inner == p.inner;
+        };
+    };
+    typedef std::pair<Pattern, std::unique_ptr<Factorization>> CacheEntry;
+    
+    bool                                  m_minimalNorm = true;
+    SparseMatrixX                         m_normal;
+    Factorization*                        m_factorization = nullptr;
+    std::list<CacheEntry>                 m_cache;  //most recently used first
+    std::size_t                           m_cacheSize = 8;
+    int                                   m_analyzeCount = 0, m_factorizeCount = 0;
+    MatrixX                               m_denseNormal;
+    Eigen::LDLT<MatrixX>                  m_denseFactorization;
+    
+    //get the factorization which holds the symbolic analysis for the structure of J
+    Factorization& symbolicFactorization(const SparseMatrixX& J) {
+        
+        Pattern pattern{patternSignature(J), int(J.rows()), int(J.cols()), {}, {}};
+        pattern.outer.reserve(J.outerSize()+1);
+        pattern.inner.reserve(J.nonZeros());
+        pattern.outer.push_back(0);
+        for(int i=0; i<J.outerSize(); ++i) {
+            for(typename SparseMatrixX::InnerIterator it(J, i); it; ++it)
+                pattern.inner.push_back(it.index());
+            pattern.outer.push_back(pattern.inner.size());
+        }
+        
+        for(auto it = m_cache.begin(); it != m_cache.end(); ++it) {
+            if(it->first == pattern) {
+                m_cache.splice(m_cache.begin(), m_cache, it);
+                return *m_cache.front().second;
+            }
+        }
+        
+        if(m_cache.size() >= m_cacheSize)
+            m_cache.pop_back();
+        
+        m_cache.emplace_front(std::move(pattern), std::unique_ptr<Factorization>(new Factorization));
+        m_cache.front().second->analyzePattern(m_normal);
+        ++m_analyzeCount;
+        return *m_cache.front().second;
+    };
+    
+    template<typename Derived>
+    static Scalar maxDiagonal(const Eigen::MatrixBase<Derived>& diagonal) {
+        return std::max(diagonal.size() ? Scalar(diagonal.maxCoeff()) : Scalar(0), Scalar(1));
+    };
+    
+    template<typename Derived>
+    static Scalar regularization(const Eigen::MatrixBase<Derived>& diagonal) {
+        return std::sqrt(std::numeric_limits<Scalar>::epsilon()) * maxDiagonal(diagonal);
+    };
+    
+    //a factorization is regular if it succeeded and no pivot vanished relative to the matrix size. The
+    //dense LDLT never fails for singular matrices, hence the pivots need to be checked for both
+    template<typename Factorization, typename Derived>
+    static bool regular(const Factorization& f, const Eigen::MatrixBase<Derived>& diagonal) {
+        
+        if(f.info() != Eigen::Success)
+            return false;
+        
+        const Scalar tolerance = std::numeric_limits<Scalar>::epsilon() * diagonal.size() * maxDiagonal(diagonal);
+        return f.vectorD().size() == 0 || f.vectorD().cwiseAbs().minCoeff() > tolerance;
+    };
+};
+
+/**
+ * @brief Powell's dogleg trust region solver
+ * 
+ * The solver works directly on a \ref LinearSystem and combines the steepest descent direction with the 
+ * gauss-newton step, which is calculated from the normal equations with a sparse factorization for sparse
+ * systems and a dense one for dense systems (see \ref NormalEquations). The system values are updated by the given functor, which must recalculate the 
+ * residual and jacobi for the current parameter vector.
+ */
 template<typename Kernel>
 struct Dogleg {
 
@@ -207,27 +833,438 @@ struct Dogleg {
     dcm_logger log;
 #endif
 
-    typedef typename Kernel::Scalar Scalar;
-    Scalar tolg, tolx, delta, nu, g_inf, fx_inf, err, time;
+    typedef typename Kernel::Scalar                  Scalar;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic,
+                Eigen::Dynamic>                      MatrixX;
+    typedef Eigen::SparseMatrix<Scalar>              SparseMatrixX;
+    
+    Scalar tolg, tolx, tolf, delta, nu, g_inf, fx_inf, err, time;
     Kernel* m_kernel;
-    int iter, stop, reduce, unused, counter;
-    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> h_dl, F_old, g;
-    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> J_old;
+    int iter, stop, reduce, unused, counter, maxIterations;
+    VectorX h_dl, h_gn, F_old, g;
+    SparseMatrixX J_old;
+    MatrixX J_dense;
+    NormalEquations<Kernel> m_normal;
+    bool m_stepValid = false; //are h_gn and alpha calculated for the current jacobi?
+    Scalar alpha = 0;
 
-    Dogleg(Kernel* k);
-    Dogleg();
-/*
-    void setKernel(Kernel* k);
+    Dogleg(Kernel* k) : Dogleg() {
+        m_kernel = k;
+    };
+    
+    Dogleg() : tolg(1e-40), tolx(1e-20), tolf(1e-10), delta(5), nu(2), g_inf(0), fx_inf(0), err(0), time(0),
+               m_kernel(nullptr), iter(0), stop(0), reduce(0), unused(0), counter(0), maxIterations(10000) {};
+
+    /**
+     * @brief Calculate the dogleg step for the given trust region radius
+     * 
+     * The gauss-newton and steepest descent steps only depend on the jacobi and residual, hence they are 
+     * calculated once per accepted step and reused for all rejected ones, which only shrink the trust 
+     * region. Call \ref invalidateStep whenever the jacobi or residual change.
+     * 
+     * @param g the gradient J^T F
+     * @param jacobi the system jacobi
+     * @param residual the system residual
+     * @param h_dl the resulting step
+     * @param delta trust region radius
+     * @return void
+     */
+    template<typename Matrix>
+    void calculateStep(const VectorX& g, const Matrix& jacobi, const VectorX& residual, 
+                       VectorX& h_dl, const Scalar delta) {
+
+        // get the steepest descent stepsize and direction
+        const VectorX h_sd  = -g;
+        if(!m_stepValid) {
+            alpha = g.squaredNorm()/(jacobi*g).squaredNorm();
+            
+            // get the gauss-newton step, fall back to the scaled steepest descent if the system is degenerated
+            if(!m_normal.solve(jacobi, residual, Scalar(0), h_gn))
+                h_gn = alpha*h_sd;
+            
+            m_stepValid = true;
+        }
+
+        // compute the dogleg step
+        if(h_gn.norm() <= delta) {
+            h_dl = h_gn;
+        } else if((alpha*h_sd).norm() >= delta) {
+            h_dl = (delta/(h_sd.norm()))*h_sd;
+        } else {
+            //compute beta
+            Scalar beta = 0;
+            const VectorX a = alpha*h_sd;
+            const VectorX b = h_gn;
+            const Scalar c = a.dot(b-a);
+            const Scalar bas = (b-a).squaredNorm(), as = a.squaredNorm();
+            if(c<0) {
+                beta = -c+std::sqrt(std::pow(c,2)+bas*(std::pow(delta,2)-as));
+                beta /= bas;
+            } else {
+                beta = std::pow(delta,2)-as;
+                beta /= c+std::sqrt(std::pow(c,2) + bas*(std::pow(delta,2)-as));
+            };
+
+            // and update h_dl with beta
+            h_dl = alpha*h_sd + beta*(b-a);
+        }
+    };
+
+    /**
+     * @brief Solve the system
+     * 
+     * Iterates until the residual is small enough or one of the other stop criteria is reached. After 
+     * returning the system holds the parameters of the best solution found and the residual and jacobi 
+     * belonging to it.
+     * 
+     * @param sys the system to solve
+     * @param recalculate functor which updates the systems residual and jacobi for the current parameters
+     * @return int the stop reason: 1 success, 2 gradient vanished, 3 trust region collapsed, 
+     *             4 maximal iterations reached, 6 diverged
+     */
+    template<typename Functor>
+    int solve(LinearSystem<Kernel>& sys, Functor& recalculate) {
+        
+        invalidateStep();
+        
+        //small dense systems are faster solved with dense factorizations
+        if(sys.isSparse())
+            return iterate(sys, recalculate, J_old);
+        
+        return iterate(sys, recalculate, J_dense);
+    };
+    
+    //the jacobi or residual changed, the next step needs a new factorization
+    void invalidateStep() {m_stepValid = false;};
+    
+private:
+    void fetchJacobi(LinearSystem<Kernel>& sys, SparseMatrixX& J) {
+        J = sys.sparseJacobi();
+    };
+    
+    void fetchJacobi(LinearSystem<Kernel>& sys, MatrixX& J) {
+        J = sys.jacobi();
+    };
+    
+    template<typename Functor, typename Matrix>
+    int iterate(LinearSystem<Kernel>& sys, Functor& recalculate, Matrix& J) {
+        
+        clock_t start = clock();
+        
+        iter = 0; stop = 0; reduce = 0; unused = 0;
+        delta = 5; nu = 2;
+        
+        recalculate();
+        
+        F_old = sys.residuals();
+        fetchJacobi(sys, J);
+        err   = 0.5*F_old.squaredNorm();
+        g     = J.transpose()*F_old;
+
+        // get the infinity norm fx_inf and g_inf
+        g_inf  = g.template lpNorm<Eigen::Infinity>();
+        fx_inf = F_old.template lpNorm<Eigen::Infinity>();
+
+        const Scalar diverging_lim = 1e6*err + 1e12;
+        bool valid = true; //does the system hold the values of the current parameters?
+        
+        while(!stop) {
+
+            // check if finished
+            if(fx_inf <= tolf)  // Success
+                stop = 1;
+            else if(g_inf <= tolg)
+                stop = 2;
+            else if(delta <= tolx)
+                stop = 3;
+            else if(iter >= maxIterations)
+                stop = 4;
+            else if(err > diverging_lim || err != err)   // check for diverging and NaN
+                stop = 6;
+
+            // see if we are already finished
+            if(stop)
+                break;
+
+            //get the update step
+            calculateStep(g, J, F_old, h_dl, delta);
+
+            // calculate the linear model
+            const Scalar dL = err - 0.5*(F_old + J*h_dl).squaredNorm();
+
+            // get the new values
+            sys.parameter() += h_dl;
+            recalculate();
+
+            //calculate the update ratio
+            const Scalar err_new = 0.5*sys.residuals().squaredNorm();
+            const Scalar dF = err - err_new;
+            const Scalar rho = (dF>0 && dL>0) ? dF/dL : Scalar(-1);
+
+            // update delta
+            if(rho>0.75) {
+                delta = std::max(delta,3*h_dl.norm());
+                nu = 2;
+            } else if(rho < 0.25) {
+                delta = delta/nu;
+                nu = 2*nu;
+            }
+
+            if(dF > 0 && dL > 0) {
+
+                F_old = sys.residuals();
+                fetchJacobi(sys, J);
+                err   = err_new;
+                g     = J.transpose()*F_old;
+
+                // get infinity norms
+                g_inf  = g.template lpNorm<Eigen::Infinity>();
+                fx_inf = F_old.template lpNorm<Eigen::Infinity>();
+                valid  = true;
+                invalidateStep();
+            } else {
+                sys.parameter() -= h_dl;
+                valid = false;
+                unused++;
+            }
+
+            iter++;
+        }
+        
+        //the last step may have been rejected, make sure the system values fit the parameters
+        if(!valid)
+            recalculate();
+        
+        time = (Scalar(clock()-start) * 1000.) / Scalar(CLOCKS_PER_SEC);
+        counter++;
+
+#ifdef DCM_USE_LOGGING
+        BOOST_LOG_SEV(log, solving) <<"Done solving: "<<err<<", iter: "<<iter<<", unused: "<<unused<<", reason:"<< stop;
+#endif
+        return stop;
+    };
+};
+
+/**
+ * @brief Levenberg-Marquardt solver with adaptive damping and geodesic acceleration
+ * 
+ * The damping is adapted by the gain ratio after Nielsen, which allows big steps as long as the linear 
+ * model fits well and quickly falls back to gradient like steps otherwise. Additionally the step is 
+ * corrected by the geodesic acceleration (Transtrum, Sethna), which approximates the second directional 
+ * derivative of the residual along the step with a single additional residual evaluation. This enables 
+ * much longer steps along curved valleys, which are typical for badly scaled and nearly singular systems.
+ * 
+ * Dense systems are solved with the dense jacobi, sparse ones with the sparse jacobi and factorization.
+ * The solver keeps its statistics after solving: \a iter for the iterations, \a evaluations for the 
+ * amount of residual/jacobi recalculations, \a unused for the rejected steps and \a accelerated for the 
+ * steps which used the geodesic acceleration.
+ */
+template<typename Kernel>
+struct LevenbergMarquardt {
 
-    template <typename Derived, typename Derived2, typename Derived3, typename Derived4>
-    void calculateStep(const Eigen::MatrixBase<Derived>& g, const Eigen::MatrixBase<Derived3>& jacobi,
-                       const Eigen::MatrixBase<Derived4>& residual, Eigen::MatrixBase<Derived2>& h_dl,
-                       const double delta);
+#ifdef DCM_USE_LOGGING
+    dcm_logger log;
+#endif
 
-    int solve(typename Kernel::MappedEquationSystem& sys);
+    typedef typename Kernel::Scalar                  Scalar;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic,
+                Eigen::Dynamic>                      MatrixX;
+    typedef Eigen::SparseMatrix<Scalar>              SparseMatrixX;
+    
+    Scalar tolg, tolx, tolf, tau, mu, nu, g_inf, fx_inf, err, time;
+    Scalar geodesicStep;   //finite difference step for the second directional derivative
+    Scalar geodesicRatio;  //maximal allowed ratio 2|a|/|v| of acceleration and velocity
+    bool   geodesic;       //use the geodesic acceleration
+    Kernel* m_kernel;
+    int iter, stop, unused, evaluations, accelerated, counter, maxIterations;
+    VectorX h, v, a, F_old, r_vv, g;
+    SparseMatrixX J_sparse;
+    MatrixX J_dense;
+    NormalEquations<Kernel> m_normal;
 
+    LevenbergMarquardt(Kernel* k) : LevenbergMarquardt() {
+        m_kernel = k;
+    };
+    
+    LevenbergMarquardt() : tolg(1e-40), tolx(1e-20), tolf(1e-10), tau(1e-3), mu(0), nu(2), g_inf(0), fx_inf(0),
+                           err(0), time(0), geodesicStep(0.1), geodesicRatio(0.75), geodesic(true), 
+                           m_kernel(nullptr), iter(0), stop(0), unused(0), evaluations(0), accelerated(0), 
+                           counter(0), maxIterations(10000) {};
+                           
+    /**
+     * @brief Solve the system
+     * 
+     * Iterates until the residual is small enough or one of the other stop criteria is reached. After 
+     * returning the system holds the parameters of the best solution found and the residual and jacobi 
+     * belonging to it.
+     * 
+     * @param sys the system to solve
+     * @param recalculate functor which updates the systems residual and jacobi for the current parameters
+     * @return int the stop reason: 1 success, 2 gradient vanished, 3 step got too small, 
+     *             4 maximal iterations reached, 6 diverged
+     */
     template<typename Functor>
-    int solve(typename Kernel::MappedEquationSystem& sys, Functor& rescale);*/
+    int solve(LinearSystem<Kernel>& sys, Functor& recalculate) {
+        
+        if(sys.isSparse())
+            return iterate(sys, recalculate, J_sparse);
+        
+        return iterate(sys, recalculate, J_dense);
+    };
+    
+private:
+    void fetchJacobi(LinearSystem<Kernel>& sys, SparseMatrixX& J) {
+        J = sys.sparseJacobi();
+    };
+    
+    void fetchJacobi(LinearSystem<Kernel>& sys, MatrixX& J) {
+        J = sys.jacobi();
+    };
+    
+    //the biggest diagonal entry of J^T J, the squared norm of the longest column
+    Scalar maxColumnNorm(const SparseMatrixX& J) {
+        Scalar max = 0;
+        for(int i=0; i<J.outerSize(); ++i)
+            max = std::max(max, J.col(i).squaredNorm());
+        return max;
+    };
+    
+    Scalar maxColumnNorm(const MatrixX& J) {
+        return J.size() ? J.colwise().squaredNorm().maxCoeff() : Scalar(0);
+    };
+    
+    template<typename Functor, typename Matrix>
+    int iterate(LinearSystem<Kernel>& sys, Functor& recalculate, Matrix& J) {
+        
+        clock_t start = clock();
+        
+        iter = 0; stop = 0; unused = 0; evaluations = 0; accelerated = 0;
+        
+        recalculate();
+        ++evaluations;
+        
+        F_old = sys.residuals();
+        fetchJacobi(sys, J);
+        err   = 0.5*F_old.squaredNorm();
+        g     = J.transpose()*F_old;
+        
+        g_inf  = g.template lpNorm<Eigen::Infinity>();
+        fx_inf = F_old.template lpNorm<Eigen::Infinity>();
+        
+        mu = tau * std::max(maxColumnNorm(J), Scalar(1));
+        nu = 2;
+        
+        const Scalar diverging_lim = 1e6*err + 1e12;
+        bool valid = true; //does the system hold the values of the current parameters?
+        
+        while(!stop) {
+            
+            // check if finished
+            if(fx_inf <= tolf)  // Success
+                stop = 1;
+            else if(g_inf <= tolg)
+                stop = 2;
+            else if(iter >= maxIterations)
+                stop = 4;
+            else if(err > diverging_lim || err != err)   // check for diverging and NaN
+                stop = 6;
+
+            if(stop)
+                break;
+            
+            iter++;
+            
+            //the damped gauss newton step is the velocity of the geodesic path
+            if(!m_normal.factorize(J, mu) || !m_normal.solve(J, F_old, v)) {
+                mu *= nu; 
+                nu *= 2;
+                unused++;
+                continue;
+            }
+            
+            if(v.norm() <= tolx*(sys.parameter().norm() + tolx)) {
+                stop = 3;
+                break;
+            }
+            
+            h = v;
+            if(geodesic) {
+                
+                //second directional derivative along v by finite differences
+                sys.parameter() += geodesicStep*v;
+                recalculate();
+                ++evaluations;
+                sys.parameter() -= geodesicStep*v;
+                valid = false;
+                
+                r_vv = (Scalar(2)/geodesicStep) * ((sys.residuals() - F_old)/geodesicStep - J*v);
+                
+                //the acceleration is calculated with the already factorized normal matrix
+                if(m_normal.solve(J, r_vv, a)) {
+                    
+                    //a to big acceleration means the step leaves the region where the quadratic model holds
+                    if(2*a.norm() > geodesicRatio*v.norm()) {
+                        mu *= nu; 
+                        nu *= 2;
+                        unused++;
+                        continue;
+                    }
+                    h += Scalar(0.5)*a;
+                    ++accelerated;
+                }
+            }
+            
+            // calculate the linear model
+            const Scalar dL = err - 0.5*(F_old + J*h).squaredNorm();
+            
+            sys.parameter() += h;
+            recalculate();
+            ++evaluations;
+            
+            const Scalar err_new = 0.5*sys.residuals().squaredNorm();
+            const Scalar dF = err - err_new;
+            
+            if(dF > 0 && dL > 0) {
+                
+                //adapt the damping to the gain ratio
+                const Scalar rho = dF/dL;
+                mu *= std::max(Scalar(1)/Scalar(3), Scalar(1) - std::pow(2*rho - 1, 3));
+                nu  = 2;
+                
+                F_old = sys.residuals();
+                fetchJacobi(sys, J);
+                err   = err_new;
+                g     = J.transpose()*F_old;
+                
+                g_inf  = g.template lpNorm<Eigen::Infinity>();
+                fx_inf = F_old.template lpNorm<Eigen::Infinity>();
+                valid  = true;
+            } else {
+                sys.parameter() -= h;
+                mu *= nu; 
+                nu *= 2;
+                valid = false;
+                unused++;
+            }
+        }
+        
+        //the last evaluation may belong to a rejected or probing step, make sure the system values fit
+        if(!valid) {
+            recalculate();
+            ++evaluations;
+        }
+        
+        time = (Scalar(clock()-start) * 1000.) / Scalar(CLOCKS_PER_SEC);
+        counter++;
+        
+#ifdef DCM_USE_LOGGING
+        BOOST_LOG_SEV(log, solving) <<"Done solving: "<<err<<", iter: "<<iter<<", evaluations: "<<evaluations
+                                    <<", reason:"<< stop;
+#endif
+        return stop;
+    };
 };
 
 struct DummyKernel : public numeric::KernelBase {
@@ -242,7 +1279,24 @@ struct Eigen3Kernel : public numeric::KernelBase {
 
     //the number type we use throughout the system
     typedef NumericType   Scalar;
-
+    
+    //the nonlinear solver used to solve the systems
+    typedef Nonlinear< Eigen3Kernel<Scalar, Nonlinear> > NonlinearSolver;
+    
+    /**
+     * @brief Solve the given system with the kernels nonlinear solver
+     * 
+     * @param sys the system to solve
+     * @param recalculate functor which updates the systems residual and jacobi for the current parameters
+     * @return int the solvers stop reason
+     */
+    template<typename Functor>
+    int solve(numeric::LinearSystem<Eigen3Kernel>& sys, Functor& recalculate) {
+        return m_solver.solve(sys, recalculate);
+    };
+    
+    //access the solver to setup tolerances or to query the solving statistics
+    NonlinearSolver& solver() {return m_solver;};
 
 private:
     Nonlinear< Eigen3Kernel<Scalar, Nonlinear> > m_solver;
@@ -75,6 +75,79 @@ private:
     Scalar  m_storage;
 };
 
+/**
+ * @brief Local storage of a \ref MapMatrix
+ * 
+ * Separate base class to ensure the storage is constructed before the map which points to it
+ */
+template<typename Matrix>
+struct MapMatrixStorage {
+    
+    typedef Eigen::Matrix<typename Matrix::Scalar, Matrix::RowsAtCompileTime, Matrix::ColsAtCompileTime, 
+                          Eigen::DontAlign | (Matrix::Options & Eigen::RowMajor)> Local;
+    
+    MapMatrixStorage() {};
+    
+    template<typename Derived>
+    MapMatrixStorage(const Eigen::MatrixBase<Derived>& val) : m_local(val) {};
+    
+    Local m_local;
+};
+
+/**
+ * @brief Fixed size Eigen matrix which can be redirected to external memory
+ * 
+ * The matrix version of \ref MapType. By default it behaves like a normal Eigen matrix with its own
+ * storage, but it can be redirected to any external memory with \ref mapTo. Afterwards all reads and 
+ * writes go to this memory, no copy is involved. This allows geometry storages to alias the parameter 
+ * vector of the linear system directly. 
+ * 
+ * As for \ref MapType copies always hold their own storage with the current values, and assignments
+ * write the values to wherever the matrix is mapped to.
+ * 
+ * \tparam Matrix The fixed size Eigen matrix type to represent
+ */
+template<typename Matrix>
+struct MapMatrix : private MapMatrixStorage<Matrix>, public Eigen::Map<Matrix> {
+    
+    typedef MapMatrixStorage<Matrix>    Storage;
+    typedef Eigen::Map<Matrix>          Base;
+    typedef typename Matrix::Scalar     Scalar;
+    
+    MapMatrix() : Base(Storage::m_local.data()) {};
+    //copy the values the matrix points to, not its local storage which is stale if it is mapped
+    MapMatrix(const MapMatrix& val) : Storage(static_cast<const Base&>(val)), Base(Storage::m_local.data()) {};
+    
+    template<typename Derived>
+    MapMatrix(const Eigen::MatrixBase<Derived>& val) : Storage(val), Base(Storage::m_local.data()) {};
+    
+    MapMatrix& operator=(const MapMatrix& val) {
+        Base::operator=(val);
+        return *this;
+    };
+    
+    template<typename Derived>
+    MapMatrix& operator=(const Eigen::DenseBase<Derived>& val) {
+        Base::operator=(val);
+        return *this;
+    };
+    
+    //allow to redirect the mapping
+    void mapTo(Scalar* pointer) {
+        new(static_cast<Base*>(this)) Base(pointer);
+    };
+    
+    //redirect the map to the internal storage, the current values are kept
+    void mapLocal() {
+        Storage::m_local = *this;
+        new(static_cast<Base*>(this)) Base(Storage::m_local.data());
+    };
+    
+    bool isMapped() const {
+        return Base::data() != Storage::m_local.data();
+    };
+};
+
 }//details
 
 }//dcm
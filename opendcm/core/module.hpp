@@ -114,11 +114,7 @@ struct ModuleCoreInit {
 #ifdef DCM_USE_LOGGING
         stop_log(sink);
 #endif
-        /*
-        //delete all reduction nodes
-        int size = std::pow(mpl::size<typename Final::GeometryList>::value, 2);
-        for(int i=0; i<size; ++i)
-            delete reduction(i);*/
+        //the reduction trees are shared by all systems, see symbolic::ReductionTable
     };
 
 #ifdef DCM_USE_LOGGING
@@ -140,10 +136,14 @@ struct ModuleCoreInit {
     typedef mpl::vector3<Distance, Orientation, Angle>  ConstraintList;
 
 protected:
-    typedef mpl::vector<symbolic::ResultProperty<Kernel>>       EdgeProperties;
+    typedef mpl::vector<symbolic::ResultProperty>               EdgeProperties;
     typedef mpl::vector<symbolic::ConstraintProperty>           GlobalEdgeProperties;
     typedef mpl::vector<symbolic::GeometryProperty>             VertexProperties;
     typedef mpl::vector0<>                                      ClusterProperties;
+    
+    //modules setup the reducer, e.g. its degree of freedom counting, and call down the stack first
+    template<typename Reducer>
+    void setupReducer(Reducer&) {};
 
     /*
     template<template<class, bool> class G1, template<class, bool> class G2, typename PC>
@@ -252,9 +252,10 @@ struct ModuleCoreFinish : public Stacked {
         const static long value = type::value;
     };
     
-    template<template<class> class G>
+    //index of a geometry type as registered in the GeometryList, e.g. geometry::Point3<Kernel>
+    template<typename G>
     struct geometryIndex {
-        typedef typename initGeometryIndex<G<Kernel>>::type type; 
+        typedef typename initGeometryIndex<G>::type type; 
         const static long value = type::value;
     };
    
@@ -271,12 +272,7 @@ struct ModuleCoreFinish : public Stacked {
     
     typedef graph::ClusterGraph<typename Stacked::EdgeProperties, typename Stacked::GlobalEdgeProperties,
             typename Stacked::VertexProperties, typename Stacked::ClusterProperties> Graph;
-         
-    using Stacked::reduction;
-    
-        
 
-            
     /**
      * @brief Solves the constraint geometry system 
      * 
@@ -286,11 +282,80 @@ struct ModuleCoreFinish : public Stacked {
         
         //All graph manipulation work has been done, from here on we only access the graph. 
         //Next find all connected components and build the numeric solving system based on them
-        solver::createSolvableSystem(std::static_pointer_cast<Graph>(this->getGraph()), reduction);
+        std::unique_ptr<shedule::Executable> ex(
+            solver::createSolvableSystem<Final>(std::static_pointer_cast<Graph>(this->getGraph()), reducer()));
+        ex->execute();
                 
         //post process the finished calculation
         
     };
+    
+    /**
+     * @brief Solves only the parts of the system which changed since the last call
+     * 
+     * The numeric systems of all components are kept between calls and only components with changed 
+     * geometries or constraints are rebuilt and solved, see \ref solver::IncrementalSystem.
+     */
+    void solveIncremental() {
+        
+        if(!m_incremental)
+            m_incremental.reset(new solver::IncrementalSystem<Final, Graph>());
+        
+        std::unique_ptr<shedule::Executable> ex(
+            m_incremental->update(std::static_pointer_cast<Graph>(this->getGraph()), reducer()));
+        ex->execute();
+    };
+    
+    /**
+     * @brief Solves many variants of the system, e.g. for parametric sweeps
+     * 
+     * All variants share the structure of the system, only the values of geometries and constraints 
+     * differ. Hence the graph is reduced and the numeric systems are build only once, like in 
+     * \ref solveIncremental, and every variant only loads its values into them. This also reuses the 
+     * sparsity analysis of the nonlinear solvers for all variants. The variants are applied to the systems
+     * geometries and constraints, therefore they are solved one after another, each with all components
+     * and blocks concurrently in a own tbb::task_arena.
+     * 
+     * @param variants the number of variants to solve
+     * @param setup called with the variant index before it is solved, must set the values of the variant 
+     *              without adding or removing geometries or constraints
+     * @param collect called with the variant index after it was solved, e.g. to read the results
+     * @param concurrency the maximal amount of threads used for solving
+     */
+    template<typename Setup, typename Collect>
+    void solveBatch(int variants, Setup setup, Collect collect, int concurrency = tbb::task_arena::automatic) {
+        
+        if(!m_incremental)
+            m_incremental.reset(new solver::IncrementalSystem<Final, Graph>());
+        
+        tbb::task_arena arena(concurrency);
+        arena.execute([&]() {
+            
+            //only build the systems, the first variant solves them 
+            std::unique_ptr<shedule::Executable> build(
+                m_incremental->update(std::static_pointer_cast<Graph>(this->getGraph()), reducer()));
+            for(int i=0; i<variants; ++i) {
+                setup(i);
+                std::unique_ptr<shedule::Executable> ex(m_incremental->reload());
+                ex->execute();
+                collect(i);
+            }
+        });
+    };
+    
+protected:
+    //the reducer is created on first use, as the Final system type is not complete before
+    symbolic::Reducer<Final>& reducer() {
+        if(!m_reducer) {
+            m_reducer.reset(new symbolic::Reducer<Final>());
+            this->setupReducer(*m_reducer);
+        }
+        return *m_reducer;
+    };
+    
+private:
+    std::unique_ptr<symbolic::Reducer<Final>>                m_reducer;
+    std::unique_ptr<solver::IncrementalSystem<Final, Graph>> m_incremental;
 };
 
 
@@ -29,112 +29,38 @@
 #include "utilities.hpp"
 
 #include <boost/multi_array.hpp>
+#include <boost/functional/hash.hpp>
+#include <tbb/concurrent_hash_map.h>
 #include <unordered_map>
+#include <algorithm>
+#include <functional>
 #include <typeindex>
+#include <atomic>
                 
 
 namespace dcm {
 namespace symbolic {
    
 
+namespace reduction {
+struct TreeWalker;
+}
+
 /**
- * @brief Structure to setup the numeric solver from reduction results
- *
- * This struct is the entry point for the numeric solver setup. It has all the functions needed to get the
- * numeric geometries and constraints.
+ * @brief The reduction result of a local edge
+ * 
+ * Holds the walker of the accepted reduction path after its equations have been created, hence it 
+ * owns the numeric geometries and equations of the edge.
  */
-template<typename Kernel>
-struct Reduction {
-    
-    typedef shedule::FlowGraph::Node  Node;
-    typedef std::shared_ptr<numeric::Calculatable<Kernel>> CalcPtr;
-    
-    //returns how many parameters are saved when the reduced version is used
-    int parameterReduction() {
-        return m_paramReduction;
-    }
-    
-    //this function is used to create a default numeric geometry for the given symbolic one.
-    virtual CalcPtr createGeometry(symbolic::Geometry& geometry) = 0;
-     
-    //this function creates a default numeric geometry equation and a node for it in the 
-    //corresponding flow graph
-    virtual std::pair< CalcPtr, Node>
-    createGeometryNode(symbolic::Geometry& geometry, shedule::FlowGraph& flowgraph) = 0;
-    
-    //this function creates a reduced numeric geometry equation. For this the equation it depends on 
-    //is required
-    virtual CalcPtr createReducedGeometry(symbolic::Geometry& geometry, CalcPtr basegeometry) = 0;
-     
-    //this function is used to create a reduced numeric geometry equation and a node for it in the 
-    //corresponding flow graph. For this the equation it depends on is required
-    virtual std::pair< CalcPtr, Node>
-    createReducedGeometryNode(symbolic::Geometry& geometry, CalcPtr basegeometry,
-                              shedule::FlowGraph& flowgraph) = 0;
-    
-    //this function is used to create all default constraint equations
-    virtual std::vector<CalcPtr>
-    createEquations(CalcPtr g1, CalcPtr g2) = 0;
-                       
-    //this function is used to create a node in the calculation flow graph with all remaining
-    //constraint Equations
-    virtual std::pair<std::vector<CalcPtr>, Node>
-    createEquationsNode(CalcPtr g1, CalcPtr g2, shedule::FlowGraph& flow) = 0;
-
-    //this function is used to create all default constraint equations
-    virtual std::vector<CalcPtr>
-    createReducedEquations(CalcPtr g1, CalcPtr g2) = 0;
-                       
-    //this function is used to create a node in the calculation flow graph with all remaining
-    //constraint Equations
-    virtual std::pair<std::vector<CalcPtr>, Node>
-    createReducedEquationsNode(CalcPtr g1, CalcPtr g2, shedule::FlowGraph& flow) = 0;
-    
-protected:
-    CalcPtr              m_geometryEquation;
-    std::vector<CalcPtr> m_residualEquations;
-    
-    int m_paramReduction; // the amount of degrees of freedom reduced by this reduction
-};
-
-template<typename Kernel>
 struct ResultProperty {
-    typedef Reduction<Kernel>* type;
+    typedef std::shared_ptr<reduction::TreeWalker> type;
     struct default_value {
-        Reduction<Kernel>* operator()() {
-            return nullptr;
+        type operator()() {
+            return type();
         };
     };
 };
 
-template<typename Kernel, template<class> class G1, template<class> class G2>
-struct GeometryReductionResult : public Reduction<Kernel> {
-    /*
-    typedef typename Final::Kernel      Kernel;
-    typedef shedule::FlowGraph::Node    Node;
-
-
-    virtual numeric::GeomertyEquation<Kernel>* createGenericGeometry(Geometry& geom) {
-
-        if(geom.type == Final::template primitiveGeometryIndex<G1>::value)
-            return new numeric::Geometry<Kernel, G1>();
-
-        else
-            return new numeric::Geometry<Kernel, G2>();
-    };
-
-    virtual std::pair<std::vector<numeric::Equation<Kernel>*>, Node>
-                                        setupGenericEquations(numeric::GeomertyEquation<Kernel>* g1,
-                                                              numeric::GeomertyEquation<Kernel>* g2,
-                                                              shedule::FlowGraph& flow) {
-
-        std::vector<numeric::Equation<Kernel>*> vec;
-    };
-    */
-protected:
-    std::vector<symbolic::Constraint*>  ConstraintPool; //all available constraints
-};
-
 /**
  * @brief The tree structure used for Constrain reduction
  * 
@@ -142,14 +68,89 @@ protected:
  */
 namespace reduction {
 
-//TODO: Currently the geometry equations are created during traversal. This is highly inefficient: 
-//      for one it means creating and destroying many unused equations during traversal, and on the
-//      other side means when creating a flowgraph node only the virtual execute is available, 
-//      resulting in 2 virtual calls for one execution instead of minimal 1. Solution is simple: 
-//      split node action from traversal and store the node in the TreeWalker. Than the walker can 
-//      call the creation method of the node when requested and with a flowgraph argument
-    
 struct Edge;
+struct Node;
+
+/**
+ * @brief Hash consing of the equations created during reduction
+ * 
+ * Many constraints often act on the same geometry, and every edge reduction would create its own 
+ * numeric geometry and transformation chain for it even though they all calculate the same value. 
+ * This cache identifies equations structurally by their type and the identity of their inputs, hence
+ * a equation which was already created for another edge is reused and calculated only once in the 
+ * flow graph.
+ * 
+ * Every \ref Reducer passes its cache to the walkers of all edges it reduces, the equations are requested 
+ * from it when the accepted walker creates them.
+ * 
+ * The cache only holds weak references, the equations stay owned by the reduction results. Inputs are 
+ * identified by address, for equation inputs this is safe as every cached equation keeps its inputs 
+ * alive. For root equations keyed by a symbolic geometry the cache must be cleared if geometries are 
+ * removed.
+ * 
+ * @remark \ref get is thread safe and can be used by concurrent edge reductions, \ref clear is not
+ */
+struct EquationCache {
+    
+    typedef std::vector<const void*> Inputs;
+    
+    /**
+     * @brief Returns the equation of type \a Equation for the given inputs
+     * 
+     * If no such equation exists the factory is used to create it. For concurrent requests of the 
+     * same equation the factory is called only once, all callers get the same equation.
+     */
+    template<typename Equation, typename Factory>
+    std::shared_ptr<Equation> get(const Inputs& inputs, Factory factory) {
+        
+        typename Map::accessor access;
+        m_map.insert(access, Key{std::type_index(typeid(Equation)), inputs});
+        
+        std::shared_ptr<Equation> eqn = std::static_pointer_cast<Equation>(access->second.lock());
+        if(!eqn) {
+            eqn = factory();
+            access->second = eqn;
+            ++m_created;
+        }
+        else 
+            ++m_shared;
+        
+        return eqn;
+    };
+    
+    void clear() {
+        m_map.clear();
+        m_created = 0;
+        m_shared  = 0;
+    };
+    
+    std::size_t size()          {return m_map.size();};
+    int         createdCount()  {return m_created;};
+    int         sharedCount()   {return m_shared;};
+    
+private:
+    struct Key {
+        std::type_index type;
+        Inputs          inputs;
+    };
+    
+    struct KeyHashCompare {
+        static std::size_t hash(const Key& k) {
+            std::size_t seed = k.type.hash_code();
+            boost::hash_range(seed, k.inputs.begin(), k.inputs.end());
+            return seed;
+        };
+        
+        static bool equal(const Key& k1, const Key& k2) {
+            return k1.type == k2.type && k1.inputs == k2.inputs;
+        };
+    };
+    
+    typedef tbb::concurrent_hash_map<Key, std::weak_ptr<void>, KeyHashCompare> Map;
+    
+    Map              m_map;
+    std::atomic<int> m_created{0}, m_shared{0};
+};
 
 /**
  * @brief Data structure for tree traversal
@@ -160,6 +161,103 @@ struct Edge;
  */
 struct TreeWalker {
     
+    //action of a visited node, called with the node itself to create its equations
+    typedef void (*Action)(const Node*, TreeWalker*);
+    
+    virtual ~TreeWalker() {};
+    
+    /**
+     * @brief Create the equations of the accepted path
+     * 
+     * The traversal only decides which nodes are visited, no equation is created during it. This 
+     * function executes the actions of all visited nodes in traversal order, hence every node can 
+     * rely on the equations of its predecessors. The actions are executed only once, further calls 
+     * do nothing. Afterwards the walker releases all handles to the symbolic geometries, it is kept 
+     * as reduction result longer than they may live.
+     */
+    void create() {
+        for(auto& action : m_actions)
+            action.second(action.first, this);
+        
+        m_actions.clear();
+        releaseHandles();
+    };
+    
+    void           setEquationCache(EquationCache* cache) {m_cache = cache;};
+    EquationCache* getEquationCache() {return m_cache;};
+    
+    /**
+     * @brief Creates a equation or reuses an identical one
+     * 
+     * Nodes should create all equations with this function. If the walker has a \ref EquationCache the 
+     * equation is shared with all other walkers requesting the same type for the same inputs, otherwise
+     * the factory is called directly.
+     */
+    template<typename Equation, typename Factory>
+    std::shared_ptr<Equation> createEquation(const EquationCache::Inputs& inputs, Factory factory) {
+        if(m_cache)
+            return m_cache->template get<Equation>(inputs, factory);
+        
+        return factory();
+    };
+    
+    /**
+     * @brief The edges taken in the traversal
+     * 
+     * Every node appends the index of the edge it used to further traverse the tree, hence the path 
+     * describes the taken route from the source node in traversal order.
+     */
+    const std::vector<int>& getPath() {return m_path;};
+    
+    /**
+     * @brief Replay a previously recorded path
+     * 
+     * The nodes skip checking all edges before the one given in the path whose condition only depends on
+     * the constraint signature, as it is equal for all edges using the same path. Edges with conditions
+     * on the geometry values are still checked, hence the replay takes the same path as a normal 
+     * traversal would. If the recorded edge is not valid anymore the traversal continues with the edges 
+     * after it.
+     */
+    void setReplayPath(const std::vector<int>& path) {
+        m_replay = path;
+        m_replayPosition = 0;
+    };
+    
+    bool isReplaying() {return m_replayPosition < m_replay.size();};
+    
+protected:
+    //drop all references to symbolic data, called once the equations are created
+    virtual void releaseHandles() {};
+    
+private:
+    friend struct Node;
+    
+    template<typename Derived>
+    friend struct ActionNode;
+    
+    int nextReplayEdge() {
+        return isReplaying() ? m_replay[m_replayPosition++] : -1;
+    };
+    
+    void stopReplay() {
+        m_replayPosition = m_replay.size();
+    };
+    
+    //stop the replay but allow to resume it at the returned position
+    std::size_t suspendReplay() {
+        std::size_t position = m_replayPosition;
+        stopReplay();
+        return position;
+    };
+    
+    void resumeReplay(std::size_t position) {
+        m_replayPosition = position;
+    };
+    
+    EquationCache*                              m_cache = nullptr;
+    std::vector<int>                            m_path, m_replay;
+    std::size_t                                 m_replayPosition = 0;
+    std::vector<std::pair<const Node*, Action>> m_actions;
 };
 
 struct Node;
@@ -172,11 +270,15 @@ struct Node;
  * \ref apply is used, it returns the validity of the connection. Furthermore an edge can have a own
  * behavior, an action can be executed. For this is custom class has to be derived which overrides 
  * the provided apply function.
+ * 
+ * If the condition only depends on the types and options of the edges constraints, hence on the signature
+ * used for path memoization, the edge is memoizable and its check can be skipped when a path is replayed.
  */
 struct Edge {
 
     Node* start;
     Node* end;
+    bool  memoizable = false;
 
     virtual ~Edge() {};
     
@@ -232,9 +334,10 @@ struct Node {
      *
      * \param node The node we build a connection to
      * \param edge The GeometryEdge which evaluates the condition for the transition
+     * \param memoizable True if the condition only depends on the constraint signature, see \ref Edge
      */   
     template<typename Functor>
-    void connect(Node& node, Functor func);    
+    void connect(Node& node, Functor func, bool memoizable = false);    
     
     /**
      * @brief Further traverse the tree
@@ -249,27 +352,86 @@ struct Node {
      * @return bool True if an edge for further traversing was found, false otherwise
      */
     virtual bool apply(TreeWalker* walker) {
-        for (Edge* e : m_edges) {
-            if (e->apply(walker)) {
+        
+        int replay = walker->nextReplayEdge();
+        std::size_t start = 0;
+        if(replay >= 0 && replay < int(m_edges.size())) {
+            
+            //memoizable edges before the recorded one failed for the same signature, all others must
+            //still be checked to take the same edge as a normal traversal. Their subtrees are not part
+            //of the recorded path, hence the replay is suspended meanwhile
+            const std::size_t position = walker->suspendReplay();
+            for (int i = 0; i < replay; ++i) {
+                if (!m_edges[i]->memoizable && applyEdge(walker, i))
+                    return true;
+            };
+            
+            walker->resumeReplay(position);
+            if(applyEdge(walker, replay))
+                return true;
+            
+            //the recorded edge is not valid anymore, all edges before it are already known to fail
+            start = replay + 1;
+        }
+        
+        walker->stopReplay();
+        for (std::size_t i = start; i < m_edges.size(); ++i) {
+            if (applyEdge(walker, i)) 
                 return true;
-                break;
-            }
         };
         return false;
     }; 
 
 private:
     std::vector<Edge*> m_edges;
+    
+    //a rejected edge must not leave anything of its subtree in the walker
+    bool applyEdge(TreeWalker* walker, std::size_t index) {
+        
+        const std::size_t actions = walker->m_actions.size();
+        walker->m_path.push_back(index);
+        if(m_edges[index]->apply(walker))
+            return true;
+        
+        walker->m_path.pop_back();
+        walker->m_actions.resize(actions);
+        return false;
+    };
+};
+
+/**
+ * @brief Base for nodes with an action
+ * 
+ * During traversal the node only registers its action in the walker, the equations are created when
+ * \ref TreeWalker::create is called for the accepted path. The action is dispatched statically to 
+ * Derived::create(TreeWalker*) const, hence creating the equations needs a single indirect call and 
+ * no virtual one.
+ */
+template<typename Derived>
+struct ActionNode : public Node {
+    
+    virtual bool apply(TreeWalker* walker) {
+        
+        walker->m_actions.emplace_back(this, &ActionNode::action);
+        Node::apply(walker);
+        return true;
+    };
+    
+private:
+    static void action(const Node* node, TreeWalker* walker) {
+        static_cast<const Derived*>(node)->create(walker);
+    };
 };
 
 template<typename Functor>
-void Node::connect(Node& node, Functor func) {
+void Node::connect(Node& node, Functor func, bool memoizable) {
 
     auto edge = new FunctorEdge<Functor>(func);
+    edge->memoizable = memoizable;
     connect(node, static_cast<Edge*>(edge));
 };
 template<>
-void Node::connect<Edge*>(Node& node, Edge* edge) {
+inline void Node::connect<Edge*>(Node& node, Edge* edge, bool) {
 
     edge->start = this;
     edge->end   = &node;
@@ -277,21 +439,138 @@ void Node::connect<Edge*>(Node& node, Edge* edge) {
 };
 
 //we can create the apply function of Edge only now as node must be fullydefined...
-bool Edge::apply(TreeWalker* walker) const {
+inline bool Edge::apply(TreeWalker* walker) const {
         
     end->apply(walker);
     return true;
 };
 
+/**
+ * @brief Copy the value between a numeric geometry and the symbolic geometry it represents
+ * 
+ * @param toSymbolic true to copy the numeric value into the symbolic geometry, false for the other way
+ */
+template<typename Kernel, template<class> class G>
+void transferGeometry(numeric::Calculatable<Kernel>* numeric, symbolic::Geometry* symbolic, bool toSymbolic) {
+    
+    auto n = static_cast<numeric::Geometry<Kernel, G>*>(numeric);
+    auto s = static_cast<symbolic::TypeGeometry<Kernel, G>*>(symbolic);
+    if(toSymbolic)
+        s->setPrimitiveGeometry(n->output());
+    else {
+        n->output() = s->getPrimitveGeometry();
+        n->invalidate();
+    }
+};
+
+/**
+ * @brief Copy the value of a symbolic constraint into the numeric equation created for it
+ * 
+ * \tparam Equation the numeric constraint equation, which is derived from the primitive constraint \a PC
+ */
+template<typename Kernel, typename PC, typename Equation>
+void loadConstraint(numeric::Calculatable<Kernel>* numeric, symbolic::Constraint* symbolic) {
+    static_cast<PC&>(*static_cast<Equation*>(numeric)) = 
+                    static_cast<symbolic::TypeConstraint<PC>*>(symbolic)->getPrimitveConstraint();
+};
+
+/**
+ * @brief The numeric equations created for a reduced edge
+ * 
+ * The solver builds the numeric system of a graph from the reduction results of its edges without knowing 
+ * their geometry types. This walker base gives type independent access to the numeric geometries of both 
+ * vertices and to the residual equations of all constraints which were not reduced by the tree. Edges to
+ * a cluster connect more than two geometries, their results collect the equations of all reduced geometry
+ * pairs, see \ref Reducer::reduce.
+ */
+template<typename Kernel>
+struct EquationWalker : public TreeWalker {
+    
+    typedef std::shared_ptr<numeric::Calculatable<Kernel>> Equation;
+    typedef void (*Transfer)(numeric::Calculatable<Kernel>*, symbolic::Geometry*, bool);
+    typedef void (*Load)(numeric::Calculatable<Kernel>*, symbolic::Constraint*);
+    
+    //a numeric geometry together with the function to exchange its value with the symbolic geometry
+    struct VertexGeometry {
+        Equation                   geometry;
+        Transfer                   transfer = nullptr;
+        const symbolic::Geometry*  symbolic = nullptr; //identifies the vertex only, it is never accessed
+    };
+    
+    //a residual equation together with the function to load the value of the constraint it represents
+    struct Residual {
+        Equation                     equation;
+        Load                         load;
+        const symbolic::Constraint*  symbolic; //identifies the constraint only, it is never accessed
+    };
+    
+    /**
+     * @brief The numeric geometry of one of the reduced local edges vertices
+     * 
+     * The geometry is identified by the symbolic geometry of the vertex, as the orientation of a local edge 
+     * depends on how it was accessed. Only valid after the equations are created.
+     */
+    const VertexGeometry& getVertexGeometry(const symbolic::Geometry* vertex) {
+        auto it = std::find_if(m_geometries.begin(), m_geometries.end(), 
+                               [&](const VertexGeometry& g) {return g.symbolic == vertex;});
+        dcm_assert(it != m_geometries.end());
+        return *it;
+    };
+    
+    //the numeric geometries of all geometries connected by the edge
+    const std::vector<VertexGeometry>& getVertexGeometries() {return m_geometries;};
+    
+    //the equations of all constraints which were not reduced, every one provides a single residual
+    const std::vector<Residual>& getResiduals() {return m_residuals;};
+    
+    //set the numeric geometry of the walkers own source or target geometry
+    void setWalkerGeometry(bool target, const symbolic::Geometry* vertex, Equation geometry, Transfer transfer) {
+        m_geometries.resize(2);
+        m_geometries[target].geometry = geometry;
+        m_geometries[target].transfer = transfer;
+        m_geometries[target].symbolic = vertex;
+    };
+    
+    //add the equations of annother walker, geometries already known are not added again
+    void collect(EquationWalker& walker) {
+        for(const VertexGeometry& g : walker.getVertexGeometries()) {
+            if(std::none_of(m_geometries.begin(), m_geometries.end(), 
+                            [&](const VertexGeometry& known) {return known.symbolic == g.symbolic;}))
+                m_geometries.push_back(g);
+        }
+        m_residuals.insert(m_residuals.end(), walker.getResiduals().begin(), walker.getResiduals().end());
+    };
+    
+    void addResidual(Equation eqn, const symbolic::Constraint* constraint, Load load) {
+        m_residuals.push_back({eqn, load, constraint});
+    };
+    
+private:
+    std::vector<VertexGeometry> m_geometries;
+    std::vector<Residual>       m_residuals;
+};
+
+/**
+ * @brief Walker for the reduction of a single geometry
+ * 
+ * The walker does not reference the primitive geometry directly, as it would dangle once the symbolic 
+ * geometry is removed while the walker is still held as reduction result. Instead the primitive is 
+ * resolved from the symbolic geometry on every use, which is only valid until the equations are created.
+ */
 template<typename Kernel, template<class> class Primitive>
-struct GeometryWalker : public TreeWalker {
+struct GeometryWalker : public EquationWalker<Kernel> {
     
     typedef std::shared_ptr<numeric::Equation<Kernel, Primitive<Kernel>>> Geometry;
-    typedef std::shared_ptr<numeric::Calculatable<Kernel>>                Equation;
+    typedef typename EquationWalker<Kernel>::Equation                     Equation;
+    typedef symbolic::TypeGeometry<Kernel, Primitive>                     Symbolic;
     
-    GeometryWalker(const Primitive<Kernel>& prim) : m_primitive(prim) {};
+    GeometryWalker(Symbolic* geometry) : m_symbolic(geometry) {};
  
-    const Primitive<Kernel>& getPrimitive() {return m_primitive;};
+    const Primitive<Kernel>& getPrimitive() {
+        dcm_assert(m_symbolic);
+        return m_symbolic->getPrimitveGeometry();
+    };
+    Symbolic*   getSymbolicGeometry() {return m_symbolic;};
     
     void        setGeometry(Geometry g) {m_geometry = g;};
     Geometry    getGeometry() {return m_geometry;};
@@ -299,24 +578,43 @@ struct GeometryWalker : public TreeWalker {
     void        setCummulativeInputEquation(Equation e) {m_inputEqn = e;};
     Equation    getCummulativeInputEquation() {return m_inputEqn;};
     
+protected:
+    virtual void releaseHandles() {
+        m_symbolic = nullptr;
+    };
+    
 private:
-    const Primitive<Kernel>&    m_primitive; //primitive holding the value
-    Equation                    m_inputEqn;  //cummulative input equation
-    Geometry                    m_geometry;  //numeric geometry 
+    Symbolic*   m_symbolic;  //geometry holding the primitive, valid until the equations are created
+    Equation    m_inputEqn;  //cummulative input equation
+    Geometry    m_geometry;  //numeric geometry 
 };
 
 template<typename Kernel, template<class> class SourcePrimitive, template<class> class TargetPrimitive>
 struct ConstraintWalker : public GeometryWalker<Kernel, TargetPrimitive> {
-       
-    ConstraintWalker(const SourcePrimitive<Kernel>& sprim, const TargetPrimitive<Kernel>& tprim) :
-                 GeometryWalker<Kernel, TargetPrimitive>(tprim), m_sourcePrimitive(sprim) {};
+    
+    typedef symbolic::TypeGeometry<Kernel, SourcePrimitive> SourceSymbolic;
+    
+    ConstraintWalker(SourceSymbolic* source, typename GeometryWalker<Kernel, TargetPrimitive>::Symbolic* target) :
+                 GeometryWalker<Kernel, TargetPrimitive>(target), m_source(source) {};
  
-    const SourcePrimitive<Kernel>& getSourcePrimitive() {return m_sourcePrimitive;};
+    const SourcePrimitive<Kernel>& getSourcePrimitive() {
+        dcm_assert(m_source);
+        return m_source->getPrimitveGeometry();
+    };
+    SourceSymbolic* getSourceSymbolicGeometry() {return m_source;};
     
     void setConstraintPool(std::vector<symbolic::Constraint*> c) {m_constraintPool = c;};
+    const std::vector<symbolic::Constraint*>& getConstraintPool() {return m_constraintPool;};
+    
+protected:
+    virtual void releaseHandles() {
+        GeometryWalker<Kernel, TargetPrimitive>::releaseHandles();
+        m_source = nullptr;
+        m_constraintPool.clear();
+    };
     
 private:
-    const SourcePrimitive<Kernel>&      m_sourcePrimitive; //primitive holding the value of the source
+    SourceSymbolic*                     m_source;          //geometry holding the source primitive
     std::vector<symbolic::Constraint*>  m_constraintPool;  //all the constraints we want to reduce
 };
 
@@ -331,23 +629,25 @@ private:
  * \tparam G      The primitive geometry to use in the calculation
  */
 template<typename Kernel, template<class> class G>
-struct GeometryNode : public Node {
+struct GeometryNode : public ActionNode<GeometryNode<Kernel, G>> {
 
-    virtual bool apply(TreeWalker* walker) {
+    void create(TreeWalker* walker) const {
     
         GeometryWalker<Kernel, G>* gwalker = static_cast<GeometryWalker<Kernel, G>*>(walker);
         
-        //create the new primitive geometry and set the initial value
-        auto geom = std::make_shared<numeric::Geometry<Kernel, G>>();       
-        geom->output() = gwalker->getPrimitive();
+        //create the new primitive geometry and set the initial value. All edges of the same geometry 
+        //share a single numeric geometry
+        const G<Kernel>& primitive = gwalker->getPrimitive();
+        auto geom = gwalker->template createEquation<numeric::Geometry<Kernel, G>>({gwalker->getSymbolicGeometry()}, [&]() {
+            auto g = std::make_shared<numeric::Geometry<Kernel, G>>();       
+            g->output() = primitive;
+            return g;
+        });
         
-        //set the new value in the walker for further processing
+        //set the new value in the walker for further processing, it is the input of derived geometries
         gwalker->setGeometry(geom);
-        
-        //further traverse the tree
-        Node::apply(walker);
-
-        return true;
+        gwalker->setCummulativeInputEquation(geom);
+        gwalker->setWalkerGeometry(true, gwalker->getSymbolicGeometry(), geom, &transferGeometry<Kernel, G>);
     }
 };
 
@@ -355,62 +655,152 @@ struct GeometryNode : public Node {
  * @brief Node for derived Geometry
  * 
  * This node handles derived geometry in the reduction tree. It takes care that the correct numeric 
- * geometry is created and that all input equations are connected correctly. 
+ * geometry is created and that all input equations are connected correctly. The derived geometry is 
+ * calculated from the cummulative input equation of the walker, which is replaced by it afterwards.
+ * 
+ * \tparam DerivedG  The numeric derived geometry, a unary equation of the cummulative input 
+ * \tparam Primitive The primitive geometry of the walker the node is used with
  */
-template<typename DerivedG>
-struct DerivedGeometryNode : public Node {
+template<typename DerivedG, template<class> class Primitive>
+struct DerivedGeometryNode : public ActionNode<DerivedGeometryNode<DerivedG, Primitive>> {
 
-    virtual bool apply(TreeWalker* walker) {
+    void create(TreeWalker* walker) const {
         
-        typedef typename DerivedG::KernelType   Kernel;
-        typedef typename DerivedG::OutputType   Primitive;
-        typedef typename DerivedG::InputType    Input;
+        typedef typename DerivedG::KernelType                           Kernel;
+        typedef numeric::Equation<Kernel, typename DerivedG::InputType> Input;
         
-        pretty(DerivedG::OutputType());
+        GeometryWalker<Kernel, Primitive>* gwalker = static_cast<GeometryWalker<Kernel, Primitive>*>(walker);
         
-        /*
-        GeometryWalker<Kernel, geometry::extractor<typename DerivedG::OutputType>::primitive>* gwalker;
-        gwalker = static_cast<GeometryWalker<Kernel, geometry::extractor<typename DerivedG::OutputType>::primitive>*>(walker);
+        //the same derived geometry of the same input is shared between all edges
+        std::shared_ptr<Input> input = std::static_pointer_cast<Input>(gwalker->getCummulativeInputEquation());
+        dcm_assert(input);
+        auto geom = gwalker->template createEquation<DerivedG>({input.get()}, [&]() {
+            auto g = std::make_shared<DerivedG>();
+            g->setInputEquation(input);
+            return g;
+        });
         
-        //create the new primitive geometry and set the initial value
-        DerivedG* geom = new DerivedG();       
-        *geom = gwalker->getPrimitive();
+        //the walker holds the derived geometry, which keeps its input alive
+        gwalker->setCummulativeInputEquation(geom);
+    }
+};
+
+/**
+ * @brief Node creating the constraint equations of an edge
+ * 
+ * It is executed after all nodes of the accepted path, hence they already removed the constraints they 
+ * reduced from the pool. The node creates the numeric source geometry and a residual equation for every 
+ * remaining constraint. The constraint is dispatched by its type id, which is its index in \a Constraints. 
+ * If the numeric constraint is only specialized for the reversed geometry order the inputs are swapped,
+ * if neither order is supported the creation_error of the numeric constraint is passed on.
+ * 
+ * \tparam Constraints sequence of all primitive constraints of the system
+ */
+template<typename Kernel, template<class> class SourceGeometry, template<class> class TargetGeometry,
+         typename Constraints>
+struct ConstraintEquationNode 
+    : public ActionNode<ConstraintEquationNode<Kernel, SourceGeometry, TargetGeometry, Constraints>> {
+
+    typedef ConstraintWalker<Kernel, SourceGeometry, TargetGeometry>        Walker;
+    typedef std::shared_ptr<numeric::Geometry<Kernel, SourceGeometry>>      Source;
+    typedef std::shared_ptr<numeric::Equation<Kernel, TargetGeometry<Kernel>>> Target;
+    
+    void create(TreeWalker* walker) const {
         
-        //set the input for our unary equation
-        geom->setInputEquation(static_cast<numeric::UnaryEquation<Kernel, Input, Primitive>>(gwalker->getCummulatedInputEquation()));
-        geom->setInputOwnership(true);
+        Walker* cwalker = static_cast<Walker*>(walker);
         
-        //set the new value in the walker for further processing
-        //note that the walker has the only shared_ptr of the equation, hence if it is a unary 
-        //equation which has ownership over the input it will be deleted and hence no double 
-        //ownership will occure
-        gwalker->setGeometry(geom);
+        //the source geometry is shared with all edges which use it, as the target geometry in GeometryNode
+        const SourceGeometry<Kernel>& primitive = cwalker->getSourcePrimitive();
+        Source source = cwalker->template createEquation<numeric::Geometry<Kernel, SourceGeometry>>(
+                                {cwalker->getSourceSymbolicGeometry()}, [&]() {
+            auto g = std::make_shared<numeric::Geometry<Kernel, SourceGeometry>>();       
+            g->output() = primitive;
+            return g;
+        });
+        cwalker->setWalkerGeometry(false, cwalker->getSourceSymbolicGeometry(), source, 
+                                   &transferGeometry<Kernel, SourceGeometry>);
+        
+        Target target = cwalker->getGeometry();
+        for(symbolic::Constraint* c : cwalker->getConstraintPool()) {
+            
+            bool created = false;
+            mpl::for_each<mpl::range_c<int, 0, mpl::size<Constraints>::value>>(
+                                    Creator{c, source, target, cwalker, created});
+            if(!created)
+                throw creation_error() <<  boost::errinfo_errno(25) 
+                                       << error_message("Constraint type is not registered in the system");
+        }
+    };
+    
+private:
+    struct Creator {
         
-        //further traverse the tree
-        Node::apply(walker);*/
+        symbolic::Constraint* constraint;
+        Source                source;
+        Target                target;
+        Walker*               walker;
+        bool&                 created;
         
-        return true;
-    }
+        template<typename I>
+        void operator()(I) const {
+            
+            if(I::value != constraint->type)
+                return;
+            
+            typedef typename mpl::at<Constraints, I>::type PC;
+            const PC& primitive = static_cast<symbolic::TypeConstraint<PC>*>(constraint)->getPrimitveConstraint();
+            typedef numeric::ConstraintSimplifiedEquation<Kernel, PC, SourceGeometry, TargetGeometry> Forward;
+            typedef numeric::ConstraintSimplifiedEquation<Kernel, PC, TargetGeometry, SourceGeometry> Backward;
+            try {
+                auto eqn = std::make_shared<Forward>();
+                static_cast<PC&>(*eqn) = primitive;
+                eqn->setInputEquations(source, target);
+                walker->addResidual(eqn, constraint, &loadConstraint<Kernel, PC, Forward>);
+            }
+            catch(creation_error&) {
+                auto eqn = std::make_shared<Backward>();
+                static_cast<PC&>(*eqn) = primitive;
+                eqn->setInputEquations(target, source);
+                walker->addResidual(eqn, constraint, &loadConstraint<Kernel, PC, Backward>);
+            }
+            created = true;
+        };
+    };
 };
 
 struct EdgeReductionTree {
 
+    virtual ~EdgeReductionTree() = default;
+
     /**
      * @brief Analyses the global edges and finds the best reduction result
      *
-     * The caller owns the returned TreeWalker pointer.
+     * The caller owns the returned TreeWalker pointer. The walker only holds the accepted path, the
+     * equations for it are created by calling TreeWalker::create().
      * 
      * @remark The function is reentrant but is not safe to be called on the same data from multiple threads
      *
      * @param g The graph the local edge belongs to
      * @param e The local edge to analyse for reduction
+     * @param cache Cache to share identical equations with other reductions, may be null
      * @return void
      */
     virtual reduction::TreeWalker* apply(symbolic::Geometry* source, symbolic::Geometry* target,
-                                         std::vector<symbolic::Constraint*> constraints) = 0;
+                                         std::vector<symbolic::Constraint*> constraints,
+                                         EquationCache* cache = nullptr) = 0;
 };
 
-template<typename Kernel, template<class> class SourceGeometry, template<class> class TargetGeometry>
+/**
+ * @brief Reduction tree for edges between two geometry types
+ * 
+ * Every accepted path ends with the \ref ConstraintEquationNode, which creates the residual equations of
+ * all not reduced constraints. Trees without constraint types only handle the geometries, they are useful
+ * to test the traversal.
+ * 
+ * \tparam Constraints sequence of all primitive constraints of the system
+ */
+template<typename Kernel, template<class> class SourceGeometry, template<class> class TargetGeometry,
+         typename Constraints = mpl::vector0<>>
 struct GeometryEdgeReductionTree : public EdgeReductionTree {
 
     typedef typename Kernel::Scalar Scalar;
@@ -427,36 +817,115 @@ struct GeometryEdgeReductionTree : public EdgeReductionTree {
 
 
     virtual reduction::TreeWalker* apply(symbolic::Geometry* source, symbolic::Geometry* target,
-                                         std::vector<symbolic::Constraint*> constraints) {
+                                         std::vector<symbolic::Constraint*> constraints,
+                                         EquationCache* cache = nullptr) {
 
         dcm_assert(source != target);
         //dcm_assert(dynamic_cast<TypeGeometry<Kernel, SourceGeometry>*>(source) != NULL);
         //dcm_assert(dynamic_cast<TypeGeometry<Kernel, SourceGeometry>*>(target) != NULL);
 
-        //get the primitive geometries
-        const SourceGeometry<Kernel>& pg1 = static_cast<TypeGeometry<Kernel, SourceGeometry>*>(source)->getPrimitveGeometry();
-        const TargetGeometry<Kernel>& pg2 = static_cast<TypeGeometry<Kernel, SourceGeometry>*>(target)->getPrimitveGeometry();
-
-        //create a new treewalker and set it up
-        auto walker = new ConstraintWalker<Kernel, SourceGeometry, TargetGeometry>(pg1, pg2);
+        //create a new treewalker and set it up, it resolves the primitive geometries when needed
+        auto walker = new ConstraintWalker<Kernel, SourceGeometry, TargetGeometry>(
+                                static_cast<TypeGeometry<Kernel, SourceGeometry>*>(source),
+                                static_cast<TypeGeometry<Kernel, TargetGeometry>*>(target));
         walker->setConstraintPool(constraints);
+        walker->setEquationCache(cache);
+        
+        //edges with the same constraints take the same path, hence if we know it we replay it 
+        Signature signature;
+        for(symbolic::Constraint* c : constraints)
+            signature.emplace_back(c->type, c->optionHash());
+        std::sort(signature.begin(), signature.end());
+        
+        {
+            typename PathMap::const_accessor access;
+            if(m_paths.find(access, signature)) {
+                walker->setReplayPath(access->second);
+                ++m_replays;
+            }
+        }
         
-        //start the calculation
+        //start the calculation and remember the path for all following edges. The constraint equations 
+        //are created last, after all nodes of the path
         getSourceNode().apply(walker);
+        m_paths.insert(std::make_pair(signature, walker->getPath()));
+        if(!mpl::empty<Constraints>::value)
+            m_equationNode.apply(walker);
+        
         return walker;
     };
     
+    //number of reductions which could replay a known path
+    int replayCount() {return m_replays;};
+    
 protected:
+    //constraint type and option hash of all constraints of an edge, sorted 
+    typedef std::vector<std::pair<int, std::size_t>> Signature;
+    
+    struct SignatureHashCompare {
+        static std::size_t hash(const Signature& s) {
+            std::size_t seed = 0;
+            for(auto& entry : s) {
+                boost::hash_combine(seed, entry.first);
+                boost::hash_combine(seed, entry.second);
+            }
+            return seed;
+        };
+        static bool equal(const Signature& s1, const Signature& s2) {
+            return s1 == s2;
+        };
+    };
+    typedef tbb::concurrent_hash_map<Signature, std::vector<int>, SignatureHashCompare> PathMap;
+    
     reduction::GeometryNode<Kernel, TargetGeometry>      m_sourceNode;
+    reduction::ConstraintEquationNode<Kernel, SourceGeometry, TargetGeometry, Constraints> m_equationNode;
     std::unordered_map<std::type_index, reduction::Node> m_nodesMap;
+    PathMap                                              m_paths;
+    std::atomic<int>                                     m_replays{0};
 };
 
 } //reduction
 
+/**
+ * @brief The reduction trees for all geometry combinations of a system type
+ * 
+ * The trees only depend on the geometry and constraint types of the system, hence a single table is 
+ * shared by all systems of the same type. It is build on first use and not changed afterwards. The trees 
+ * itself are reentrant and their path memoization is thread safe, hence they can be used by all systems
+ * concurrently.
+ */
 template<typename Final>
-struct Reducer {
+class ReductionTable {
+    
+public:
+    /**
+     * @brief The table of the system type
+     * 
+     * The table is build by the first caller, concurrent callers wait for it to be finished.
+     */
+    static const ReductionTable& instance() {
+        //initialisation of function local statics is thread safe
+        static const ReductionTable table;
+        return table;
+    };
+    
+    ~ReductionTable() {
+        for(auto it = m_treeArray.data(); it != m_treeArray.data() + m_treeArray.num_elements(); ++it)
+            delete *it;
+    };
+    
+    ReductionTable(const ReductionTable&) = delete;
+    ReductionTable& operator=(const ReductionTable&) = delete;
     
-    Reducer() {
+    /**
+     * @brief The tree reducing edges from a geometry of type index \a source to one of \a target
+     */
+    reduction::EdgeReductionTree* tree(int source, int target) const {
+        return m_treeArray[source][target];
+    };
+    
+private:
+    ReductionTable() {
     
         int size = mpl::size<typename Final::GeometryList>::type::value;
         m_treeArray.resize(boost::extents[size][size]);
@@ -471,37 +940,13 @@ struct Reducer {
         mpl::for_each<StorageRange>(r);
     };
     
-    void reduce(typename Final::Graph& g, graph::LocalEdge edge) {
-        
-        //get the geometry used in this edge
-        symbolic::Geometry* source = g->template getProperty<symbolic::GeometryProperty>(g->source(edge));
-        symbolic::Geometry* target = g->template getProperty<symbolic::GeometryProperty>(g->target(edge));
-        
-        //get the two reduction trees for this geometry combination
-        reduction::EdgeReductionTree* stTree = m_treeArray[source->type][target->type];
-        reduction::EdgeReductionTree* tsTree = m_treeArray[target->type][source->type];
-        
-        //get all constraints
-        std::vector<symbolic::Constraint*> constraints;
-        typedef typename Final::Graph::global_edge_iterator iterator;
-        std::pair<iterator, iterator> it = g->getGlobalEdges(edge);
-        for (; it.first != it.second; ++it.first)
-            constraints.push_back(g->template getProperty<symbolic::ConstraintProperty>(*it.first));
-
-        //calculate both results
-        reduction::TreeWalker* stWalker = stTree->apply(source, target, constraints);
-        reduction::TreeWalker* tsWalker = stTree->apply(target, source, constraints);
-        
-        //build the reduction and set store it in the graph. Make sure any pointer already stored is
-        //deleted properly, especially the walkers
-    };
-    
-private:
     boost::multi_array<symbolic::reduction::EdgeReductionTree*,2> m_treeArray;
        
     template<typename Sequence>
     struct ReductionTreeCreator {
     
+        typedef typename Final::Kernel Kernel;
+        
         boost::multi_array<symbolic::reduction::EdgeReductionTree*,2>& m_treeArray;
         
         ReductionTreeCreator(boost::multi_array<symbolic::reduction::EdgeReductionTree*,2>& r) 
@@ -513,21 +958,185 @@ private:
             typedef typename mpl::at<Sequence, N1>::type t1;
             typedef typename mpl::at<Sequence, N2>::type t2;
             
-            auto node1 = new symbolic::reduction::GeometryEdgeReductionTree<Final, 
+            int idx1 = Final::template geometryIndex<t1>::value;
+            int idx2 = Final::template geometryIndex<t2>::value;
+            
+            m_treeArray[idx1][idx2] = new symbolic::reduction::GeometryEdgeReductionTree<Kernel, 
                                 geometry::extractor<t1>::template primitive,
-                                geometry::extractor<t2>::template primitive >();
+                                geometry::extractor<t2>::template primitive,
+                                typename Final::ConstraintList>();
                                 
-            auto node2 = new symbolic::reduction::GeometryEdgeReductionTree<Final, 
+            //equal geometry types need a single tree only
+            if(idx1 != idx2)
+                m_treeArray[idx2][idx1] = new symbolic::reduction::GeometryEdgeReductionTree<Kernel, 
                                 geometry::extractor<t2>::template primitive,
-                                geometry::extractor<t1>::template primitive >();
+                                geometry::extractor<t1>::template primitive,
+                                typename Final::ConstraintList>();
+        };
+    };
+};
+
+template<typename Final>
+struct Reducer {
+    
+    typedef typename Final::Kernel                          Kernel;
+    typedef std::function<int(const symbolic::Geometry&)>   GeometryDof;
+    typedef std::function<int(const symbolic::Constraint&)> ConstraintDof;
+    
+    Reducer() : m_table(ReductionTable<Final>::instance()) {};
+    
+    /**
+     * @brief Reduce the given edge and store the result in its ResultProperty
+     * 
+     * Both directions of the edge are analysed and the one which reduces further, hence took the longer
+     * path through its tree, is accepted. Only for the accepted walker the equations are created.
+     * 
+     * A cluster vertex has no geometry itself, the constraints of an edge to it connect geometries within
+     * the cluster. The cluster is solved before and held fixed, hence all geometry pairs connected by the 
+     * edge are reduced on their own and the result collects all their equations.
+     * 
+     * @remark The function is reentrant and can be called for different edges from multiple threads
+     */
+    template<typename Graph>
+    void reduce(std::shared_ptr<Graph> g, graph::LocalEdge edge) {
         
-            int idx1 = Final::template geometryIndex<t1>::value;
-            int idx2 = Final::template geometryIndex<t2>::value;
+        //get all constraints
+        std::vector<symbolic::Constraint*> constraints;
+        typedef typename Graph::global_edge_iterator iterator;
+        std::pair<iterator, iterator> it = g->getGlobalEdges(edge);
+        for (; it.first != it.second; ++it.first)
+            constraints.push_back(g->template getProperty<symbolic::ConstraintProperty>(*it.first));
+        
+        if(!g->isCluster(g->source(edge)) && !g->isCluster(g->target(edge))) {
             
-            m_treeArray[idx1][idx2] = node1;
-            m_treeArray[idx2][idx1] = node2;
-        };
+            //get the geometry used in this edge
+            symbolic::Geometry* source = g->template getProperty<symbolic::GeometryProperty>(g->source(edge));
+            symbolic::Geometry* target = g->template getProperty<symbolic::GeometryProperty>(g->target(edge));
+            g->template setProperty<ResultProperty>(edge, reduce(source, target, constraints));
+            return;
+        }
+        
+        //the geometries connected by every constraint, ordered to find equal pairs
+        std::vector<std::pair<symbolic::Geometry*, symbolic::Geometry*>> geometries;
+        for(it = g->getGlobalEdges(edge); it.first != it.second; ++it.first) {
+            symbolic::Geometry* source = geometry(g, (*it.first).source);
+            symbolic::Geometry* target = geometry(g, (*it.first).target);
+            geometries.push_back(std::make_pair(std::min(source, target), std::max(source, target)));
+        }
+        
+        auto result = std::make_shared<reduction::EquationWalker<Kernel>>();
+        std::vector<bool> done(constraints.size(), false);
+        for(std::size_t i=0; i<constraints.size(); ++i) {
+            
+            if(done[i])
+                continue;
+            
+            std::vector<symbolic::Constraint*> pairConstraints;
+            for(std::size_t j=i; j<constraints.size(); ++j) {
+                if(geometries[j] == geometries[i]) {
+                    pairConstraints.push_back(constraints[j]);
+                    done[j] = true;
+                }
+            }
+            auto walker = reduce(geometries[i].first, geometries[i].second, pairConstraints);
+            result->collect(static_cast<reduction::EquationWalker<Kernel>&>(*walker));
+        }
+        g->template setProperty<ResultProperty>(edge, result);
+    };
+    
+    /**
+     * @brief The cache used to share identical equations between all reduced edges
+     */
+    reduction::EquationCache& equationCache() {return m_equationCache;};
+    
+    /**
+     * @brief Forget all shared equations
+     * 
+     * Must be called when geometries are removed, as their numeric geometries are identified by address.
+     * @remark Not thread safe, must not be called while edges are reduced
+     */
+    void clearEquationCache() {m_equationCache.clear();};
+    
+    /**
+     * @brief The reduction trees shared with all other reducers of the system type
+     */
+    const ReductionTable<Final>& reductionTable() {return m_table;};
+    
+    /**
+     * @brief Setup the degree of freedom counting used to find rigid subsystems
+     * 
+     * The core knows neither the space dimension nor the meaning of the geometry and constraint types, 
+     * hence the counting must be provided by the module defining them. Without it no rigid subsystems 
+     * are clustered, see symbolic::clusterRigidSubsystems.
+     * 
+     * @param body degrees of freedom of a rigid body, also used for cluster vertices
+     * @param geometry degrees of freedom of a single geometry
+     * @param constraint degrees of freedom removed by a single constraint
+     * @remark Not thread safe, must not be called while the graph is reduced
+     */
+    void setDofCounting(int body, GeometryDof geometry, ConstraintDof constraint) {
+        m_bodyDof       = body;
+        m_geometryDof   = geometry;
+        m_constraintDof = constraint;
+    };
+    
+    //degrees of freedom of a rigid body, 0 if no counting was setup
+    int bodyDof() {return m_bodyDof;};
+    
+    template<typename Graph>
+    int geometryDof(std::shared_ptr<Graph> g, graph::LocalVertex v) {
+        return m_geometryDof(*g->template getProperty<symbolic::GeometryProperty>(v));
+    };
+    
+    //the degrees of freedom removed by all constraints of the local edge
+    template<typename Graph>
+    int constraintDof(std::shared_ptr<Graph> g, graph::LocalEdge edge) {
+        
+        int dof = 0;
+        auto it = g->getGlobalEdges(edge);
+        for (; it.first != it.second; ++it.first)
+            dof += m_constraintDof(*g->template getProperty<symbolic::ConstraintProperty>(*it.first));
+        
+        return dof;
+    };
+    
+private:
+    //reduce the constraints between two geometries and create the equations of the accepted walker
+    std::shared_ptr<reduction::TreeWalker> reduce(symbolic::Geometry* source, symbolic::Geometry* target,
+                                                  const std::vector<symbolic::Constraint*>& constraints) {
+        
+        //get the two reduction trees for this geometry combination
+        reduction::EdgeReductionTree* stTree = m_table.tree(source->type, target->type);
+        reduction::EdgeReductionTree* tsTree = m_table.tree(target->type, source->type);
+        
+        //calculate both results
+        std::shared_ptr<reduction::TreeWalker> stWalker(stTree->apply(source, target, constraints, &m_equationCache));
+        std::shared_ptr<reduction::TreeWalker> tsWalker(tsTree->apply(target, source, constraints, &m_equationCache));
+        
+        //build the reduction. Only the walker of the used reduction needs to create its equations, the 
+        //other one is simply dropped. A previous result is released by the property when the new one is 
+        //stored, together with all equations not shared with other edges
+        std::shared_ptr<reduction::TreeWalker> walker = stWalker;
+        if(tsWalker->getPath().size() > stWalker->getPath().size())
+            walker = tsWalker;
+        
+        walker->create();
+        return walker;
     };
+    
+    //the geometry of a global vertex, which may be within a subcluster
+    template<typename Graph>
+    symbolic::Geometry* geometry(std::shared_ptr<Graph> g, graph::GlobalVertex v) {
+        auto res = g->getLocalVertexGraph(v);
+        dcm_assert(fusion::at_c<2>(res));
+        return fusion::at_c<1>(res)->template getProperty<symbolic::GeometryProperty>(fusion::at_c<0>(res));
+    };
+    
+    const ReductionTable<Final>& m_table;
+    reduction::EquationCache     m_equationCache;
+    int                          m_bodyDof = 0;
+    GeometryDof                  m_geometryDof;
+    ConstraintDof                m_constraintDof;
 };
 
 }//symbolic
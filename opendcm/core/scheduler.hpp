@@ -27,8 +27,16 @@
 
 #include "defines.hpp"
 
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
+#include <tbb/blocked_range.h>
+#include <tbb/partitioner.h>
 #include <tbb/flow_graph.h>
 
 
@@ -64,6 +72,72 @@ protected:
 };
 
 
+//functions for parallel execution
+
+/**
+ * @brief Control how a parallel loop is split into tasks
+ * 
+ * Ranges with less elements than the sequential threshold are processed directly in the calling thread, 
+ * as the task creation overhead would dominate the work. Bigger ranges are split into chunks of grainSize 
+ * elements. With a grain size of 0 the chunk size is tuned automatically by the tbb auto_partitioner.
+ */
+struct Partition {
+    
+    Partition(std::size_t grain = 0, std::size_t threshold = 16) 
+        : grainSize(grain), sequentialThreshold(threshold) {};
+    
+    std::size_t grainSize;
+    std::size_t sequentialThreshold;
+};
+
+namespace details {
+    
+template<typename Iterator, typename Functor>
+void for_each(Iterator start, Iterator end, const Functor& func, const Partition& p, 
+              std::random_access_iterator_tag) {
+    
+    if(std::size_t(std::distance(start, end)) < p.sequentialThreshold) {
+        std::for_each(start, end, func);
+        return;
+    }
+    
+    auto body = [&func](const tbb::blocked_range<Iterator>& range) {
+        for(Iterator it = range.begin(); it != range.end(); ++it)
+            func(*it);
+    };
+    if(p.grainSize == 0)
+        tbb::parallel_for(tbb::blocked_range<Iterator>(start, end), body, tbb::auto_partitioner());
+    else 
+        tbb::parallel_for(tbb::blocked_range<Iterator>(start, end, p.grainSize), body, tbb::simple_partitioner());
+};
+
+//ranges which can not be split are processed by the tbb work stealing for_each, which has no grain size
+template<typename Iterator, typename Functor>
+void for_each(Iterator start, Iterator end, const Functor& func, const Partition& p, 
+              std::forward_iterator_tag) {
+    
+    if(std::size_t(std::distance(start, end)) < p.sequentialThreshold) 
+        std::for_each(start, end, func);
+    else 
+        tbb::parallel_for_each(start, end, func);
+};
+
+} //details
+
+/**
+ * @brief Apply the functor to all elements of the range in parallel
+ * 
+ * The order of execution is undefined and the functor is called concurrently, hence it must not 
+ * access any shared mutable state without synchronisation. Random access ranges are split according to
+ * the given partition, all other ranges only respect the sequential threshold.
+ */
+template<typename Iterator, typename Functor>
+void for_each(const Iterator& start, const Iterator& end, const Functor& func, 
+              const Partition& p = Partition()) {
+    
+    details::for_each(start, end, func, p, typename std::iterator_traits<Iterator>::iterator_category());
+};
+
 /**
  * @brief Sequential execution of multiple Executables
  * 
@@ -106,20 +180,25 @@ protected:
  * 
  * This class stores different executables and processes them in parallel. Note that passed 
  * executable pointers are afterwards owned by the Vector object which delets it when destroyed.
+ * The executables must not share any mutable state, as they are processed concurrently on the 
+ * tbb thread pool. Every executable is expected to be expensive, hence each one gets its own task 
+ * and only a single executable is processed without the thread pool.
  */
 struct ParallelVector : public Vector {
     
     void operator()() {
-//         tbb::parallel_for_each(m_executables.begin(), m_executables.end(), 
-//                            [&](const tbb::blocked_range<int>& range) {
-//             for(int i=range.begin(); i!=range.end(); ++i)
-//                 m_executables[i]->execute();
-//         });
+        for_each(m_executables.begin(), m_executables.end(), 
+                 [](Executable* ex) {ex->execute();}, m_partition);
     };
     
     virtual void execute() {
         operator()();
     };
+    
+    void setPartition(const Partition& p) {m_partition = p;};
+    
+protected:
+    Partition m_partition = Partition(1, 2);
 };
 
 /**
@@ -127,32 +206,50 @@ struct ParallelVector : public Vector {
  * 
  * This class stores different executables and processes them in parallel. Note that passed 
  * executable pointers are afterwards owned by the Vector object which delets it when destroyed.
+ * In contrast to \ref ParallelVector the executables are expected to be cheap, hence they are 
+ * processed in automatically sized chunks and small vectors are executed sequentially.
  */
-struct HugeParallelVector : public Vector {
+struct HugeParallelVector : public ParallelVector {
     
-    void operator()() {
-//         tbb::parallel_for( tbb::blocked_range<int>( 1, m_executables.size()), 
-//                            [&](const tbb::blocked_range<int>& range) {
-//             for(int i=range.begin(); i!=range.end(); ++i)
-//                 m_executables[i]->execute();
-//         });
-    };
-    
-    virtual void execute() {
-        operator()();
+    HugeParallelVector() {
+        m_partition = Partition(0, 64);
     };
 };
 
-//encapsulates a tbb flow graph and is responsible for managing the nodes lifetime
+/**
+ * @brief Encapsulates a tbb flow graph and is responsible for managing the nodes lifetime
+ * 
+ * The graph is build once and can be executed as often as needed, e.g. once per solver iteration. Nodes 
+ * are allocated in chunks which are never moved, hence references returned by the node creation functions 
+ * stay valid for the lifetime of the FlowGraph. If the number of nodes is known upfront \ref reserve 
+ * allocates them in a single chunk.
+ */
 struct FlowGraph : public Executable {
        
     typedef tbb::flow::continue_node< tbb::flow::continue_msg > Node;
     typedef tbb::flow::broadcast_node<tbb::flow::continue_msg>  StartNode;
        
     FlowGraph() : m_graph(new tbb::flow::graph()) {};
-    virtual ~FlowGraph() {};
+    FlowGraph(std::size_t nodes) : FlowGraph() {
+        reserve(nodes);
+    };
+    
+    FlowGraph(const FlowGraph&) = delete;
+    FlowGraph& operator=(const FlowGraph&) = delete;
+    
+    //the nodes unregister from the graph, hence they need to be destroyed before it
+    virtual ~FlowGraph() {
+        m_graph->wait_for_all();
+        for(auto it = m_nodes.rbegin(); it != m_nodes.rend(); ++it)
+            (*it)->~Node();
+    };
     
     void operator()() {
+        
+        //a failed run leaves the graph cancelled, it would not process any message anymore
+        if(m_graph->is_cancelled())
+            reset();
+        
         m_start.try_put(tbb::flow::continue_msg());
         m_graph->wait_for_all();
     }
@@ -160,20 +257,51 @@ struct FlowGraph : public Executable {
     virtual void execute() {
         operator()();
     }
+    
+    /**
+     * @brief Restore the initial state of all nodes
+     * 
+     * A completely processed run leaves the graph ready for the next one. Only if a run was interrupted, 
+     * e.g. by an exception thrown from a node, the nodes hold partial state. This is cleared by the reset, 
+     * the nodes, their actions and connections stay as they are.
+     */
+    void reset() {
+        m_graph->reset();
+    };
+    
+    /**
+     * @brief Preallocate storage for the given amount of nodes
+     * 
+     * Only the storage is allocated, no node is created. 
+     */
+    void reserve(std::size_t nodes) {
+        
+        if(nodes <= m_nodes.size())
+            return;
+        
+        const std::size_t required = nodes - m_nodes.size();
+        if(m_chunkCapacity - m_chunkUsed < required)
+            newChunk(required);
+        
+        m_nodes.reserve(nodes);
+    };
+    
+    std::size_t size() {return m_nodes.size();};
         
     template<typename Action>
     Node& newActionNode(Action a) {
         
-        m_nodes.emplace_back(Node(*m_graph, a));
-        return m_nodes.back();
+        Node* node = new(allocate()) Node(*m_graph, a);
+        m_nodes.push_back(node);
+        return *node;
     };
     
     template<typename Action>
     Node& newInitialActionNode(Action a) {
         
-        m_nodes.emplace_back(Node(*m_graph, a));
-        connect(m_start, m_nodes.back());
-        return m_nodes.back();
+        Node& node = newActionNode(a);
+        connect(m_start, node);
+        return node;
     };
     
     StartNode& getBroadcastNode() {        
@@ -186,16 +314,27 @@ struct FlowGraph : public Executable {
     };
 
 private:
-    std::vector<Node>                 m_nodes;
-    std::unique_ptr<tbb::flow::graph> m_graph;
-    StartNode                         m_start = StartNode(*m_graph);
-};
+    typedef std::aligned_storage<sizeof(Node), alignof(Node)>::type NodeStorage;
+    static const std::size_t ChunkSize = 32;
     
-//functions for parallel execution
-
-template<typename Iterator, typename Functor>
-void for_each(const Iterator& start, const Iterator& end, const Functor& func) {
-    //tbb::parallel_for_each(start, end, func);
+    std::vector<std::unique_ptr<NodeStorage[]>> m_chunks;
+    std::size_t                                 m_chunkCapacity = 0, m_chunkUsed = 0;
+    std::vector<Node*>                          m_nodes;
+    std::unique_ptr<tbb::flow::graph>           m_graph;
+    StartNode                                   m_start = StartNode(*m_graph);
+    
+    void newChunk(std::size_t size) {
+        m_chunks.emplace_back(new NodeStorage[size]);
+        m_chunkCapacity = size;
+        m_chunkUsed = 0;
+    };
+    
+    void* allocate() {
+        if(m_chunkUsed == m_chunkCapacity)
+            newChunk(ChunkSize);
+        
+        return &m_chunks.back()[m_chunkUsed++];
+    };
 };
 
 } //details
@@ -23,20 +23,198 @@
 #include "clustergraph.hpp"
 #include "filtergraph.hpp"
 #include "geometry.hpp"
+#include "reduction.hpp"
 #include "scheduler.hpp"
 
 #include <boost/graph/connected_components.hpp>
+#include <boost/graph/biconnected_components.hpp>
 #include <boost/graph/undirected_dfs.hpp>
 #include <boost/fusion/include/vector.hpp>
 #include <boost/fusion/include/at.hpp>
 #include <boost/multi_array.hpp>
 
+#include <tbb/task_arena.h>
+#include <tbb/enumerable_thread_specific.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+
 namespace fusion = boost::fusion;
 
 namespace dcm {
        
 namespace symbolic {
     
+/**
+ * @brief Rigid subsystems of a graph
+ * 
+ * A rigid subsystem is a set of vertices whose geometries are fully fixed relative to each other by the 
+ * constraints between them. Such a subsystem can be solved once on its own and afterwards be handled as a
+ * single rigid body in the parent system.
+ */
+struct RigidDecomposition {
+    std::vector<std::vector<graph::LocalVertex>> subsystems;
+};
+
+/**
+ * @brief Find rigid subsystems by degree of freedom counting
+ * 
+ * Subsystems are grown greedily from a seed edge. The seed is rigid if the degrees of freedom of both
+ * vertices minus the ones removed by their constraints equal the ones of a rigid body, otherwise the 
+ * triangle rule adds a third vertex which makes them rigid. Overconstrained seeds are rigid even without
+ * a third vertex. A rigid subsystem is extended by every 
+ * vertex whose degrees of freedom are fully removed by its constraints to the subsystem (closure rule). 
+ * Only subsystems which have more degrees of freedom than a rigid body and which are not the whole graph 
+ * are returned, all others gain nothing from being solved separately. Every vertex belongs to at most one 
+ * subsystem. Clusters are already collapsed, they are never part of a subsystem. Otherwise every solve 
+ * would nest the clusters of the last one into new ones.
+ * 
+ * The counting is done by the provided counter, which must implement:
+ * - int geometryDof(std::shared_ptr<Graph>, LocalVertex) for all geometry vertices
+ * - int constraintDof(std::shared_ptr<Graph>, LocalEdge) for the constraints of a local edge
+ * - int bodyDof() for the degrees of freedom of a rigid body
+ * 
+ * @note Degree of freedom counting is a necessary but not sufficient condition for rigidity, 
+ * geometrically degenerated configurations may be reported as rigid.
+ */
+template<typename Graph, typename Counter>
+RigidDecomposition findRigidSubsystems(std::shared_ptr<Graph> g, Counter& counter) {
+    
+    typedef graph::LocalVertex LocalVertex;
+    
+    const int body = counter.bodyDof();
+    auto dof = [&](LocalVertex v) {
+        return counter.geometryDof(g, v);
+    };
+    
+    std::unordered_set<LocalVertex> assigned, subsystem;
+    auto vertices = g->vertices();
+    for(; vertices.first != vertices.second; ++vertices.first) {
+        if(g->isCluster(*vertices.first))
+            assigned.insert(*vertices.first);
+    }
+    
+    //the degrees of freedom removed by all constraints between v and the current subsystem
+    auto connection = [&](LocalVertex v) {
+        int removed = 0;
+        auto edges = g->outEdges(v);
+        for(; edges.first != edges.second; ++edges.first) {
+            if(subsystem.count(g->target(*edges.first)))
+                removed += counter.constraintDof(g, *edges.first);
+        }
+        return removed;
+    };
+    
+    //all unassigned vertices adjacent to the subsystem 
+    std::vector<LocalVertex> candidates;
+    auto collectCandidates = [&](const std::vector<LocalVertex>& members) {
+        candidates.clear();
+        for(LocalVertex m : members) {
+            auto edges = g->outEdges(m);
+            for(; edges.first != edges.second; ++edges.first) {
+                LocalVertex t = g->target(*edges.first);
+                if(!assigned.count(t) && !subsystem.count(t) && 
+                    std::find(candidates.begin(), candidates.end(), t) == candidates.end())
+                    candidates.push_back(t);
+            }
+        }
+    };
+    
+    RigidDecomposition result;
+    const int vertexCount = g->vertexCount();
+    auto edges = g->edges();
+    for(; edges.first != edges.second; ++edges.first) {
+        
+        LocalVertex s = g->source(*edges.first), t = g->target(*edges.first);
+        if(assigned.count(s) || assigned.count(t))
+            continue;
+        
+        //seed the subsystem, use the triangle rule if the edge alone is not exactly a rigid body. Edges
+        //with less degrees of freedom are rigid too, but may only be a part of a rigid body like two 
+        //points with a distance, hence the triangle is prefered.
+        std::vector<LocalVertex> members = {s, t};
+        subsystem = {s, t};
+        int remaining = dof(s) + dof(t) - connection(t);
+        if(remaining != body) {
+            
+            collectCandidates(members);
+            for(LocalVertex c : candidates) {
+                const int removed = connection(c);
+                if(removed > 0 && remaining + dof(c) - removed <= body) {
+                    members.push_back(c);
+                    subsystem.insert(c);
+                    break;
+                }
+            }
+            if(members.size() == 2 && remaining > body)
+                continue;
+        }
+        
+        //the closure rule: add all vertices fully fixed by the rigid subsystem
+        bool grown = true;
+        while(grown) {
+            grown = false;
+            collectCandidates(members);
+            for(LocalVertex c : candidates) {
+                if(dof(c) - connection(c) <= 0) {
+                    members.push_back(c);
+                    subsystem.insert(c);
+                    grown = true;
+                }
+            }
+        }
+        
+        int total = 0;
+        for(LocalVertex m : members)
+            total += dof(m);
+        
+        if(total > body && int(members.size()) < vertexCount) {
+            assigned.insert(members.begin(), members.end());
+            result.subsystems.push_back(std::move(members));
+        }
+    }
+    
+    return result;
+};
+
+/**
+ * @brief Move all rigid subsystems into their own subclusters
+ * 
+ * Uses \ref findRigidSubsystems and creates a new subcluster for every found subsystem. The subclusters
+ * are solved on their own and only their rigid body is part of the parent system.
+ * 
+ * @return int the number of created subclusters
+ */
+template<typename Graph, typename Counter>
+int clusterRigidSubsystems(std::shared_ptr<Graph> g, Counter& counter) {
+    
+    RigidDecomposition decomposition = findRigidSubsystems(g, counter);
+    for(auto& subsystem : decomposition.subsystems) {
+        
+        auto cluster = g->createCluster();
+        for(graph::LocalVertex v : subsystem)
+            g->moveToSubcluster(v, cluster.second, cluster.first);
+    }
+    return decomposition.subsystems.size();
+};
+
+//only reducers which can count degrees of freedom allow to find rigid subsystems, a reducer without 
+//setup counting reports no rigid body degrees of freedom
+template<typename Graph, typename Reducer>
+auto clusterRigidSubsystems(std::shared_ptr<Graph> g, Reducer& reducer, int) 
+                            -> decltype(reducer.bodyDof(), int()) {
+    return reducer.bodyDof() > 0 ? clusterRigidSubsystems(g, reducer) : 0;
+};
+
+template<typename Graph, typename Reducer>
+int clusterRigidSubsystems(std::shared_ptr<Graph>, Reducer&, long) {
+    return 0;
+};
+    
     /**
      * @brief Reduces the Graph to the smallest possible system
      * 
@@ -45,22 +223,35 @@ namespace symbolic {
      * reductions, this means rigid subsections which are moved to their own clusters or simple
      * replacements of constraints with dependend geometry.
      * 
+     * Rigid subsections are only searched if the reducer is able to count degrees of freedom, see 
+     * \ref findRigidSubsystems for the needed interface. This is done before the edge reduction, as 
+     * moving vertices into a subcluster creates new local edges to the subcluster.
+     * 
      * It furthermore finds all disconnected components in the graph and assigns each vertex and
      * edege to the components they belong to via their group property.
+     * 
+     * The reduction of the individual edges is done in parallel. Only edges which changed since the 
+     * last reduction are processed, all others still hold a valid result. The reducer must provide a
+     * reduce(g, edge) function which only writes to the given edges ResultProperty, as it is called 
+     * concurrently for different edges.
+     * 
+     * @param changedEdges if given, receives all edges which were changed and hence got reduced
+     * @return int the number of connected components
      */    
-template<typename Final, typename Graph>
-int reduceGraph(std::shared_ptr<Graph> g, 
-                 const boost::multi_array<symbolic::reduction::EdgeReductionTree*,2>& reduction) {
-    /*
-    //start with edge analysing
+template<typename Graph, typename Reducer>
+int reduceGraph(std::shared_ptr<Graph> g, Reducer& reducer, 
+                std::vector<graph::LocalEdge>* changedEdges = nullptr) {
+    
+    clusterRigidSubsystems(g, reducer, 0);
+    
+    //continue with edge analysing. The filter iterators are not usable for parallel splitting, hence we
+    //collect the changed edges first
     auto fedges = g->template filterRange<typename Graph::edge_changed>(g->edges());
-    shedule::for_each(fedges.first, fedges.second, [&](graph::LocalEdge& e) {
-        
-        symbolic::Geometry* g1 = g->template getProperty<symbolic::GeometryProperty>(g->source(e));
-        symbolic::Geometry* g2 = g->template getProperty<symbolic::GeometryProperty>(g->target(e));
-        symbolic::EdgeReductionTree<Final>* tree = reduction[g1->type][g2->type];
-        dcm_assert(tree);
-        tree->apply(g, e); 
+    std::vector<graph::LocalEdge> local;
+    std::vector<graph::LocalEdge>& changed = changedEdges ? *changedEdges : local;
+    changed.assign(fedges.first, fedges.second);
+    shedule::for_each(changed.begin(), changed.end(), [&](graph::LocalEdge e) {
+        reducer.reduce(g, e);
         g->acknowledgeEdgeChanges(e);
     });
     
@@ -69,152 +260,821 @@ int reduceGraph(std::shared_ptr<Graph> g,
     graph::property_map<graph::Index, Graph, graph::LocalVertex> imap(g);
     graph::property_map<graph::Color, Graph, graph::LocalVertex> cmap(g);
     int c = boost::connected_components(g->getDirectAccess(), 
-                                                 gmap, boost::vertex_index_map(imap).color_map(cmap));
+                                        gmap, boost::vertex_index_map(imap).color_map(cmap));
     
     //connected components only assigns vertices, lets also assign edges to groups
     auto edges = g->edges();
-    tbb::parallel_for_each(edges.first, edges.second, [&](graph::LocalEdge& e) {
+    std::vector<graph::LocalEdge> all(edges.first, edges.second);
+    shedule::for_each(all.begin(), all.end(), [&](graph::LocalEdge e) {
         g->template setProperty<graph::Group>(e, g->template getProperty<graph::Group>(g->source(e)));
     });
     
-    return c;*/
+    return c;
 };
 
 } //symbolic
 
 namespace numeric {
   
+/**
+ * @brief Build the flow graph which recalculates all given calculatables
+ * 
+ * Every calculatable is executed after all its inputs. Inputs which are not part of the given list are added
+ * to the flow too, hence each calculatable is executed exactly once per run, no matter how many others use 
+ * it as input. For this the input ownership of all calculatables is released, the flow must therefore be 
+ * build after all of them are initialized. Calculatables which form a chain, i.e. which have a single input 
+ * only used by them, are executed within the same node to keep the scheduling overhead low. Independent 
+ * chains are processed concurrently.
+ * 
+ * All nodes are created upfront, running the flow does not allocate any memory in the dcm. 
+ * 
+ * @param fixed inputs which are not recalculated, e.g. as they belong to annother system which is not 
+ *              changed while this flow is used
+ * @return int the number of calculatables executed by the flow
+ */
+template<typename Kernel>
+int buildRecalculationFlow(const std::vector<std::shared_ptr<Calculatable<Kernel>>>& calculatables,
+                           shedule::FlowGraph& flow, 
+                           const std::unordered_set<Calculatable<Kernel>*>& fixed = {}) {
     
-template<typename Graph>
-shedule::FlowGraph buildRecalculationFlow(std::shared_ptr<Graph> g) {
+    typedef Calculatable<Kernel>         Calc;
+    typedef shedule::FlowGraph::Node     Node;
+    
+    //sort all calculatables topologically. A explicit stack is used as dependency chains may be long,
+    //the index is -1 while the inputs of a calculatable are processed.
+    std::unordered_map<Calc*, int> index;
+    std::vector<Calc*> order, inputs;
+    std::vector<std::pair<Calc*, bool>> stack;
+    for(const auto& root : calculatables) {
+        
+        stack.push_back(std::make_pair(root.get(), false));
+        while(!stack.empty()) {
+            
+            std::pair<Calc*, bool> current = stack.back();
+            stack.pop_back();
+            if(current.second) {
+                index[current.first] = order.size();
+                order.push_back(current.first);
+                continue;
+            }
+            
+            auto it = index.find(current.first);
+            if(it != index.end()) {
+                dcm_assert(it->second >= 0); //cyclic dependency
+                continue;
+            }
+            
+            index[current.first] = -1;
+            stack.push_back(std::make_pair(current.first, true));
+            inputs.clear();
+            current.first->collectInputs(inputs);
+            for(Calc* input : inputs) {
+                if(!fixed.count(input))
+                    stack.push_back(std::make_pair(input, false));
+            }
+        }
+    }
     
-//     tbb::flow::continue_node< tbb::flow::continue_msg > fg;
-//     return fg;
+    //find the chain every calculatable belongs to, the chain is identified by its first member
+    std::vector<std::vector<int>> dependencies(order.size());
+    std::vector<int> consumers(order.size(), 0);
+    for(std::size_t i=0; i<order.size(); ++i) {
+        
+        inputs.clear();
+        order[i]->collectInputs(inputs);
+        for(Calc* input : inputs) {
+            if(fixed.count(input))
+                continue;
+            
+            const int in = index[input];
+            if(std::find(dependencies[i].begin(), dependencies[i].end(), in) == dependencies[i].end()) {
+                dependencies[i].push_back(in);
+                ++consumers[in];
+            }
+        }
+        order[i]->takeInputOwnership(false);
+    }
+    
+    std::vector<int> chain(order.size());
+    std::vector<std::vector<Calc*>> members(order.size());
+    std::size_t chains = 0;
+    for(std::size_t i=0; i<order.size(); ++i) {
+        
+        const bool single = dependencies[i].size() == 1 && consumers[dependencies[i].front()] == 1;
+        chain[i] = single ? chain[dependencies[i].front()] : i;
+        members[chain[i]].push_back(order[i]);
+        if(chain[i] == int(i))
+            ++chains;
+    }
     
+    //create one node per chain, connected to the chains of the first members inputs
+    flow.reserve(flow.size() + chains);
+    std::vector<Node*> nodes(order.size(), nullptr);
+    for(std::size_t i=0; i<order.size(); ++i) {
+        
+        if(chain[i] != int(i))
+            continue;
+        
+        std::vector<Calc*> calcs;
+        calcs.swap(members[i]);
+        auto action = [calcs](const tbb::flow::continue_msg&) {
+            for(Calc* calc : calcs)
+                calc->execute();
+            return tbb::flow::continue_msg();
+        };
+        
+        if(dependencies[i].empty())
+            nodes[i] = &flow.newInitialActionNode(action);
+        else {
+            nodes[i] = &flow.newActionNode(action);
+            for(int in : dependencies[i])
+                flow.connect(*nodes[chain[in]], *nodes[i]);
+        }
+    }
+    
+    return order.size();
 };
     
 } //numeric
     
 namespace solver {
 
-template<typename Graph, typename Kernel>
-struct FlowGraphExtractor : public boost::default_dfs_visitor {
-
-    typedef typename Graph::LocalVertex         LocalVertex;
-    typedef typename Graph::LocalEdge           LocalEdge;
-    typedef typename shedule::FlowGraph::Node   Node;
+/**
+ * @brief The numeric system of a single graph component
+ * 
+ * Every component of the graph is solved independent of all others. Therefore each component owns 
+ * everything needed for the numeric solving: the \ref numeric::LinearSystem, all calculatables which are
+ * mapped into it, the recalculation flow graph and its own instance of the kernels nonlinear solver. As
+ * nothing is shared between components they can be processed concurrently, e.g. within a 
+ * \ref shedule::ParallelVector.
+ */
+template<typename Kernel>
+struct ComponentSystem : public shedule::Executable {
+    
+    typedef std::shared_ptr<numeric::Calculatable<Kernel>> CalcPtr;
+    typedef typename Kernel::NonlinearSolver               Solver;
+    
+    //the calculatables may be reused by the next system, hence they must not point into this one anymore
+    virtual ~ComponentSystem() {
+        if(m_system) {
+            for(CalcPtr& calc : m_calculatables)
+                calc->release(*m_system);
+        }
+    };
+    
+    /**
+     * @brief Create the linear system for this component
+     * 
+     * Must be called before any calculatable is initialized, as they map themself into the system.
+     */
+    void setupSystem(int parameters, int equations) {
+        setupSystem(parameters, equations, m_storage);
+    };
+    
+    void setupSystem(int parameters, int equations, numeric::JacobiStorage storage) {
+        m_system.reset(new numeric::LinearSystem<Kernel>(parameters, equations, storage));
+    };
+    
+    //the jacobi storage used when the system is setup without explicit storage request
+    void setStorage(numeric::JacobiStorage storage) {m_storage = storage;};
+    
+    //the calculatables are owned by the component, it ensures they live as long as the system
+    void addCalculatable(CalcPtr calc) {
+        m_calculatables.push_back(calc);
+    };
+    
+    //create the recalculation flow from all added calculatables, they need to be initialized already. 
+    //The fixed inputs belong to annother system and are not recalculated
+    void buildFlow(const std::unordered_set<numeric::Calculatable<Kernel>*>& fixed = {}) {
+        numeric::buildRecalculationFlow(m_calculatables, m_flow, fixed);
+    };
+    
+    //called after every solve of the system, e.g. to write the solved values back to the symbolic geometry
+    void addResultWriter(std::function<void()> writer) {
+        m_writers.push_back(writer);
+    };
+    
+    //called by \ref loadValues, e.g. to read the current value of a symbolic geometry or constraint
+    void addValueLoader(std::function<void()> loader) {
+        m_loaders.push_back(loader);
+    };
+    
+    /**
+     * @brief Load the current values of the symbolic geometries and constraints into the system
+     * 
+     * The system is build with the values at that time. Values changed afterwards without changing the 
+     * structure, e.g. for solving many variants of the same model, can be loaded into the existing system 
+     * with this function instead of building a new one. The values of all leafs are loaded too.
+     */
+    void loadValues() {
+        for(auto& loader : m_loaders)
+            loader();
+        for(Leaf& leaf : m_leafs)
+            leaf.system->loadValues();
+    };
+    
+    /**
+     * @brief Add a peeled leaf which is solved after the system it depends on
+     * 
+     * Leafs are small systems which only depend on already solved geometry, either from the core system of 
+     * this component or from another leaf. They are solved after their parent in the solving flow, leafs with 
+     * different parents concurrently. Leafs which are independent of the core (e.g. anchored at a cluster) are 
+     * solved concurrently to the core system.
+     * 
+     * @param leaf the leafs system, ownership is taken
+     * @param parent index of the leaf it depends on, -1 if it depends on the core system
+     * @param independent true if a leaf with parent -1 does not need the core system to be solved first
+     * @return int the index of the added leaf
+     */
+    int addLeaf(std::unique_ptr<ComponentSystem<Kernel>> leaf, int parent = -1, bool independent = false) {
+        
+        dcm_assert(parent < int(m_leafs.size()));
+        m_leafs.push_back(Leaf{std::move(leaf), parent, independent && parent < 0});
+        m_solveFlow.reset();
+        return m_leafs.size()-1;
+    };
+    
+    numeric::LinearSystem<Kernel>& system()       {return *m_system;};
+    shedule::FlowGraph&            flow()         {return m_flow;};
+    Solver&                        solver()       {return m_solver;};
+    int                            result()       {return m_result;};
+    bool                           hasSystem()    {return bool(m_system);};
+    int                            leafCount()    {return m_leafs.size();};
+    ComponentSystem<Kernel>&       leaf(int i)    {return *m_leafs[i].system;};
+    
+    virtual void execute() {
+        
+        if(m_leafs.empty()) {
+            solveCore();
+            return;
+        }
+        
+        if(!m_solveFlow)
+            buildSolveFlow();
+        
+        m_solveFlow->execute();
+    };
+    
+private:
+    struct Leaf {
+        std::unique_ptr<ComponentSystem<Kernel>> system;
+        int                                      parent;
+        bool                                     independent;
+    };
+    
+    std::unique_ptr<numeric::LinearSystem<Kernel>> m_system;
+    std::vector<CalcPtr>                           m_calculatables;
+    shedule::FlowGraph                             m_flow;
+    Solver                                         m_solver;
+    int                                            m_result = 0;
+    numeric::JacobiStorage                         m_storage = numeric::JacobiStorage::Sparse;
+    std::vector<Leaf>                              m_leafs;
+    std::unique_ptr<shedule::FlowGraph>            m_solveFlow;
+    std::vector<std::function<void()>>             m_writers;
+    std::vector<std::function<void()>>             m_loaders;
+    
+    void solveCore() {
+        if(!m_system) 
+            return;
+        
+        m_result = m_solver.solve(*m_system, m_flow);
+        for(auto& writer : m_writers)
+            writer();
+    };
+    
+    //build the flow which solves the core first and all leafs after the system they depend on. Leafs 
+    //which are the only child of their parent form a chain with it and are solved within the same node
+    void buildSolveFlow() {
+        
+        typedef shedule::FlowGraph::Node Node;
+        m_solveFlow.reset(new shedule::FlowGraph(m_leafs.size()+1));
+        
+        std::vector<int> children(m_leafs.size(), 0);
+        for(const Leaf& leaf : m_leafs) {
+            if(leaf.parent >= 0)
+                ++children[leaf.parent];
+        }
+        
+        //find the chain every leaf belongs to, the chain is identified by its first leaf
+        std::vector<int> chain(m_leafs.size());
+        std::vector<std::vector<int>> chainLeafs(m_leafs.size());
+        for(std::size_t i=0; i<m_leafs.size(); ++i) {
+            const int parent = m_leafs[i].parent;
+            chain[i] = (parent >= 0 && children[parent] == 1) ? chain[parent] : i;
+            chainLeafs[chain[i]].push_back(i);
+        }
+        
+        Node& core = m_solveFlow->newInitialActionNode([this](const tbb::flow::continue_msg&) {
+            solveCore();
+            return tbb::flow::continue_msg();
+        });
+        
+        std::vector<Node*> nodes(m_leafs.size(), nullptr);
+        for(std::size_t i=0; i<m_leafs.size(); ++i) {
+            
+            if(chain[i] != int(i))
+                continue;
+            
+            std::vector<int> leafs = chainLeafs[i];
+            auto action = [this, leafs](const tbb::flow::continue_msg&) {
+                for(int l : leafs)
+                    m_leafs[l].system->execute();
+                return tbb::flow::continue_msg();
+            };
+            
+            const Leaf& leaf = m_leafs[i];
+            if(leaf.independent)
+                nodes[i] = &m_solveFlow->newInitialActionNode(action);
+            else {
+                nodes[i] = &m_solveFlow->newActionNode(action);
+                m_solveFlow->connect(leaf.parent < 0 ? core : *nodes[chain[leaf.parent]], *nodes[i]);
+            }
+        }
+    };
+};
 
-    shedule::FlowGraph flow;
-//    std::map<LocalVertex, numeric::GeomertyEquation<Kernel>*> geometryMap;
-    int parameter = 0;
-    int equations = 0;
-       
-    void tree_edge(LocalEdge u, const Graph& graph) {
-/*
-         auto result = graph.template getProperty<symbolic::ResultProperty>(u);
-         
-         LocalVertex source = graph.source(u);
-         auto res = geometryMap.find(source);
-         if(res == geometryMap.end()) {
-         
-             res = geometryMap.find(graph.target(u));
-             
-             //if we still have nothing we need to create a start vertex geometry
-             if(res == geometryMap.end()) {
-                 
-                 auto geom = graph.template getProperty<symbolic::GeometryProperty>(source);
-                 //geometryMap[source] = result->(geom);
-             }
-         }
-  */       
-         
+/**
+ * @brief Splitting of a graph into its biconnected blocks
+ * 
+ * A block is a maximal subgraph which can not be disconnected by removing a single vertex. Blocks are 
+ * connected only via articulation vertices, hence they can be solved one after another: the root block 
+ * first and every other block after the block it hangs off, with the geometry of the shared articulation 
+ * vertex being fixed. The blocks are ordered by the block-cut tree, starting from the biggest block. As 
+ * clusters are held fixed the root block is the biggest one with a cluster, if there is any, hence a 
+ * component with a single cluster is anchored by it only. 
+ * Single edges which do not belong to a cycle form their own block, hence this decomposition includes the 
+ * leaf peeling of \ref LeafDecomposition.
+ */
+struct BlockDecomposition {
+    
+    struct Block {
+        std::vector<graph::LocalEdge>   edges;
+        std::vector<graph::LocalVertex> vertices;
+        int                             parentBlock;  //index of the parent block, -1 for the root block
+        graph::LocalVertex              articulation; //vertex shared with the parent block
+        bool                            independent;  //articulation is a cluster of the root block
     };
+    
+    std::vector<Block> blocks;
+};
 
-    //back edges are special. if we are in clusters, all backedge constraints depend on all clusters
-    //in the cluster cycle
-    void back_edge(LocalEdge u, const Graph& graph) {
+/**
+ * @brief Split the graph into biconnected blocks ordered by the block-cut tree
+ * 
+ * Uses the boost biconnected components algorithm on the graph structure. The graph indices are 
+ * recreated for this. Vertices without any edge do not belong to any block.
+ */
+template<typename Graph>
+BlockDecomposition decomposeBlocks(std::shared_ptr<Graph> g) {
+    
+    typedef BlockDecomposition::Block Block;
+    
+    g->initIndexMaps();
+    graph::property_map<graph::Index, Graph, graph::LocalVertex> vimap(g);
+    graph::property_map<graph::Index, Graph, graph::LocalEdge>   eimap(g);
+    
+    std::vector<int> edgeBlock(g->edgeCount());
+    auto bmap = boost::make_iterator_property_map(edgeBlock.begin(), eimap);
+    std::vector<graph::LocalVertex> articulations;
+    const std::size_t count = boost::biconnected_components(g->getDirectAccess(), bmap, 
+                                    std::back_inserter(articulations), boost::vertex_index_map(vimap)).first;
+    
+    //collect the edges and vertices of all blocks and remember which blocks a vertex belongs to
+    std::vector<Block> blocks(count, Block{{}, {}, -1, graph::LocalVertex(), false});
+    std::unordered_map<graph::LocalVertex, std::vector<int>> vertexBlocks;
+    auto edges = g->edges();
+    for(; edges.first != edges.second; ++edges.first) {
+        
+        const int b = bmap[*edges.first];
+        blocks[b].edges.push_back(*edges.first);
+        for(graph::LocalVertex v : {g->source(*edges.first), g->target(*edges.first)}) {
+            std::vector<int>& vb = vertexBlocks[v];
+            if(std::find(vb.begin(), vb.end(), b) == vb.end()) {
+                vb.push_back(b);
+                blocks[b].vertices.push_back(v);
+            }
+        }
+    }
+    
+    BlockDecomposition result;
+    if(count == 0)
+        return result;
+    
+    //traverse the block-cut tree breadth first, starting with the biggest block
+    std::vector<bool> cluster(count, false);
+    for(std::size_t i=0; i<count; ++i) {
+        for(graph::LocalVertex v : blocks[i].vertices)
+            cluster[i] = cluster[i] || (g->template getProperty<graph::Type>(v) == graph::Cluster);
+    }
+    int root = 0;
+    for(std::size_t i=1; i<count; ++i) {
+        if(cluster[i] != cluster[root] ? cluster[i] : blocks[i].edges.size() > blocks[root].edges.size())
+            root = i;
+    }
+    
+    std::vector<int> order(1, root), position(count, -1);
+    position[root] = 0;
+    for(std::size_t i=0; i<order.size(); ++i) {
+        
+        const int b = order[i];
+        for(graph::LocalVertex v : blocks[b].vertices) {
+            for(int child : vertexBlocks[v]) {
+                
+                if(position[child] >= 0)
+                    continue;
+                
+                position[child] = order.size();
+                order.push_back(child);
+                blocks[child].parentBlock  = i;
+                blocks[child].articulation = v;
+                blocks[child].independent  = (i == 0) && 
+                                    (g->template getProperty<graph::Type>(v) == graph::Cluster);
+            }
+        }
+    }
+    
+    for(int b : order)
+        result.blocks.push_back(std::move(blocks[b]));
+    
+    return result;
+};
 
+/**
+ * @brief Splitting of a graph into its cyclic core and the trees hanging off it
+ * 
+ * Vertices with a single edge are leafs: their geometry can be calculated from the edge equations alone 
+ * once the geometry at the other end of the edge is known. Removing them repeatedly peels off all trees 
+ * and chains attached to the graph, what remains is the cyclic core which needs to be solved as a whole. 
+ * The leafs are stored such that every leaf comes after the one it depends on.
+ */
+struct LeafDecomposition {
     
+    struct Leaf {
+        graph::LocalVertex vertex;      //the peeled vertex
+        graph::LocalEdge   edge;        //the edge connecting the vertex to its parent
+        graph::LocalVertex parent;      //the vertex this leaf depends on
+        int                parentLeaf;  //index of the parent leaf, -1 if the parent is part of the core
+        bool               independent; //the parent is a cluster core vertex, no need to wait for the core
     };
+    
+    std::vector<graph::LocalVertex> core;
+    std::vector<Leaf>               leafs;
+};
+/**
+ * @brief Peel all leafs and chains from the graph
+ * 
+ * This is done sequentially, as parallel peeling is not error free: in a Y topology it may happen that 
+ * two threads remove one arm each and both detect the middle node as having more than one remaining edge.
+ * Then the third arm stays behind as part of the core. The peeling is linear in the graph size anyway. 
+ * If the graph has no cycle at all, a single vertex remains as core. Clusters are solved before and held 
+ * fixed, hence they are never peeled but anchor the leafs hanging off them.
+ */
+template<typename Graph>
+LeafDecomposition decomposeLeafs(std::shared_ptr<Graph> g) {
+    
+    LeafDecomposition result;
+    std::unordered_map<graph::LocalVertex, int> degree;
+    std::unordered_map<graph::LocalVertex, int> leafIndex;
+    std::vector<graph::LocalVertex> queue;
+    
+    auto vertices = g->vertices();
+    for(; vertices.first != vertices.second; ++vertices.first) {
+        const int d = g->outDegree(*vertices.first);
+        degree[*vertices.first] = d;
+        if(d == 1)
+            queue.push_back(*vertices.first);
+    }
+    
+    //peeling gives the leafs outermost first
+    std::vector<LeafDecomposition::Leaf> peeled;
+    while(!queue.empty()) {
+        
+        graph::LocalVertex v = queue.back();
+        queue.pop_back();
+        if(degree[v] != 1 || g->template getProperty<graph::Type>(v) == graph::Cluster)
+            continue;
+        
+        //find the only edge which connects to a not yet peeled vertex
+        auto edges = g->outEdges(v);
+        for(; edges.first != edges.second; ++edges.first) {
+            
+            graph::LocalVertex other = g->target(*edges.first);
+            if(other == v)
+                other = g->source(*edges.first);
+            
+            if(leafIndex.find(other) != leafIndex.end())
+                continue;
+            
+            leafIndex[v] = peeled.size();
+            peeled.push_back({v, *edges.first, other, -1, false});
+            degree[v] = 0;
+            if(--degree[other] == 1)
+                queue.push_back(other);
+            break;
+        }
+    }
+    
+    //reverse to get the dependency order and connect leafs with their parents
+    const int count = peeled.size();
+    for(auto& entry : leafIndex)
+        entry.second = count - 1 - entry.second;
+    
+    result.leafs.assign(peeled.rbegin(), peeled.rend());
+    for(LeafDecomposition::Leaf& leaf : result.leafs) {
+        
+        auto parent = leafIndex.find(leaf.parent);
+        if(parent != leafIndex.end())
+            leaf.parentLeaf = parent->second;
+        else 
+            leaf.independent = (g->template getProperty<graph::Type>(leaf.parent) == graph::Cluster);
+    }
+    
+    vertices = g->vertices();
+    for(; vertices.first != vertices.second; ++vertices.first) {
+        if(leafIndex.find(*vertices.first) == leafIndex.end())
+            result.core.push_back(*vertices.first);
+    }
+    
+    return result;
 };
 
+//the geometries of all vertices within the subclusters of the graph, keyed by their identifier in the 
+//reduction results
 template<typename Graph>
-shedule::FlowGraph buildGraphNumericSystem(std::shared_ptr<Graph> g) {
-    
-    /*
-    //we build up the numeric system for this graph. This also means finding parts that can be solved 
-    //indivudual or simply after the main part (one-connected components)
-    
-    //to find one connected components we search all verices with one edge only. From there we can 
-    //follow that edge to the adjacent vertices until we find a edge with more than two connections. That is
-    //where the leaf ends.
-    tbb::task_group leafs;
-    tbb::concurrent_queue<tbb::flow::graph_node*> parallel_solvable;
-    tbb::concurrent_queue<tbb::flow::graph_node*> end_solvable;
-    
-    int leafcount = 1e3;
-    auto iter = g->vertices();
-    for(;iter.first != iter.second; ++iter.first, ++leafcount) {
-    
-        //start the leaf processing if a vertex only has a single edge
-        if(g->outDegree(*iter.first) == 1) {
-            
-            //doing this in parallel is not error free: it may happen that certain leafes are not found 
-            //for example in a Y topology: when thread one removes one arm and thread two the other, it 
-            //is possible that both detect the middle node as having 3 out edges and stop at the same 
-            //position. Then the third arm stays behind as leaf.
-            leafs.run([iter, g, leafcount, &s]() {                
-                
-                //group all edges and vertices that belong to the leaf
-                graph::LocalVertex source = *iter.first;
-                do {
-                    g->template setProperty<graph::Group>(source, leafcount);
-                    auto edges = g->outEdges(source);
-                    graph::LocalEdge e;
-                    if(g->template getProperty<graph::Group>(g->target(*edges.first)) != leafcount) 
-                        e = *edges.first;
-                    else 
-                        e = *(edges.first++);
-                    
-                    g->template setProperty<graph::Group>(e, leafcount);
-                    source = g->target(e);
-                }
-                while(g->outDegree(source) == 2);       
-                       
-                //See what kind of leafe we have here. Possibilities:
-                //1. last leaf vertex is a cluster, than we can calculate the leaf in parallel and
-                //   only the leaf-> main trunk connection needs to be calculated at the end
-                //2. last leaf vertex is a geometry, than the whole leaf needs to be calculated 
-                //   at the end
-                if(g->template getProperty<graph::Type>(source) == graph::Cluster) {
-                    
-                }
-            });            
+void collectClusterGeometries(std::shared_ptr<Graph> g, 
+                              std::unordered_map<const symbolic::Geometry*, symbolic::Geometry*>& geometries) {
+    
+    auto clusters = g->clusters();
+    for(; clusters.first != clusters.second; ++clusters.first) {
+        
+        auto cluster = clusters.first->second;
+        auto vertices = cluster->vertices();
+        for(; vertices.first != vertices.second; ++vertices.first) {
+            symbolic::Geometry* geometry = cluster->template getProperty<symbolic::GeometryProperty>(*vertices.first);
+            if(geometry)
+                geometries[geometry] = geometry;
+        }
+        collectClusterGeometries(cluster, geometries);
+    }
+};
+
+/**
+ * @brief Setup the numeric system of the given edges from their reduction results
+ * 
+ * The equations created by the reduction are collected from the edges \ref symbolic::ResultProperty. 
+ * Every numeric geometry of the edges vertices gets the current value of its symbolic geometry and is
+ * written back after each solve, all not reduced constraints provide the residuals. Dependend equations 
+ * which are inputs of the residuals are added too. Edges without result or without residual equations, 
+ * e.g. fully reduced ones, add nothing to the system. If no edge has a residual the system is not setup
+ * and executing it does nothing.
+ * 
+ * The geometries of fixed vertices are not part of the system, their values are used as they are. They 
+ * must be set up by the system they belong to before, which also recalculates them. This allows to solve
+ * a part of the graph after annother one, e.g. the blocks of \ref decomposeBlocks. Geometries within 
+ * subclusters are always fixed, the subclusters are solved before the graph and their geometries only 
+ * take the solved values of the symbolic geometries.
+ * 
+ * @param edges the edges of the graph whose equations form the system
+ * @param system the system to setup, must not have been setup before
+ * @param fixed vertices whose geometries are held fixed
+ */
+template<typename Kernel, typename Graph>
+void buildEquationSystem(std::shared_ptr<Graph> g, const std::vector<graph::LocalEdge>& edges, 
+                         ComponentSystem<Kernel>& system, 
+                         const std::vector<graph::LocalVertex>& fixed = std::vector<graph::LocalVertex>()) {
+    
+    buildEquationSystem(g, edges, system, fixed,
+                        typename mpl::contains<typename Graph::edgeprop, symbolic::ResultProperty>::type());
+};
+
+//graphs without reduction results have no equations, e.g. when only their structure is of interest
+template<typename Kernel, typename Graph>
+void buildEquationSystem(std::shared_ptr<Graph>, const std::vector<graph::LocalEdge>&, 
+                         ComponentSystem<Kernel>&, const std::vector<graph::LocalVertex>&, mpl::false_) {};
+
+template<typename Kernel, typename Graph>
+void buildEquationSystem(std::shared_ptr<Graph> g, const std::vector<graph::LocalEdge>& edges, 
+                         ComponentSystem<Kernel>& system, const std::vector<graph::LocalVertex>& fixed, 
+                         mpl::true_) {
+    
+    typedef symbolic::reduction::EquationWalker<Kernel> Walker;
+    typedef numeric::Calculatable<Kernel>               Calc;
+    
+    struct VertexGeometry {
+        typename Walker::VertexGeometry numeric;
+        symbolic::Geometry*             symbolic;
+    };
+    
+    struct Residual {
+        typename Walker::Residual       numeric;
+        symbolic::Constraint*           symbolic;
+    };
+    
+    //collect all vertex geometries once, equations of the vertices are shared by all edges using them
+    std::vector<VertexGeometry>  geometries;
+    std::vector<Residual>        residuals;
+    std::unordered_set<Calc*>    known, fixedGeometries;
+    std::vector<symbolic::Constraint*> constraints;
+    std::unordered_map<const symbolic::Geometry*, symbolic::Geometry*> clusterGeometries;
+    for(graph::LocalEdge e : edges) {
+        
+        auto walker = std::static_pointer_cast<Walker>(g->template getProperty<symbolic::ResultProperty>(e));
+        if(!walker || walker->getResiduals().empty())
+            continue;
+        
+        for(graph::LocalVertex v : {g->source(e), g->target(e)}) {
+            
+            if(g->template getProperty<graph::Type>(v) == graph::Cluster)
+                continue;
+            
+            symbolic::Geometry* symbolic = g->template getProperty<symbolic::GeometryProperty>(v);
+            const typename Walker::VertexGeometry& geometry = walker->getVertexGeometry(symbolic);
+            if(!known.insert(geometry.geometry.get()).second)
+                continue;
+            
+            if(std::find(fixed.begin(), fixed.end(), v) != fixed.end())
+                fixedGeometries.insert(geometry.geometry.get());
+            else 
+                geometries.push_back({geometry, symbolic});
+        }
+        
+        //all other geometries are within a cluster, which is solved before and held fixed
+        for(const typename Walker::VertexGeometry& geometry : walker->getVertexGeometries()) {
+            
+            if(!known.insert(geometry.geometry.get()).second)
+                continue;
+            
+            if(clusterGeometries.empty())
+                collectClusterGeometries(g, clusterGeometries);
+            
+            auto numeric = geometry;
+            auto symbolic = clusterGeometries.at(geometry.symbolic);
+            numeric.transfer(numeric.geometry.get(), symbolic, false);
+            fixedGeometries.insert(numeric.geometry.get());
+            system.addValueLoader([numeric, symbolic]() {
+                numeric.transfer(numeric.geometry.get(), symbolic, false);
+            });
+        }
+        
+        //the walker only identifies the constraints, the ones accessed later are taken from the graph
+        constraints.clear();
+        auto global = g->getGlobalEdges(e);
+        for(; global.first != global.second; ++global.first)
+            constraints.push_back(g->template getProperty<symbolic::ConstraintProperty>(*global.first));
+        
+        for(const typename Walker::Residual& residual : walker->getResiduals()) {
+            auto c = std::find(constraints.begin(), constraints.end(), residual.symbolic);
+            dcm_assert(c != constraints.end());
+            residuals.push_back({residual, *c});
         }
     }
     
-    shedule::FlowGraph fg;
+    if(residuals.empty())
+        return;
     
-    //iterate over all edges and create the equations for them
-    auto edges = g->edges();
-    for(; edges.first != edges.second; ++edges.first) {
+    //all calculatables between the geometries and the residuals need to be mapped into the system, the
+    //inputs must be initialized before the calculatables using them
+    std::vector<Calc*> order, inputs;
+    std::vector<std::pair<Calc*, bool>> stack;
+    for(const Residual& residual : residuals)
+        stack.push_back(std::make_pair(residual.numeric.equation.get(), false));
     
-        //auto result = g->template getProperty<symbolic::ResultProperty<Kernel>>(*edges.first);
+    while(!stack.empty()) {
         
+        std::pair<Calc*, bool> current = stack.back();
+        stack.pop_back();
+        if(current.second) {
+            order.push_back(current.first);
+            continue;
+        }
+        if(!known.insert(current.first).second)
+            continue;
+        
+        stack.push_back(std::make_pair(current.first, true));
+        inputs.clear();
+        current.first->collectInputs(inputs);
+        for(Calc* input : inputs)
+            stack.push_back(std::make_pair(input, false));
     }
     
-    return fg;*/
+    int parameters = 0;
+    for(VertexGeometry& geometry : geometries)
+        parameters += geometry.numeric.geometry->newParameterCount();
+    for(Calc* calc : order)
+        parameters += calc->newParameterCount();
+    
+    system.setupSystem(parameters, residuals.size());
+    
+    for(VertexGeometry& geometry : geometries) {
+        
+        auto numeric = geometry.numeric;
+        auto symbolic = geometry.symbolic;
+        numeric.transfer(numeric.geometry.get(), symbolic, false);
+        numeric.geometry->init(system.system());
+        system.addCalculatable(numeric.geometry);
+        system.addResultWriter([numeric, symbolic]() {
+            numeric.transfer(numeric.geometry.get(), symbolic, true);
+        });
+        system.addValueLoader([numeric, symbolic]() {
+            numeric.transfer(numeric.geometry.get(), symbolic, false);
+        });
+    }
+    
+    //the dependend equations are owned by the residuals using them, only those need to be stored
+    for(Calc* calc : order)
+        calc->init(system.system());
+    for(const Residual& residual : residuals) {
+        
+        auto numeric = residual.numeric;
+        auto symbolic = residual.symbolic;
+        system.addCalculatable(numeric.equation);
+        system.addValueLoader([numeric, symbolic]() {
+            numeric.load(numeric.equation.get(), symbolic);
+        });
+    }
+    
+    system.buildFlow(fixedGeometries);
 };
+
+//blocks with up to this amount of edges are solved with dense systems
+const std::size_t DenseBlockSize = 4;
+
+/**
+ * @brief Build the numeric system of a component
+ * 
+ * All trees and chains are peeled of the component first, every peeled vertex is solved in its own leaf
+ * system with the equations of the edge to its parent, see \ref decomposeLeafs. The remaining cyclic 
+ * core is split into its blocks, see \ref decomposeBlocks. The component system holds the equations of 
+ * the root block, a leaf system is created for every other block. The geometry a leaf depends on belongs
+ * to the system of its parent, in the leaf system it is held fixed, see \ref buildEquationSystem.
+ */
+template<typename Kernel, typename Graph>
+void buildGraphNumericSystem(std::shared_ptr<Graph> g, ComponentSystem<Kernel>& component) {
     
-template<typename Final, typename Graph>
-shedule::Executable* createSolvableSystem(std::shared_ptr<Graph> g, 
-                    const boost::multi_array<symbolic::reduction::EdgeReductionTree*,2>& reduction) {
+    typedef std::unique_ptr<ComponentSystem<Kernel>> System;
     
+    //the peeled edges are bridges, hence they form single edge blocks which are handled as leafs instead
+    LeafDecomposition leafs = decomposeLeafs(g);
+    BlockDecomposition decomposition = decomposeBlocks(g);
+    std::set<graph::LocalEdge> peeled;
+    for(const LeafDecomposition::Leaf& leaf : leafs.leafs)
+        peeled.insert(leaf.edge);
     
+    //the system every vertex belongs to, -1 for the component itself
+    std::unordered_map<graph::LocalVertex, int> owner;
+    
+    //the core is split at its articulation vertices and every block is solved as individual system after 
+    //the block it depends on. The biggest block is the root of the component. The blocks are ordered, 
+    //hence the system a block depends on is always setup before. Small blocks are solved with dense systems 
+    //as the sparse overhead does not pay of for them.
+    std::vector<int> blockSystem(decomposition.blocks.size(), -1);
+    for(std::size_t i=0; i<decomposition.blocks.size(); ++i) {
+        
+        const BlockDecomposition::Block& block = decomposition.blocks[i];
+        if(block.edges.size() == 1 && peeled.count(block.edges.front()))
+            continue;
+        
+        if(i == 0) {
+            buildEquationSystem(g, block.edges, component);
+            for(graph::LocalVertex v : block.vertices)
+                owner[v] = -1;
+            continue;
+        }
+        
+        System system(new ComponentSystem<Kernel>());
+        if(block.edges.size() <= DenseBlockSize)
+            system->setStorage(numeric::JacobiStorage::Dense);
+        
+        buildEquationSystem(g, block.edges, *system, {block.articulation});
+        blockSystem[i] = component.addLeaf(std::move(system), blockSystem[block.parentBlock], 
+                                           block.independent);
+        for(graph::LocalVertex v : block.vertices) {
+            if(v != block.articulation)
+                owner[v] = blockSystem[i];
+        }
+    }
+    
+    //the peeled vertices are solved after the system their parent belongs to. Leafs at a cluster of the 
+    //root block do not depend on any solved geometry and start with the root block
+    for(const LeafDecomposition::Leaf& leaf : leafs.leafs) {
+        
+        System system(new ComponentSystem<Kernel>());
+        system->setStorage(numeric::JacobiStorage::Dense);
+        buildEquationSystem(g, std::vector<graph::LocalEdge>(1, leaf.edge), *system, {leaf.parent});
+        
+        auto parent = owner.find(leaf.parent);
+        const int parentSystem = parent != owner.end() ? parent->second : -1;
+        owner[leaf.vertex] = component.addLeaf(std::move(system), parentSystem, 
+                                               leaf.independent && parentSystem < 0);
+    }
+};
+    
+template<typename Final, typename Graph, typename Reducer>
+shedule::Executable* createSolvableSystem(std::shared_ptr<Graph> g, Reducer& reducer) {
     
     //simplify the graph as much as possible. This has to be done before the subcluste processing as it is
     //possible that subclusters are groupt into yet annother subcluster
-    int components = symbolic::reduceGraph(g, reduction);   
+    int components = symbolic::reduceGraph(g, reducer);   
     
     //accesses all subclusters and handle them to make sure they are properly calculated before we try to 
     //reduce the toplevel cluster. A subcluster has to be reduced and solved imediatly, in contrary to the
@@ -222,23 +1082,290 @@ shedule::Executable* createSolvableSystem(std::shared_ptr<Graph> g,
     auto iter = g->clusters();
     tbb::parallel_for_each(iter.first, iter.second, 
         [&](typename std::iterator_traits<typename Graph::cluster_iterator>::value_type& sub) {
-            auto fg = createSolvableSystem(sub.second, reduction);
+            auto fg = createSolvableSystem<Final>(sub.second, reducer);
             fg->execute();
             delete fg;
         }
     );        
         
+    //now identify all ndividual components and create a executable for each. Every component gets
+    //its own linear system and solver, hence they can be solved concurrently without any locking
+    typedef typename Final::Kernel Kernel;
     shedule::ParallelVector* s = new shedule::ParallelVector();
-    //now identify all ndividual components and create a executable for each
     for(int i=0; i<components; ++i) {
         auto filter = graph::make_filter_graph(g, i);
-        s->add(buildGraphNumericSystem(filter));        
+        auto component = new ComponentSystem<Kernel>();
+        buildGraphNumericSystem(filter, *component);
+        s->addExecutable(component);
     }
     
     //everything has been processed, lets return the solvable and let the caller decide what happens next
     return s;
 }
 
+/**
+ * @brief Keeps the numeric systems of all components alive between solves
+ * 
+ * In interactive usage mostly a single geometry or constraint is changed between two solves. Rebuilding 
+ * and resolving all components every time is a waste, as all components without changes are already 
+ * solved and their numeric systems are still valid. This class stores the \ref ComponentSystem of every 
+ * component and only rebuilds the ones which contain changed vertices or edges, or whose structure changed
+ * by removing vertices or edges. Components are identified by a signature of their vertices and edges,
+ * as the group numbers are reassigned on every reduction.
+ * 
+ * Subclusters are handled by their own IncrementalSystem, hence they are only resolved if something 
+ * within them changed.
+ */
+template<typename Final, typename Graph>
+class IncrementalSystem {
+    
+    typedef typename Final::Kernel          Kernel;
+    typedef ComponentSystem<Kernel>         Component;
+    typedef std::unique_ptr<Component>      ComponentPtr;
+    
+public:
+    /**
+     * @brief Update the stored systems to the current graph state
+     * 
+     * Reduces the graph, reuses all unchanged components and builds the changed ones. All change flags
+     * of the graphs edges and vertices are acknowledged afterwards. Changed subclusters are solved 
+     * imediatly, as in \ref createSolvableSystem.
+     * 
+     * @return shedule::Executable* executable which solves all rebuilt components. It does not own the 
+     *         components and must not be executed after the next update.
+     */
+    template<typename Reducer>
+    shedule::Executable* update(std::shared_ptr<Graph> g, Reducer& reducer) {
+        
+        std::vector<graph::LocalEdge> changedEdges;
+        const int components = symbolic::reduceGraph(g, reducer, &changedEdges);
+        
+        //vertex changes are not processed by the reduction, but the rigid clustering within it moves 
+        //vertices into subclusters. Hence they are collected afterwards, changes within a subcluster mark
+        //its cluster vertex.
+        std::vector<graph::LocalVertex> changedVertices = updateSubclusters(g, reducer);
+        auto vertices = g->vertices();
+        for(; vertices.first != vertices.second; ++vertices.first) {
+            if(g->hasPropertyChanges(*vertices.first))
+                changedVertices.push_back(*vertices.first);
+        }
+        
+        //identify every component by its structure and find out which ones hold changes
+        std::vector<std::vector<std::size_t>> keys(components);
+        std::vector<bool> dirty(components, false);
+        vertices = g->vertices();
+        for(; vertices.first != vertices.second; ++vertices.first) {
+            const int group = g->template getProperty<graph::Group>(*vertices.first);
+            keys[group].push_back(boost::hash_value(*vertices.first));
+        }
+        auto edges = g->edges();
+        for(; edges.first != edges.second; ++edges.first) {
+            graph::LocalVertex s = g->source(*edges.first), t = g->target(*edges.first);
+            std::size_t key = boost::hash_value(std::min(s,t));
+            boost::hash_combine(key, std::max(s,t));
+            keys[g->template getProperty<graph::Group>(*edges.first)].push_back(key);
+        }
+        for(graph::LocalVertex v : changedVertices) {
+            dirty[g->template getProperty<graph::Group>(v)] = true;
+            g->acknowledgePropertyChanges(v);
+        }
+        for(graph::LocalEdge e : changedEdges)
+            dirty[g->template getProperty<graph::Group>(e)] = true;
+        
+        //reuse all clean components, build the others and only solve those. Components which do not exist
+        //anymore are dropped together with the old map.
+        std::unordered_map<std::size_t, ComponentPtr> current;
+        shedule::ParallelVector* s = new shedule::ParallelVector();
+        for(int i=0; i<components; ++i) {
+            
+            std::sort(keys[i].begin(), keys[i].end());
+            const std::size_t signature = boost::hash_range(keys[i].begin(), keys[i].end());
+            
+            auto old = m_components.find(signature);
+            if(!dirty[i] && old != m_components.end()) {
+                current[signature] = std::move(old->second);
+                continue;
+            }
+            
+            ComponentPtr component(new Component());
+            buildGraphNumericSystem(graph::make_filter_graph(g, i), *component);
+            Component* c = component.get();
+            s->add([c]() {c->execute();});
+            current[signature] = std::move(component);
+            ++m_rebuilds;
+        }
+        m_components.swap(current);
+        
+        return s;
+    };
+    
+    /**
+     * @brief Solve all stored systems again with the current values
+     * 
+     * The values of the symbolic geometries and constraints are loaded into the systems of the last 
+     * \ref update, nothing is reduced or rebuilt. Only value changes which keep the structure are allowed
+     * in between, e.g. the dimensions of a parametric model. Subclusters are reloaded and solved imediatly.
+     * 
+     * @return shedule::Executable* executable which solves all components. It does not own the components
+     *         and must not be executed after the next update.
+     */
+    shedule::Executable* reload() {
+        
+        std::vector<IncrementalSystem*> subclusters;
+        for(auto& sub : m_subclusters)
+            subclusters.push_back(sub.second.get());
+        
+        tbb::parallel_for_each(subclusters.begin(), subclusters.end(), [](IncrementalSystem* system) {
+            std::unique_ptr<shedule::Executable> ex(system->reload());
+            ex->execute();
+        });
+        
+        shedule::ParallelVector* s = new shedule::ParallelVector();
+        for(auto& component : m_components) {
+            Component* c = component.second.get();
+            c->loadValues();
+            s->add([c]() {c->execute();});
+        }
+        return s;
+    };
+    
+    //number of components stored for reuse in the next update
+    int componentCount() {return m_components.size();};
+    //number of components built since construction, reused ones do not count
+    int rebuildCount()   {return m_rebuilds;};
+    
+private:
+    std::unordered_map<std::size_t, ComponentPtr>                    m_components;
+    std::unordered_map<Graph*, std::unique_ptr<IncrementalSystem>>   m_subclusters;
+    int                                                              m_rebuilds = 0;
+    
+    //every subcluster keeps its own systems. They are solved one after another in the parent solving 
+    //process, hence they are updated and executed right away. Returns the cluster vertices of all 
+    //subclusters which rebuilt any component.
+    template<typename Reducer>
+    std::vector<graph::LocalVertex> updateSubclusters(std::shared_ptr<Graph> g, Reducer& reducer) {
+        
+        struct Job {
+            graph::LocalVertex      vertex;
+            std::shared_ptr<Graph>  graph;
+            IncrementalSystem*      system;
+            bool                    rebuilt;
+        };
+        
+        std::unordered_map<Graph*, std::unique_ptr<IncrementalSystem>> subclusters;
+        std::vector<Job> jobs;
+        auto iter = g->clusters();
+        for(; iter.first != iter.second; ++iter.first) {
+            
+            std::shared_ptr<Graph> sub = iter.first->second;
+            auto old = m_subclusters.find(sub.get());
+            std::unique_ptr<IncrementalSystem>& system = subclusters[sub.get()];
+            if(old != m_subclusters.end())
+                system = std::move(old->second);
+            else 
+                system.reset(new IncrementalSystem());
+            
+            jobs.push_back({iter.first->first, sub, system.get(), false});
+        }
+        m_subclusters.swap(subclusters);
+        
+        tbb::parallel_for_each(jobs.begin(), jobs.end(), [&](Job& job) {
+            const int rebuilds = job.system->rebuildCount();
+            std::unique_ptr<shedule::Executable> ex(job.system->update(job.graph, reducer));
+            ex->execute();
+            job.rebuilt = job.system->rebuildCount() != rebuilds;
+        });
+        
+        std::vector<graph::LocalVertex> changed;
+        for(const Job& job : jobs) {
+            if(job.rebuilt)
+                changed.push_back(job.vertex);
+        }
+        return changed;
+    };
+};
+
+/**
+ * @brief Solves many variants of a single topology concurrently
+ * 
+ * Parametric sweeps solve the same model over and over again, only with different values. Building the 
+ * numeric system, which includes the symbolic reduction, the decomposition and the recalculation flow, is
+ * the same for all of them and hence done only once per worker thread with the given factory. Every 
+ * variant is then setup in such a prebuild system, solved and collected. As the systems are reused the 
+ * sparsity analysis cached by the nonlinear solver is shared by all variants solved in the same system.
+ * 
+ * The variants are solved in a own tbb::task_arena, hence the concurrency of the batch can be limited 
+ * independently of the rest of the application. The build systems are kept for following batches. 
+ * Variants given as values of a modules system are solved with \ref IncrementalSystem::reload instead, 
+ * which reuses the single reduction of the system.
+ */
+template<typename Kernel>
+class BatchSolver {
+    
+public:
+    typedef ComponentSystem<Kernel>                Component;
+    typedef std::unique_ptr<Component>             ComponentPtr;
+    typedef std::function<ComponentPtr()>          Factory;
+    
+    /**
+     * @param factory creates the numeric system of the topology, must be callable from multiple threads
+     * @param concurrency maximal amount of variants solved at the same time
+     */
+    BatchSolver(Factory factory, int concurrency = tbb::task_arena::automatic) 
+        : m_factory(factory), m_arena(concurrency) {};
+    
+    /**
+     * @brief Solve all variants
+     * 
+     * For every variant the setup functor is called with the system and the variant index, it must set 
+     * the variants values. After solving the collect functor is called the same way to read the results. 
+     * Both are called concurrently for different variants.
+     * 
+     * @return std::vector<int> the solver result of every variant
+     */
+    template<typename Setup, typename Collect>
+    std::vector<int> solve(int variants, Setup setup, Collect collect) {
+        
+        std::vector<int> results(variants, 0);
+        m_arena.execute([&]() {
+            tbb::parallel_for(0, variants, [&](int i) {
+                
+                //solving waits for the systems flow graph. Without isolation the waiting thread could steal 
+                //another variant and reuse its thread local system while it is still in use
+                tbb::this_task_arena::isolate([&]() {
+                    
+                    ComponentPtr& component = m_systems.local();
+                    if(!component)
+                        component = m_factory();
+                    
+                    setup(*component, i);
+                    component->execute();
+                    results[i] = component->result();
+                    collect(*component, i);
+                });
+            });
+        });
+        return results;
+    };
+    
+    //number of numeric systems build, at most one per worker thread
+    int systemCount() {return m_systems.size();};
+    
+    //call the functor for every build system, e.g. to setup the solver tolerances
+    template<typename Functor>
+    void forEachSystem(Functor f) {
+        for(ComponentPtr& component : m_systems) {
+            if(component)
+                f(*component);
+        }
+    };
+    
+private:
+    Factory                                             m_factory;
+    tbb::task_arena                                     m_arena;
+    tbb::enumerable_thread_specific<ComponentPtr>       m_systems;
+};
+
 } //solver
 
 } //dcm
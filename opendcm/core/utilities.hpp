@@ -61,7 +61,7 @@ struct RecursiveSequenceApplyer {
     RecursiveSequenceApplyer(T& param) 
         : functor(Functor<Sequence>(param)) {};
     
-    RecursiveSequenceApplyer<RecursiveSequenceApplyer<Sequence, Functor>>(RecursiveSequenceApplyer& r) 
+    RecursiveSequenceApplyer(RecursiveSequenceApplyer& r) 
         : functor(r.functor) {};
         
     template<typename T>
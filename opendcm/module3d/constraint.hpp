@@ -0,0 +1,176 @@
+/*
+    openDCM, dimensional constraint manager
+    Copyright (C) 2015  Stefan Troeger <stefantroeger@gmx.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along
+    with this library; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef DCM_CONSTRAINT_3D_H
+#define DCM_CONSTRAINT_3D_H
+
+#include <opendcm/core/constraint.hpp>
+#include "geometry.hpp"
+
+namespace dcm {
+namespace numeric {
+
+/**
+ * @brief Distance between two points
+ *
+ * The error is the difference of the point distance and the requested one. The gradient is undefined for
+ * coincident points, it is zero in this case.
+ */
+template<typename Kernel>
+struct Constraint<Kernel, dcm::Distance, geometry::Point3, geometry::Point3>
+    : public AutoDiffConstraint<Kernel, dcm::Distance, geometry::Point3, geometry::Point3,
+                                Constraint<Kernel, dcm::Distance, geometry::Point3, geometry::Point3>> {
+
+    Constraint() {};
+
+    template<typename T>
+    T error(const Eigen::Matrix<T, 3, 1>& g1, const Eigen::Matrix<T, 3, 1>& g2) {
+        return (g1-g2).norm() - T(this->distance());
+    };
+};
+
+/**
+ * @brief Orientation of two planes
+ *
+ * Only the plane directions are used. For Equal and Opposite the error is the norm of the directions
+ * difference or sum, Parallel chooses the smaller one of both. Perpendicular directions have a zero dot
+ * product. Like for the distance the gradient of the norms is zero if they vanish.
+ */
+template<typename Kernel>
+struct Constraint<Kernel, dcm::Orientation, geometry::Plane, geometry::Plane>
+    : public AutoDiffConstraint<Kernel, dcm::Orientation, geometry::Plane, geometry::Plane,
+                                Constraint<Kernel, dcm::Orientation, geometry::Plane, geometry::Plane>> {
+
+    Constraint() {};
+
+    template<typename T>
+    T error(const Eigen::Matrix<T, 6, 1>& g1, const Eigen::Matrix<T, 6, 1>& g2) {
+        
+        auto d1 = g1.template tail<3>();
+        auto d2 = g2.template tail<3>();
+        switch(this->orientation()) {
+            case Orientations::Perpendicular:
+                return d1.dot(d2);
+            case Orientations::Opposite:
+                return (d1+d2).norm();
+            case Orientations::Parallel:
+                if(d1.dot(d2) < T(0))
+                    return (d1+d2).norm();
+                //fall through
+            default:
+                return (d1-d2).norm();
+        }
+    };
+};
+
+/**
+ * @brief Vectorized point to point distance
+ *
+ * Both buffers hold the point coordinates of all lanes.
+ */
+template<typename Kernel, int Lanes>
+struct BatchConstraint<Kernel, dcm::Distance, geometry::Point3, geometry::Point3, Lanes> {
+
+    static const bool Vectorized = true;
+    typedef Eigen::Array<typename Kernel::Scalar, Lanes, 1>              Pack;
+    typedef Eigen::Array<typename Kernel::Scalar, Lanes, Eigen::Dynamic> Buffer;
+
+    Pack distance;
+
+    void gatherOptions(ConstraintSimplifiedEquation<Kernel, dcm::Distance, geometry::Point3, geometry::Point3>& eqn,
+                       int lane) {
+        distance(lane) = eqn.distance();
+    };
+
+    void calculate(const Buffer& g1, const Buffer& g2, Pack& error, Buffer& dg1, Buffer& dg2) {
+        dg1 = g1 - g2;
+        Pack norm = dg1.square().rowwise().sum().sqrt();
+        error = norm - distance;
+
+        //coincident points have no defined direction, their gradient is zero like in the scalar version
+        Pack inverse = (norm > 0).select(norm.inverse(), Pack::Zero());
+        dg1.colwise() *= inverse;
+        dg2 = -dg1;
+    };
+};
+
+/**
+ * @brief Vectorized plane to plane orientation
+ *
+ * The buffers hold the plane point in the first three columns and the direction in the last three. Lanes
+ * with different orientation types are evaluated together, the norm and the perpendicular result are both
+ * calculated and the relevant one is selected per lane.
+ */
+template<typename Kernel, int Lanes>
+struct BatchConstraint<Kernel, dcm::Orientation, geometry::Plane, geometry::Plane, Lanes> {
+
+    static const bool Vectorized = true;
+    typedef Eigen::Array<typename Kernel::Scalar, Lanes, 1>              Pack;
+    typedef Eigen::Array<typename Kernel::Scalar, Lanes, 3>              Directions;
+    typedef Eigen::Array<typename Kernel::Scalar, Lanes, Eigen::Dynamic> Buffer;
+
+    //factor of the second direction in the difference: 1 equal, -1 opposite, 0 parallel (chosen by the
+    //direction) and perpendicular is marked seperatly
+    Pack sign, perpendicular;
+
+    void gatherOptions(ConstraintSimplifiedEquation<Kernel, dcm::Orientation, geometry::Plane, geometry::Plane>& eqn,
+                       int lane) {
+
+        perpendicular(lane) = 0;
+        switch(eqn.orientation()) {
+            case Orientations::Equal:
+                sign(lane) = 1;
+                break;
+            case Orientations::Opposite:
+                sign(lane) = -1;
+                break;
+            case Orientations::Perpendicular:
+                perpendicular(lane) = 1;
+                sign(lane) = 1;
+                break;
+            default:
+                sign(lane) = 0;
+        }
+    };
+
+    void calculate(const Buffer& g1, const Buffer& g2, Pack& error, Buffer& dg1, Buffer& dg2) {
+
+        const Directions d1 = g1.template rightCols<3>();
+        const Directions d2 = g2.template rightCols<3>();
+        const Pack dot = (d1*d2).rowwise().sum();
+        const Pack s = (sign == 0).select((dot < 0).select(Pack::Constant(-1), Pack::Constant(1)), sign);
+
+        Directions diff = d1 - d2.colwise()*s;
+        const Pack norm = diff.square().rowwise().sum().sqrt();
+        diff.colwise() *= (norm > 0).select(norm.inverse(), Pack::Zero());
+
+        error = (perpendicular > 0).select(dot, norm);
+        dg1.template leftCols<3>().setZero();
+        dg2.template leftCols<3>().setZero();
+        for(int i=0; i<3; ++i) {
+            dg1.col(3+i) = (perpendicular > 0).select(d2.col(i), diff.col(i));
+            dg2.col(3+i) = (perpendicular > 0).select(d1.col(i), -s*diff.col(i));
+        }
+    };
+};
+
+} //numeric
+} //dcm
+
+#endif //DCM_CONSTRAINT_3D_H
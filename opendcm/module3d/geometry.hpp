@@ -21,42 +21,45 @@
 #define DCM_GEOMETRY_3D_H
 
 #include <opendcm/core/geometry.hpp>
+#include <opendcm/core/typeadaption.hpp>
+#include <boost/blank.hpp>
 #include <boost/fusion/include/at_c.hpp>
 
 namespace fusion = boost::fusion;
 
 namespace dcm {
 
-//the geometry primitives we handle in the 3d module
+//the geometry primitives we handle in the 3d module. All values are stored as mapped vectors, hence the 
+//numeric geometries alias the parameters of the linear system and take the current values as initial ones
 namespace geometry {
 
-template<typename Kernel, bool MappedType = true>
-struct Point3 : public Geometry<Kernel, MappedType, storage::Vector<3>> {
+template<typename Kernel>
+struct Point3 : public Geometry<Kernel, numeric::MappedVector<Kernel, 3>> {
 
     typedef typename Kernel::Scalar Scalar;
-    using Geometry<Kernel, MappedType, storage::Vector<3>>::m_storage;
+    using Geometry<Kernel, numeric::MappedVector<Kernel, 3>>::m_storage;
 
     auto point()->decltype(fusion::at_c<0>(m_storage)) {
         return fusion::at_c<0>(m_storage);
     };
     
-    Point3<Kernel, MappedType>& transform(const details::Transform<Scalar, 3>& t) {
-        point() = t*point();
+    Point3<Kernel>& transform(const details::Transform<Scalar, 3>& t) {
+        t.transform(point());
         return *this;
     };
 
-    Point3<Kernel, MappedType>  transformed(const details::Transform<Scalar, 3>& t) {
-        Point3<Kernel, MappedType> copy(*this);
+    Point3<Kernel>  transformed(const details::Transform<Scalar, 3>& t) {
+        Point3<Kernel> copy(*this);
         copy.transform(t);
         return copy;
     };
 };
 
-template<typename Kernel, bool MappedType = true>
-struct Line3 : public Geometry<Kernel, MappedType, storage::Vector<3>, storage::Vector<3>> {
+template<typename Kernel>
+struct Line3 : public Geometry<Kernel, numeric::MappedVector<Kernel, 3>, numeric::MappedVector<Kernel, 3>> {
 
     typedef typename Kernel::Scalar Scalar;
-    using Geometry<Kernel, MappedType, storage::Vector<3>, storage::Vector<3>>::m_storage;
+    using Geometry<Kernel, numeric::MappedVector<Kernel, 3>, numeric::MappedVector<Kernel, 3>>::m_storage;
 
     auto point()->decltype(fusion::at_c<0>(m_storage)) {
         return fusion::at_c<0>(m_storage);
@@ -65,13 +68,25 @@ struct Line3 : public Geometry<Kernel, MappedType, storage::Vector<3>, storage::
     auto direction()->decltype(fusion::at_c<1>(m_storage)) {
         return fusion::at_c<1>(m_storage);
     };
+    
+    Line3<Kernel>& transform(const details::Transform<Scalar, 3>& t) {
+        t.transform(point());
+        t.rotate(direction());
+        return *this;
+    };
+
+    Line3<Kernel>  transformed(const details::Transform<Scalar, 3>& t) {
+        Line3<Kernel> copy(*this);
+        copy.transform(t);
+        return copy;
+    };
 };
 
-template<typename Kernel, bool MappedType = true>
-struct Plane : public Geometry<Kernel, MappedType, storage::Vector<3>, storage::Vector<3>> {
+template<typename Kernel>
+struct Plane : public Geometry<Kernel, numeric::MappedVector<Kernel, 3>, numeric::MappedVector<Kernel, 3>> {
 
     typedef typename Kernel::Scalar Scalar;
-    using Geometry<Kernel, MappedType, storage::Vector<3>, storage::Vector<3>>::m_storage;
+    using Geometry<Kernel, numeric::MappedVector<Kernel, 3>, numeric::MappedVector<Kernel, 3>>::m_storage;
 
     auto point()->decltype(fusion::at_c<0>(m_storage)) {
         return fusion::at_c<0>(m_storage);
@@ -80,16 +95,29 @@ struct Plane : public Geometry<Kernel, MappedType, storage::Vector<3>, storage::
     auto direction()->decltype(fusion::at_c<1>(m_storage)) {
         return fusion::at_c<1>(m_storage);
     };
+    
+    Plane<Kernel>& transform(const details::Transform<Scalar, 3>& t) {
+        t.transform(point());
+        t.rotate(direction());
+        return *this;
+    };
+
+    Plane<Kernel>  transformed(const details::Transform<Scalar, 3>& t) {
+        Plane<Kernel> copy(*this);
+        copy.transform(t);
+        return copy;
+    };
 };
 
-template<typename Kernel, bool MappedType = true>
-struct Cylinder : public Geometry<Kernel, MappedType,
-        storage::Vector<3>, storage::Vector<3>, storage::Parameter> {
+//the radius is a one dimensional vector, as only mapped storage entries are initialized from the current value
+template<typename Kernel>
+struct Cylinder : public Geometry<Kernel, numeric::MappedVector<Kernel, 3>, numeric::MappedVector<Kernel, 3>, 
+                                  numeric::MappedVector<Kernel, 1>> {
 
     typedef typename Kernel::Scalar Scalar;
-    typedef Geometry<Kernel, MappedType,
-            storage::Vector<3>, storage::Vector<3>, storage::Parameter> Inherited;
-    using Geometry<Kernel, MappedType, storage::Vector<3>, storage::Vector<3>, storage::Parameter>::m_storage;
+    typedef Geometry<Kernel, numeric::MappedVector<Kernel, 3>, numeric::MappedVector<Kernel, 3>, 
+                     numeric::MappedVector<Kernel, 1>> Inherited;
+    using Inherited::m_storage;
 
     auto point()->decltype(fusion::at_c<0>(m_storage)) {
         return fusion::at_c<0>(m_storage);
@@ -100,7 +128,20 @@ struct Cylinder : public Geometry<Kernel, MappedType,
     };
 
     Scalar& radius() {
-        return Inherited::rmPtr(fusion::at_c<1>(m_storage));
+        return fusion::at_c<2>(m_storage)(0);
+    };
+    
+    Cylinder<Kernel>& transform(const details::Transform<Scalar, 3>& t) {
+        t.transform(point());
+        t.rotate(direction());
+        radius() *= t.scaling().factor();
+        return *this;
+    };
+
+    Cylinder<Kernel>  transformed(const details::Transform<Scalar, 3>& t) {
+        Cylinder<Kernel> copy(*this);
+        copy.transform(t);
+        return copy;
     };
 };
 
@@ -49,19 +49,43 @@ struct Module3D {
 
         typedef typename Stacked::Kernel Kernel;
       
-        type() : Stacked() {
-                   
-            //we create our default edge reduction trees
-            int id_point    = Final::template primitiveGeometryIndex<geometry::Point3>::value;
-            int id_line     = Final::template primitiveGeometryIndex<geometry::Line3>::value;
-            int id_plane    = Final::template primitiveGeometryIndex<geometry::Plane>::value;
-            int id_cylinder = Final::template primitiveGeometryIndex<geometry::Cylinder>::value;
-        };
+        type() : Stacked() {};
         
         ~type() {
                       
         }
         
+        //count the degrees of freedom of 3D geometries and constraints to find rigid subsystems
+        template<typename Reducer>
+        void setupReducer(Reducer& reducer) {
+            
+            Stacked::setupReducer(reducer);
+            
+            const int point     = Final::template geometryIndex<geometry::Point3<Kernel>>::value;
+            const int line      = Final::template geometryIndex<geometry::Line3<Kernel>>::value;
+            const int plane     = Final::template geometryIndex<geometry::Plane<Kernel>>::value;
+            const int cylinder  = Final::template geometryIndex<geometry::Cylinder<Kernel>>::value;
+            
+            const int orientation = Final::template constraintIndex<Orientation>::value;
+            
+            reducer.setDofCounting(6, [=](const symbolic::Geometry& g) -> int {
+                if(g.type == point || g.type == plane)
+                    return 3;
+                if(g.type == line)
+                    return 4;
+                if(g.type == cylinder)
+                    return 5;
+                return 6;
+            }, [=](const symbolic::Constraint& c) -> int {
+                //distance and angle remove a single degree of freedom, so does a perpendicular orientation.
+                //All other orientations fix two rotational degrees of freedom
+                if(c.type != orientation)
+                    return 1;
+                const Orientation& o = static_cast<const symbolic::TypeConstraint<Orientation>&>(c).getPrimitveConstraint();
+                return (o.orientation() == Orientations::Perpendicular) ? 1 : 2;
+            });
+        };
+        
         /**
          * @brief Container for 3D user geometry
          * 
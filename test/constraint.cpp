@@ -21,10 +21,14 @@
 #include <boost/concept_check.hpp>
 
 #include "opendcm/core/constraint.hpp"
+#include "opendcm/module3d/constraint.hpp"
 #include <Eigen/Core>
 
 typedef dcm::Eigen3Kernel<double> K;
 
+using dcm::geometry::Point3;
+using dcm::geometry::Plane;
+
 //two vectors perpendicular, maybe the easiest constraints of them all
 struct test_constraint1 : public dcm::constraint::Constraint<int> {
     using Constraint::operator=;
@@ -41,58 +45,6 @@ struct test_constraint2 : public dcm::constraint::Constraint< double, char> {
     char&   direction() {return fusion::at_c<1>(m_storage);};
 };
 
-template<typename Kernel>
-struct TPoint3 : public dcm::geometry::Geometry<Kernel, dcm::numeric::Vector<Kernel, 3>> {
-
-    using dcm::geometry::Geometry<Kernel, dcm::numeric::Vector<Kernel, 3>>::m_storage;
-   
-    auto value() -> decltype(fusion::at_c<0>(m_storage)){
-        return fusion::at_c<0>(m_storage);
-    };
-};
-
-namespace dcm {
-namespace numeric {
-
-template<typename Kernel>
-struct Constraint<Kernel, dcm::Distance, TPoint3, TPoint3> : public ConstraintBase<Kernel, dcm::Distance, TPoint3, TPoint3> {
-  
-    typedef ConstraintBase<Kernel, dcm::Distance, TPoint3, TPoint3>  Inherited;
-    typedef typename Kernel::Scalar                 Scalar;
-    typedef typename Inherited::Vector              Vector;
-    typedef typename Inherited::Geometry1           Geometry1;
-    typedef typename Inherited::Derivative1         Derivative1;
-    typedef typename Inherited::Geometry2           Geometry2;
-    typedef typename Inherited::Derivative2         Derivative2;
-    
-    Constraint() {
-    };
-    
-    Scalar calculateError(Geometry1& g1, Geometry2& g2) {        
-        return (g1.value()-g2.value()).norm() - Inherited::distance();
-    };
-
-    Scalar calculateGradientFirst(Geometry1& g1, Geometry2& g2, Derivative1& dg1) {        
-        return (g1.value()-g2.value()).dot(dg1.value()) / (g1.value()-g2.value()).norm();
-    };
-
-    Scalar calculateGradientSecond(Geometry1& g1, Geometry2& g2, Derivative2& dg2) {        
-        return (g1.value()-g2.value()).dot(-dg2.value()) / (g1.value()-g2.value()).norm();
-    };
-
-    Vector calculateGradientFirstComplete(Geometry1& g1, Geometry2& g2) {
-        return (g1.value()-g2.value()) / (g1.value()-g2.value()).norm();
-    };
-
-    Vector calculateGradientSecondComplete(Geometry1& g1, Geometry2& g2) {
-        return (g1.value()-g2.value()) / (g1.value()-g2.value()).norm();
-    };
-};
-
-} //numeric
-} //dcm
-
-
 template<typename T>
 void pretty(T t) {
     std::cout << __PRETTY_FUNCTION__ << std::endl;
@@ -136,18 +88,18 @@ BOOST_AUTO_TEST_CASE(primitive) {
 BOOST_AUTO_TEST_CASE(numeric) {
     
    dcm::numeric::LinearSystem<K> sys(20,20);  
-   std::shared_ptr<dcm::numeric::Geometry<K, TPoint3>> p1(new dcm::numeric::Geometry<K, TPoint3>());
-   std::shared_ptr<dcm::numeric::Geometry<K, TPoint3>> p2(new dcm::numeric::Geometry<K, TPoint3>);
+   std::shared_ptr<dcm::numeric::Geometry<K, Point3>> p1(new dcm::numeric::Geometry<K, Point3>());
+   std::shared_ptr<dcm::numeric::Geometry<K, Point3>> p2(new dcm::numeric::Geometry<K, Point3>);
 
    p1->init(sys);
    p2->init(sys);   
-   p1->value() = Eigen::Vector3d(1,0,0);
-   p2->value() = Eigen::Vector3d(0,0,0);
+   p1->point() = Eigen::Vector3d(1,0,0);
+   p2->point() = Eigen::Vector3d(0,0,0);
    
-   typedef dcm::numeric::ConstraintSimplifiedEquation<K, dcm::Distance, TPoint3, TPoint3>        ggc;
-   typedef dcm::numeric::ConstraintComplexEquation<K, dcm::Distance, TPoint3, TPoint3>           ccc;
-   typedef dcm::numeric::ConstraintSimplifiedComplexEquation<K, dcm::Distance, TPoint3, TPoint3> gcc;
-   typedef dcm::numeric::ConstraintComplexSimplifiedEquation<K, dcm::Distance, TPoint3, TPoint3> cgc;
+   typedef dcm::numeric::ConstraintSimplifiedEquation<K, dcm::Distance, Point3, Point3>        ggc;
+   typedef dcm::numeric::ConstraintComplexEquation<K, dcm::Distance, Point3, Point3>           ccc;
+   typedef dcm::numeric::ConstraintSimplifiedComplexEquation<K, dcm::Distance, Point3, Point3> gcc;
+   typedef dcm::numeric::ConstraintComplexSimplifiedEquation<K, dcm::Distance, Point3, Point3> cgc;
    
    std::shared_ptr<ggc> gg_constraint(new ggc());
    std::shared_ptr<ccc> cc_constraint(new ccc());
@@ -172,4 +124,144 @@ BOOST_AUTO_TEST_CASE(numeric) {
 
 }
 
+BOOST_AUTO_TEST_CASE(autodiff) {
+    
+    typedef dcm::numeric::Geometry<K, Point3>                                              Point;
+    typedef dcm::numeric::ConstraintSimplifiedEquation<K, dcm::Distance, Point3, Point3>   Simplified;
+    typedef dcm::numeric::ConstraintComplexEquation<K, dcm::Distance, Point3, Point3>      Complex;
+    
+    dcm::numeric::LinearSystem<K> sys(6, 3);
+    auto p1 = std::make_shared<Point>(), p2 = std::make_shared<Point>();
+    p1->init(sys);
+    p2->init(sys);
+    
+    auto simplified = std::make_shared<Simplified>(), coincident = std::make_shared<Simplified>();
+    auto complex = std::make_shared<Complex>();
+    simplified->setInputEquations(p1, p2);
+    complex->setInputEquations(p1, p2);
+    coincident->setInputEquations(p1, p1);
+    simplified->distance() = 2;
+    complex->distance() = 2;
+    simplified->init(sys);
+    complex->init(sys);
+    coincident->init(sys);
+    
+    sys.parameter() << 1, 2, 3, -1, 0, 4;
+    p1->execute();
+    p2->execute();
+    simplified->execute();
+    complex->execute();
+    coincident->execute();
+    
+    //complete and directional gradients match the analytic ones
+    Eigen::Vector3d diff = sys.parameter().head<3>() - sys.parameter().tail<3>();
+    BOOST_CHECK_CLOSE(sys.residuals()(0), diff.norm() - 2, 1e-10);
+    BOOST_CHECK_CLOSE(sys.residuals()(1), diff.norm() - 2, 1e-10);
+    for(int i=0; i<3; ++i) {
+        BOOST_CHECK_CLOSE(sys.jacobi()(0, i), diff(i)/diff.norm(), 1e-10);
+        BOOST_CHECK_CLOSE(sys.jacobi()(0, i+3), -diff(i)/diff.norm(), 1e-10);
+        BOOST_CHECK_CLOSE(sys.jacobi()(1, i), diff(i)/diff.norm(), 1e-10);
+        BOOST_CHECK_CLOSE(sys.jacobi()(1, i+3), -diff(i)/diff.norm(), 1e-10);
+    }
+    
+    //the gradient of a vanishing norm is not finite and hence set to zero
+    BOOST_CHECK_EQUAL(sys.residuals()(2), 0);
+    BOOST_CHECK_EQUAL((sys.jacobi().row(2).norm()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(batch) {
+    
+    typedef dcm::numeric::Geometry<K, Point3>                                          Point;
+    typedef dcm::numeric::ConstraintSimplifiedEquation<K, dcm::Distance, Point3, Point3>  Equation;
+    
+    //more constraints than lanes to check the partially filled last batch
+    const int count = 6;
+    dcm::numeric::LinearSystem<K> sys(3*(count+1), count);
+    dcm::numeric::ConstraintBatch<K, dcm::Distance, Point3, Point3, 4> batch;
+    
+    auto center = std::make_shared<Point>();
+    center->init(sys);
+    std::vector<std::shared_ptr<Point>> points;
+    for(int i=0; i<count; ++i) {
+        points.push_back(std::make_shared<Point>());
+        points.back()->init(sys);
+        
+        auto eqn = std::make_shared<Equation>();
+        eqn->setInputEquations(points.back(), center);
+        eqn->distance() = i;
+        batch.add(eqn);
+    }
+    batch.init(sys);
+    BOOST_CHECK_EQUAL(batch.size(), count);
+    
+    sys.parameter().setRandom();
+    batch.execute();
+    
+    for(int i=0; i<count; ++i) {
+        Eigen::Vector3d diff = sys.parameter().segment<3>(3*(i+1)) - sys.parameter().head<3>();
+        BOOST_CHECK_CLOSE(sys.residuals()(i), diff.norm() - i, 1e-10);
+        for(int k=0; k<3; ++k) {
+            BOOST_CHECK_CLOSE(sys.jacobi()(i, 3*(i+1)+k), diff(k)/diff.norm(), 1e-10);
+            BOOST_CHECK_CLOSE(sys.jacobi()(i, k), -diff(k)/diff.norm(), 1e-10);
+        }
+    }
+    
+    //the batch provides the inputs of all equations for the flow graph
+    std::vector<dcm::numeric::Calculatable<K>*> inputs;
+    batch.collectInputs(inputs);
+    BOOST_CHECK_EQUAL(inputs.size(), 2*count);
+}
+
+BOOST_AUTO_TEST_CASE(batch_orientation) {
+    
+    typedef dcm::numeric::Geometry<K, Plane>                                        Geometry;
+    typedef dcm::numeric::ConstraintSimplifiedEquation<K, dcm::Orientation, Plane, Plane> Equation;
+    
+    //all orientation types mixed in one batch, evaluated once batched and once one by one
+    const dcm::Orientations types[] = {dcm::Orientations::Parallel, dcm::Orientations::Equal, 
+                                       dcm::Orientations::Opposite, dcm::Orientations::Perpendicular,
+                                       dcm::Orientations::Parallel};
+    const int count = 5;
+    dcm::numeric::LinearSystem<K> batchSys(6*(count+1), count), singleSys(6*(count+1), count);
+    dcm::numeric::ConstraintBatch<K, dcm::Orientation, Plane, Plane, 4> batch;
+    std::vector<std::shared_ptr<Equation>> singles;
+    
+    auto batchBase = std::make_shared<Geometry>(), singleBase = std::make_shared<Geometry>();
+    batchBase->init(batchSys);
+    singleBase->init(singleSys);
+    for(int i=0; i<count; ++i) {
+        auto batchPlane = std::make_shared<Geometry>(), singlePlane = std::make_shared<Geometry>();
+        batchPlane->init(batchSys);
+        singlePlane->init(singleSys);
+        
+        auto eqn = std::make_shared<Equation>();
+        eqn->setInputEquations(batchPlane, batchBase);
+        eqn->orientation() = types[i];
+        batch.add(eqn);
+        
+        singles.push_back(std::make_shared<Equation>());
+        singles.back()->setInputEquations(singlePlane, singleBase);
+        singles.back()->orientation() = types[i];
+        singles.back()->init(singleSys);
+    }
+    batch.init(batchSys);
+    
+    batchSys.parameter().setRandom();
+    singleSys.parameter() = batchSys.parameter();
+    batch.execute();
+    for(auto& eqn : singles)
+        eqn->calculate();
+    
+    for(int i=0; i<count; ++i) {
+        BOOST_CHECK_CLOSE(batchSys.residuals()(i), singleSys.residuals()(i), 1e-10);
+        for(int k=0; k<6*(count+1); ++k)
+            BOOST_CHECK_SMALL(batchSys.jacobi()(i, k) - singleSys.jacobi()(i, k), 1e-12);
+    }
+    
+    //parallel takes the closer one of equal and opposite, the point does not matter at all
+    Eigen::Vector3d d1 = batchSys.parameter().segment<3>(9), d2 = batchSys.parameter().segment<3>(3);
+    BOOST_CHECK_CLOSE(batchSys.residuals()(0), std::min((d1-d2).norm(), (d1+d2).norm()), 1e-10);
+    BOOST_CHECK_EQUAL((batchSys.jacobi().block<count, 3>(0, 0).norm()), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
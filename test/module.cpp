@@ -0,0 +1,238 @@
+/*
+    openDCM, dimensional constraint manager
+    Copyright (C) 2012  Stefan Troeger <stefantroeger@gmx.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along
+    with this library; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <opendcm/core/system.hpp>
+#include <opendcm/module3d/constraint.hpp>
+
+#include <deque>
+
+using namespace dcm;
+
+typedef dcm::Eigen3Kernel<double> K;
+
+//the smallest possible module, it only registers the point geometry and counts its degrees of freedom
+struct PointModule {
+
+    typedef boost::mpl::int_<5> ID;
+
+    template<typename Final, typename Stacked>
+    struct type : public Stacked {
+        
+        DCM_MODULE_ADD_GEOMETRIES(Stacked, (geometry::Point3))
+        
+        template<typename Reducer>
+        void setupReducer(Reducer& reducer) {
+            Stacked::setupReducer(reducer);
+            reducer.setDofCounting(6, [](const symbolic::Geometry&) {return 3;}, 
+                                      [](const symbolic::Constraint&) {return 1;});
+        };
+    };
+};
+
+typedef dcm::System<PointModule> PointSystem;
+
+//sets up the points and distances directly in the systems graph
+struct PointSetup {
+    
+    PointSystem                                              system;
+    std::shared_ptr<PointSystem::Graph>                      graph;
+    std::deque<symbolic::TypeGeometry<K, geometry::Point3>>  points;
+    std::deque<symbolic::TypeConstraint<Distance>>           distances;
+    std::vector<graph::LocalVertex>                          vertices;
+    std::vector<graph::GlobalEdge>                           constraints;
+    
+    PointSetup() : graph(std::static_pointer_cast<PointSystem::Graph>(system.getGraph())) {};
+    
+    void addPoint(double x, double y, double z) {
+        points.emplace_back();
+        points.back().setGeometryID(PointSystem::geometryIndex<geometry::Point3<K>>::value);
+        points.back().getPrimitveGeometry().point() = Eigen::Vector3d(x, y, z);
+        vertices.push_back(fusion::at_c<0>(graph->addVertex()));
+        graph->setProperty<symbolic::GeometryProperty>(vertices.back(), &points.back());
+    };
+    
+    void addDistance(int p1, int p2, double d) {
+        distances.emplace_back();
+        distances.back().setConstraintID(PointSystem::constraintIndex<Distance>::value);
+        distances.back().getPrimitveConstraint().distance() = d;
+        auto edge = graph->addEdge(vertices[p1], vertices[p2]);
+        constraints.push_back(fusion::at_c<1>(edge));
+        graph->setProperty<symbolic::ConstraintProperty>(constraints.back(), &distances.back());
+    };
+    
+    void setDistance(int c, double d) {
+        //the constraint may have been moved into a rigid subcluster, its change is marked there
+        distances[c].getPrimitveConstraint().distance() = d;
+        auto containing = graph->getLocalEdgeGraph(constraints[c]);
+        fusion::at_c<1>(containing)->setProperty<symbolic::ConstraintProperty>(constraints[c], &distances[c]);
+    };
+    
+    double distance(int p1, int p2) {
+        return (points[p1].getPrimitveGeometry().point() - points[p2].getPrimitveGeometry().point()).norm();
+    };
+};
+
+BOOST_AUTO_TEST_SUITE(Module_test_suit);
+
+BOOST_AUTO_TEST_CASE(solve) {
+    
+    PointSetup s;
+    s.addPoint(0, 0, 0);
+    s.addPoint(1, 0, 0);
+    s.addPoint(0, 1, 0);
+    s.addPoint(0, 2, 1);
+    s.addDistance(0, 1, 2);
+    s.addDistance(1, 2, 2);
+    s.addDistance(2, 0, 2);
+    s.addDistance(2, 3, 3);
+    
+    s.system.solve();
+    BOOST_CHECK_CLOSE(s.distance(0, 1), 2, 1e-6);
+    BOOST_CHECK_CLOSE(s.distance(1, 2), 2, 1e-6);
+    BOOST_CHECK_CLOSE(s.distance(2, 0), 2, 1e-6);
+    BOOST_CHECK_CLOSE(s.distance(2, 3), 3, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(solve_incremental) {
+    
+    //two triangles form two components
+    PointSetup s;
+    s.addPoint(0, 0, 0);
+    s.addPoint(1, 0, 0);
+    s.addPoint(0, 1, 0);
+    s.addPoint(0, 0, 5);
+    s.addPoint(1, 0, 5);
+    s.addPoint(0, 1, 5);
+    s.addDistance(0, 1, 2);
+    s.addDistance(1, 2, 2);
+    s.addDistance(2, 0, 2);
+    s.addDistance(3, 4, 3);
+    s.addDistance(4, 5, 3);
+    s.addDistance(5, 3, 3);
+    
+    s.system.solveIncremental();
+    BOOST_CHECK_CLOSE(s.distance(0, 1), 2, 1e-6);
+    BOOST_CHECK_CLOSE(s.distance(3, 4), 3, 1e-6);
+    
+    std::vector<Eigen::Vector3d> solved;
+    for(int i=3; i<6; ++i)
+        solved.push_back(s.points[i].getPrimitveGeometry().point());
+    
+    //the unchanged triangle keeps its solution
+    s.setDistance(0, 4);
+    s.system.solveIncremental();
+    BOOST_CHECK_CLOSE(s.distance(0, 1), 4, 1e-6);
+    BOOST_CHECK_CLOSE(s.distance(1, 2), 2, 1e-6);
+    BOOST_CHECK_CLOSE(s.distance(2, 0), 2, 1e-6);
+    for(int i=3; i<6; ++i)
+        BOOST_CHECK(s.points[i].getPrimitveGeometry().point() == solved[i-3]);
+}
+
+BOOST_AUTO_TEST_CASE(solve_batch) {
+    
+    PointSetup s;
+    s.addPoint(0, 0, 0);
+    s.addPoint(1, 0, 0);
+    s.addPoint(0, 1, 0);
+    s.addPoint(0, 2, 1);
+    s.addDistance(0, 1, 2);
+    s.addDistance(1, 2, 2);
+    s.addDistance(2, 0, 2);
+    s.addDistance(2, 3, 3);
+    
+    //every variant scales the triangle and the hanging distance
+    const int variants = 50;
+    std::vector<double> sides(variants, 0), hanging(variants, 0);
+    s.system.solveBatch(variants, 
+        [&](int i) {
+            for(int c=0; c<3; ++c)
+                s.distances[c].getPrimitveConstraint().distance() = 1 + 0.1*i;
+            s.distances[3].getPrimitveConstraint().distance() = 2 + 0.2*i;
+        },
+        [&](int i) {
+            sides[i]   = s.distance(0, 1);
+            hanging[i] = s.distance(2, 3);
+            BOOST_CHECK_CLOSE(s.distance(1, 2), 1 + 0.1*i, 1e-6);
+            BOOST_CHECK_CLOSE(s.distance(2, 0), 1 + 0.1*i, 1e-6);
+        }, 2);
+    
+    for(int i=0; i<variants; ++i) {
+        BOOST_CHECK_CLOSE(sides[i], 1 + 0.1*i, 1e-6);
+        BOOST_CHECK_CLOSE(hanging[i], 2 + 0.2*i, 1e-6);
+    }
+    
+    //a structural change afterwards is picked up as usual
+    s.addPoint(3, 3, 3);
+    s.addDistance(3, 4, 1);
+    s.system.solveIncremental();
+    BOOST_CHECK_CLOSE(s.distance(3, 4), 1, 1e-6);
+    BOOST_CHECK_CLOSE(s.distance(0, 1), 1 + 0.1*(variants-1), 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(solve_rigid_twice) {
+    
+    //a rigid tetrahedron with a two point chain hanging between two of its corners
+    PointSetup s;
+    s.addPoint(0, 0, 0);
+    s.addPoint(1, 0, 0);
+    s.addPoint(0, 1, 0);
+    s.addPoint(0, 0, 1);
+    s.addPoint(-1, -1, 0);
+    s.addPoint(2, -1, 0);
+    for(int i=0; i<4; ++i)
+        for(int j=i+1; j<4; ++j)
+            s.addDistance(i, j, 2);
+    s.addDistance(0, 4, 1);
+    s.addDistance(4, 5, 3);
+    s.addDistance(5, 1, 1);
+    
+    auto check = [&](double chain) {
+        for(int i=0; i<4; ++i)
+            for(int j=i+1; j<4; ++j)
+                BOOST_CHECK_CLOSE(s.distance(i, j), 2, 1e-6);
+        BOOST_CHECK_CLOSE(s.distance(0, 4), 1, 1e-6);
+        BOOST_CHECK_CLOSE(s.distance(4, 5), chain, 1e-6);
+        BOOST_CHECK_CLOSE(s.distance(5, 1), 1, 1e-6);
+        
+        //the tetrahedron is collapsed once and never nested again
+        BOOST_REQUIRE_EQUAL(s.graph->numClusters(), 1);
+        BOOST_CHECK_EQUAL(s.graph->clusters().first->second->numClusters(), 0);
+        BOOST_CHECK_EQUAL(s.graph->clusters().first->second->vertexCount(), 4);
+    };
+    
+    s.system.solve();
+    check(3);
+    
+    s.setDistance(7, 3.5);
+    s.system.solve();
+    check(3.5);
+    
+    s.setDistance(7, 2.5);
+    s.system.solveIncremental();
+    check(2.5);
+    
+    s.setDistance(7, 3);
+    s.system.solveIncremental();
+    check(3);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -22,6 +22,7 @@
 #include "opendcm/core/equations.hpp"
 #include "opendcm/core/geometry.hpp"
 #include "opendcm/core/kernel.hpp"
+#include "opendcm/core/solver.hpp"
 
 #include <boost/fusion/include/at.hpp>
 
@@ -108,6 +109,25 @@ using namespace dcm;
 
 
 
+template<typename Kernel>
+struct TMappedLine3 : public geometry::Geometry<Kernel, numeric::MappedVector<Kernel, 3>,
+                                    typename Kernel::Scalar, numeric::MappedVector<Kernel, 3>> {
+
+    typedef geometry::Geometry<Kernel, numeric::MappedVector<Kernel, 3>,
+                                 typename Kernel::Scalar, numeric::MappedVector<Kernel, 3>> Inherited;
+    using Inherited::m_storage;
+    
+    auto point() -> decltype(fusion::at_c<0>(m_storage)) {
+        return fusion::at_c<0>(m_storage);
+    };
+    auto length() -> decltype(fusion::at_c<1>(m_storage)) {
+        return fusion::at_c<1>(m_storage);
+    };
+    auto direction() -> decltype(fusion::at_c<2>(m_storage)) {
+        return fusion::at_c<2>(m_storage);
+    };
+};
+
 BOOST_AUTO_TEST_SUITE(Numeric_test_suit);
 
 BOOST_AUTO_TEST_CASE(equations) {
@@ -281,6 +301,98 @@ BOOST_AUTO_TEST_CASE(geometry) {
 };
     
 
+BOOST_AUTO_TEST_CASE(parameter_layout) {
+    
+    //the layout of the parameters is known at compile time
+    typedef dcm::detail::ParameterLayout<TCylinder3<K>::Storage> Layout;
+    static_assert(Layout::Count == 7, "Wrong parameter count");
+    static_assert(Layout::offset<1>::value == 3, "Wrong parameter offset");
+    static_assert(Layout::offset<2>::value == 4, "Wrong parameter offset");
+    static_assert(Layout::size<2>::value == 3, "Wrong parameter size");
+    
+    //and all parameters are mapped as one contiguous block
+    numeric::LinearSystem<K> sys(10,10); 
+    numeric::Geometry<K, TDirection3> dirGeom;
+    numeric::Geometry<K, TCylinder3> cylGeom;
+    BOOST_CHECK_EQUAL(cylGeom.newParameterCount(), 7u);
+    
+    dirGeom.init(sys);
+    cylGeom.init(sys);
+    BOOST_CHECK(cylGeom.parameterBlock() == &sys.parameter()(3));
+    for(int i=0; i<7; ++i) {
+        BOOST_CHECK_EQUAL(cylGeom.parameters()[i].Index, i+3);
+        BOOST_CHECK(cylGeom.parameters()[i].Value == cylGeom.parameterBlock()+i);
+    }
+    
+    sys.parameter() << 1, 2, 3, 4, 5, 6, 7, 8, 9, 10;
+    cylGeom.execute();
+    BOOST_CHECK(cylGeom.point().isApprox(Eigen::Vector3d(4,5,6)));
+    BOOST_CHECK_EQUAL(cylGeom.radius(), 7);
+    BOOST_CHECK(cylGeom.direction().isApprox(Eigen::Vector3d(8,9,10)));
+    
+    //only changed parameters lead to a new version
+    const unsigned int version = cylGeom.version();
+    cylGeom.execute();
+    BOOST_CHECK_EQUAL(cylGeom.version(), version);
+    sys.parameter()(9) = 11;
+    cylGeom.execute();
+    BOOST_CHECK_EQUAL(cylGeom.version(), version+1);
+    BOOST_CHECK_EQUAL(cylGeom.direction()(2), 11);
+}
+
+BOOST_AUTO_TEST_CASE(mapped_geometry) {
+    
+    //mapped storage behaves like a normal eigen type with own storage
+    TMappedLine3<K> line;
+    line.point() << 1, 2, 3;
+    line.direction() = Eigen::Vector3d(4, 5, 6);
+    BOOST_CHECK(!line.point().isMapped());
+    BOOST_CHECK_CLOSE(line.point().dot(line.direction()), 32, 1e-10);
+    
+    TMappedLine3<K> copy(line);
+    copy.point()(0) = 7;
+    BOOST_CHECK_EQUAL(line.point()(0), 1);
+    
+    //in a numeric geometry the vectors alias the system parameters, the values are taken over
+    numeric::LinearSystem<K> sys(8,1); 
+    numeric::Geometry<K, TMappedLine3> geom;
+    geom.output() = line;
+    BOOST_CHECK_EQUAL(geom.newParameterCount(), 7u);
+    geom.init(sys);
+    
+    BOOST_CHECK(geom.point().isMapped());
+    BOOST_CHECK(geom.point().data() == &sys.parameter()(0));
+    BOOST_CHECK(geom.direction().data() == &sys.parameter()(4));
+    BOOST_CHECK(sys.parameter().segment<3>(4).isApprox(Eigen::Vector3d(4,5,6)));
+    
+    //changes are visible without any copy, only the scalar is still assigned on calculate
+    sys.parameter().head<7>() << 9, 8, 7, 2, 6, 5, 4;
+    BOOST_CHECK(geom.point().isApprox(Eigen::Vector3d(9,8,7)));
+    BOOST_CHECK(geom.direction().isApprox(Eigen::Vector3d(6,5,4)));
+    geom.execute();
+    BOOST_CHECK_EQUAL(geom.length(), 2);
+    
+    //copies of mapped storage own the values the storage currently points to
+    TMappedLine3<K> mappedCopy(geom.output());
+    BOOST_CHECK(!mappedCopy.point().isMapped());
+    BOOST_CHECK(mappedCopy.point().isApprox(Eigen::Vector3d(9,8,7)));
+    mappedCopy.point()(0) = 1;
+    BOOST_CHECK_EQUAL(sys.parameter()(0), 9);
+    
+    Eigen::Vector3d external(7, 8, 9);
+    details::MapMatrix<Eigen::Vector3d> mapped(Eigen::Vector3d(1, 2, 3));
+    mapped.mapTo(external.data());
+    details::MapMatrix<Eigen::Vector3d> mappedMatrixCopy(mapped);
+    BOOST_CHECK(!mappedMatrixCopy.isMapped());
+    BOOST_CHECK(mappedMatrixCopy.isApprox(Eigen::Vector3d(7, 8, 9)));
+    
+    //derivatives are independent of the parameters
+    BOOST_REQUIRE_EQUAL(geom.derivatives().size(), 7u);
+    BOOST_CHECK(!geom.derivatives()[0].first.point().isMapped());
+    BOOST_CHECK_EQUAL(geom.derivatives()[0].first.point()(0), 1);
+    BOOST_CHECK_EQUAL(geom.derivatives()[5].first.direction()(1), 1);
+}
+
 BOOST_AUTO_TEST_CASE(parameter_geometry) {
 
     numeric::LinearSystem<K> sys(10,10); 
@@ -345,4 +457,584 @@ BOOST_AUTO_TEST_CASE(parameter_geometry) {
 };
 
 
+BOOST_AUTO_TEST_CASE(versioning) {
+    
+    numeric::LinearSystem<K> sys(6,1); 
+    auto g1 = std::make_shared<numeric::Geometry<K, TDirection3>>();
+    auto g2 = std::make_shared<numeric::Geometry<K, TDirection3>>();
+    g1->init(sys);
+    g2->init(sys);
+    
+    //the norm of both geometries and their sum, counting all value calculations
+    int normCalls = 0, sumCalls = 0;
+    auto norm = [&](TDirection3<K>& in, double& out) {
+        ++normCalls;
+        out = in.value().norm();
+    };
+    auto normDerivative = [](TDirection3<K>& in, TDirection3<K>& din, double& out) {
+        out = in.value().dot(din.value())/in.value().norm();
+    };
+    auto n1 = numeric::makeUnaryEquation<K, TDirection3<K>, double>(norm, normDerivative);
+    auto n2 = numeric::makeUnaryEquation<K, TDirection3<K>, double>(norm, normDerivative);
+    n1->setInputEquation(g1);
+    n2->setInputEquation(g2);
+    n1->init(sys);
+    n2->init(sys);
+    
+    auto sum = numeric::makeBinaryEquation<K, double, double, double>(
+        [&](double& a, double& b, double& out) {++sumCalls; out = a+b;},
+        [](double& /*a*/, double& /*b*/, double& da, double& out) {out = da;},
+        [](double& /*a*/, double& /*b*/, double& db, double& out) {out = db;});
+    sum->setInputEquations(n1, n2);
+    sum->init(sys);
+    
+    auto calculate = [&]() {
+        for(numeric::Calculatable<K>* calc : {(numeric::Calculatable<K>*)g1.get(), 
+                (numeric::Calculatable<K>*)g2.get(), (numeric::Calculatable<K>*)n1.get(), 
+                (numeric::Calculatable<K>*)n2.get(), (numeric::Calculatable<K>*)sum.get()})
+            calc->execute();
+    };
+    
+    sys.parameter() << 3, 4, 0, 0, 6, 8;
+    calculate();
+    BOOST_CHECK_EQUAL(normCalls, 2);
+    BOOST_CHECK_EQUAL(sumCalls, 1);
+    BOOST_CHECK_CLOSE(sum->output(), 15, 1e-10);
+    BOOST_CHECK_EQUAL(g1->version(), 1);
+    
+    //unchanged parameters do not lead to any calculation
+    calculate();
+    BOOST_CHECK_EQUAL(normCalls, 2);
+    BOOST_CHECK_EQUAL(sumCalls, 1);
+    BOOST_CHECK_EQUAL(g1->version(), 1);
+    
+    //only the changed branch is recalculated
+    sys.parameter()(5) = 0;
+    calculate();
+    BOOST_CHECK_EQUAL(normCalls, 3);
+    BOOST_CHECK_EQUAL(sumCalls, 2);
+    BOOST_CHECK_EQUAL(g1->version(), 1);
+    BOOST_CHECK_EQUAL(g2->version(), 2);
+    BOOST_CHECK_CLOSE(sum->output(), 11, 1e-10);
+    BOOST_CHECK_CLOSE(n2->derivatives()[1].first, 1, 1e-10);
+    
+    //invalidated equations are recalculated anyway
+    n1->invalidate();
+    calculate();
+    BOOST_CHECK_EQUAL(normCalls, 4);
+    BOOST_CHECK_EQUAL(sumCalls, 3);
+}
+
+BOOST_AUTO_TEST_CASE(fused_equations) {
+    
+    numeric::LinearSystem<K> sys(6,1); 
+    auto g1 = std::make_shared<numeric::Geometry<K, TDirection3>>();
+    auto g2 = std::make_shared<numeric::Geometry<K, TDirection3>>();
+    g1->init(sys);
+    g2->init(sys);
+    sys.parameter() << 1, 2, 3, -2, 1, 4;
+    g1->execute();
+    g2->execute();
+    
+    //scale the vector and calculate its norm, once fused and once as equation chain
+    auto vector = [](TDirection3<K>& in, Eigen::Vector3d& out) {out = 2*in.value();};
+    auto dvector = [](TDirection3<K>& /*in*/, TDirection3<K>& din, Eigen::Vector3d& out) {out = 2*din.value();};
+    auto norm = [](Eigen::Vector3d& in, double& out) {out = in.norm();};
+    auto dnorm = [](Eigen::Vector3d& in, Eigen::Vector3d& din, double& out) {out = in.dot(din)/in.norm();};
+    auto square = [](double& in, double& out) {out = in*in;};
+    auto dsquare = [](double& in, double& din, double& out) {out = 2*in*din;};
+    
+    auto fused = numeric::makeFusedEquation<K>(numeric::compose(
+        numeric::makeUnaryExpression<TDirection3<K>, Eigen::Vector3d>(vector, dvector),
+        numeric::makeUnaryExpression<Eigen::Vector3d, double>(norm, dnorm),
+        numeric::makeUnaryExpression<double, double>(square, dsquare)));
+    fused->setInputEquation(g1);
+    
+    auto scaled = numeric::makeUnaryEquation<K, TDirection3<K>, Eigen::Vector3d>(vector, dvector);
+    scaled->setInputEquation(g1);
+    auto chain = numeric::makeUnaryEquation<K, double, double>(
+                    numeric::makeUnaryEquation<K, Eigen::Vector3d, double>(scaled, norm, dnorm), 
+                    square, dsquare);
+    
+    //the fused equation owns no intermediate equations
+    BOOST_CHECK(fused->inputEquation() == g1);
+    
+    fused->init(sys);
+    chain->init(sys);
+    fused->execute();
+    chain->execute();
+    
+    BOOST_CHECK_CLOSE(fused->output(), 56, 1e-10);
+    BOOST_CHECK_CLOSE(chain->output(), 56, 1e-10);
+    BOOST_REQUIRE_EQUAL(fused->derivatives().size(), 3u);
+    BOOST_REQUIRE_EQUAL(chain->derivatives().size(), 3u);
+    for(int i=0; i<3; ++i) {
+        BOOST_CHECK_CLOSE(fused->derivatives()[i].first, 8*sys.parameter()(i), 1e-10);
+        BOOST_CHECK_CLOSE(fused->derivatives()[i].first, chain->derivatives()[i].first, 1e-10);
+        BOOST_CHECK(fused->derivatives()[i].second == chain->derivatives()[i].second);
+    }
+    
+    //inputs can be owned by the fused equation
+    auto owned = numeric::makeFusedEquation<K>(std::make_shared<numeric::Equation<K, double>>(3.), 
+                                               numeric::makeUnaryExpression<double, double>(square, dsquare));
+    BOOST_CHECK(owned->hasInputOwnership());
+    owned->init(sys);
+    owned->execute();
+    BOOST_CHECK_CLOSE(owned->output(), 9, 1e-10);
+    
+    //a binary expression followed by unary ones: (g1 . g2)^2
+    auto dot = numeric::makeBinaryExpression<TDirection3<K>, TDirection3<K>, double>(
+        [](TDirection3<K>& a, TDirection3<K>& b, double& out) {out = a.value().dot(b.value());},
+        [](TDirection3<K>& /*a*/, TDirection3<K>& b, TDirection3<K>& da, double& out) {out = da.value().dot(b.value());},
+        [](TDirection3<K>& a, TDirection3<K>& /*b*/, TDirection3<K>& db, double& out) {out = a.value().dot(db.value());});
+    
+    auto binary = numeric::makeFusedEquation<K>(numeric::compose(dot, 
+                      numeric::makeUnaryExpression<double, double>(square, dsquare)));
+    binary->setInputEquations(g1, g2);
+    binary->init(sys);
+    binary->execute();
+    
+    BOOST_CHECK_CLOSE(binary->output(), 144, 1e-10);
+    BOOST_REQUIRE_EQUAL(binary->derivatives().size(), 6u);
+    for(int i=0; i<3; ++i) {
+        BOOST_CHECK_CLOSE(binary->derivatives()[i].first, 24*sys.parameter()(i+3), 1e-10);
+        BOOST_CHECK_CLOSE(binary->derivatives()[i+3].first, 24*sys.parameter()(i), 1e-10);
+    }
+}
+
+//generic functors for automatic differentiation, called with dual numbers
+struct SquaredNorm {
+    template<typename Vector, typename Scalar>
+    void operator()(const Vector& in, Scalar& out) const {
+        out = in.norm();
+        out = out*out;
+    };
+};
+
+struct Dot {
+    template<typename Vector, typename Scalar>
+    void operator()(const Vector& a, const Vector& b, Scalar& out) const {
+        out = sin(a.dot(b));
+    };
+};
+
+BOOST_AUTO_TEST_CASE(automatic_differentiation) {
+    
+    //dual numbers give the value and all lanes of the derivative at once
+    typedef numeric::Dual<double, 3> Dual;
+    Eigen::Matrix<Dual, 3, 1> v;
+    for(int i=0; i<3; ++i)
+        v(i) = Dual(i+1, Eigen::Vector3d::Unit(i));
+    
+    Dual n = v.norm();
+    BOOST_CHECK_CLOSE(n.value, std::sqrt(14.), 1e-10);
+    for(int i=0; i<3; ++i)
+        BOOST_CHECK_CLOSE(n.gradient(i), (i+1)/std::sqrt(14.), 1e-10);
+    
+    Dual d = v.dot(2*v) / Dual(2.);
+    BOOST_CHECK_CLOSE(d.value, 14, 1e-10);
+    for(int i=0; i<3; ++i)
+        BOOST_CHECK_CLOSE(d.gradient(i), 2*(i+1), 1e-10);
+    
+    numeric::LinearSystem<K> sys(6,1); 
+    auto g1 = std::make_shared<numeric::Geometry<K, TDirection3>>();
+    auto g2 = std::make_shared<numeric::Geometry<K, TDirection3>>();
+    g1->init(sys);
+    g2->init(sys);
+    sys.parameter() << 1, 2, 3, -2, 1, 4;
+    g1->execute();
+    g2->execute();
+    
+    auto vector = [](TDirection3<K>& in, Eigen::Vector3d& out) {out = 2*in.value();};
+    auto dvector = [](TDirection3<K>& /*in*/, TDirection3<K>& din, Eigen::Vector3d& out) {out = 2*din.value();};
+    auto scaled1 = numeric::makeUnaryEquation<K, TDirection3<K>, Eigen::Vector3d>(vector, dvector);
+    auto scaled2 = numeric::makeUnaryEquation<K, TDirection3<K>, Eigen::Vector3d>(vector, dvector);
+    scaled1->setInputEquation(g1);
+    scaled2->setInputEquation(g2);
+    scaled1->init(sys);
+    scaled2->init(sys);
+    scaled1->execute();
+    scaled2->execute();
+    
+    //less lanes than derivatives need multiple passes
+    auto norm = numeric::makeAutoDiffUnaryEquation<K, Eigen::Vector3d, double, 2>(SquaredNorm());
+    norm->setInputEquation(scaled1);
+    norm->init(sys);
+    norm->execute();
+    
+    BOOST_CHECK_CLOSE(norm->output(), 56, 1e-10);
+    BOOST_REQUIRE_EQUAL(norm->derivatives().size(), 3u);
+    for(int i=0; i<3; ++i) {
+        BOOST_CHECK_CLOSE(norm->derivatives()[i].first, 8*sys.parameter()(i), 1e-10);
+        BOOST_CHECK(norm->derivatives()[i].second == scaled1->derivatives()[i].second);
+    }
+    
+    //the lanes are distributed over the derivatives of both inputs
+    auto dot = numeric::makeAutoDiffBinaryEquation<K, Eigen::Vector3d, Eigen::Vector3d, double, 4>(Dot());
+    dot->setInputEquations(scaled1, scaled2);
+    dot->init(sys);
+    dot->execute();
+    
+    const double value = 4*sys.parameter().head(3).dot(sys.parameter().tail(3));
+    BOOST_CHECK_CLOSE(dot->output(), std::sin(value), 1e-10);
+    BOOST_REQUIRE_EQUAL(dot->derivatives().size(), 6u);
+    for(int i=0; i<3; ++i) {
+        BOOST_CHECK_CLOSE(dot->derivatives()[i].first, 4*std::cos(value)*sys.parameter()(i+3), 1e-10);
+        BOOST_CHECK_CLOSE(dot->derivatives()[i+3].first, 4*std::cos(value)*sys.parameter()(i), 1e-10);
+    }
+    
+    //unchanged inputs do not trigger a recalculation
+    const unsigned int version = dot->version();
+    dot->execute();
+    BOOST_CHECK_EQUAL(dot->version(), version);
+}
+
+BOOST_AUTO_TEST_CASE(arena) {
+    
+    //allocations are aligned and served from few chunks
+    numeric::Arena arena(256);
+    void* a = arena.allocate(10, 1);
+    void* b = arena.allocate(64, 32);
+    BOOST_CHECK_EQUAL(reinterpret_cast<std::size_t>(b) % 32, 0);
+    BOOST_CHECK(static_cast<char*>(b) >= static_cast<char*>(a) + 10);
+    BOOST_CHECK_EQUAL(arena.chunkCount(), 1u);
+    BOOST_CHECK(arena.contains(a) && arena.contains(b));
+    
+    arena.allocate(1000, 8);
+    BOOST_CHECK_EQUAL(arena.chunkCount(), 2u);
+    BOOST_CHECK_EQUAL(arena.allocated(), 1074u);
+    
+    arena.release();
+    BOOST_CHECK_EQUAL(arena.chunkCount(), 0u);
+    BOOST_CHECK_EQUAL(arena.capacity(), 0);
+    
+    //equations allocate their storage in the arena of the system in initialisation order
+    std::shared_ptr<numeric::Geometry<K, TDirection3>> g1, g2;
+    std::shared_ptr<numeric::UnaryEquation<K, TDirection3<K>, Eigen::Vector3d>> scaled;
+    {
+        numeric::LinearSystem<K> sys(6,1); 
+        g1 = std::make_shared<numeric::Geometry<K, TDirection3>>();
+        g2 = std::make_shared<numeric::Geometry<K, TDirection3>>();
+        scaled = numeric::makeUnaryEquation<K, TDirection3<K>, Eigen::Vector3d>(
+                    [](TDirection3<K>& in, Eigen::Vector3d& out) {out = 2*in.value();},
+                    [](TDirection3<K>& /*in*/, TDirection3<K>& din, Eigen::Vector3d& out) {out = 2*din.value();});
+        scaled->setInputEquation(g1);
+        
+        g1->init(sys);
+        g2->init(sys);
+        scaled->init(sys);
+        
+        BOOST_REQUIRE(sys.arena());
+        BOOST_CHECK(sys.arena()->contains(g1->parameters().data()));
+        BOOST_CHECK(sys.arena()->contains(g1->derivatives().data()));
+        BOOST_CHECK(sys.arena()->contains(scaled->derivatives().data()));
+        BOOST_CHECK(g1->derivatives().data() < g2->derivatives().data());
+        BOOST_CHECK_EQUAL(g1->derivatives().capacity(), 3);
+        BOOST_CHECK_EQUAL(sys.arena()->chunkCount(), 1u);
+        
+        //initializing again with the same system reuses the storage
+        const std::size_t allocated = sys.arena()->allocated();
+        const void* derivatives = scaled->derivatives().data();
+        scaled->takeInputOwnership(false);
+        scaled->init(sys);
+        BOOST_CHECK_EQUAL(sys.arena()->allocated(), allocated);
+        BOOST_CHECK(scaled->derivatives().data() == derivatives);
+        
+        sys.parameter() << 1, 2, 3, -2, 1, 4;
+        g1->execute();
+        scaled->execute();
+    }
+    
+    //the equations keep the arena alive after the system is gone
+    BOOST_CHECK(g1->derivatives().get_allocator().arena());
+    BOOST_CHECK_EQUAL(scaled->derivatives().size(), 3u);
+    BOOST_CHECK_EQUAL(scaled->output()(2), 6);
+}
+
+BOOST_AUTO_TEST_CASE(sparse_system) {
+
+    numeric::LinearSystem<K> dense(40,30);
+    numeric::LinearSystem<K> sparse(40,30, numeric::JacobiStorage::Sparse);
+    
+    BOOST_CHECK(!dense.isSparse());
+    BOOST_CHECK(sparse.isSparse());
+    BOOST_CHECK_EQUAL(sparse.jacobiEntryCount(), 0);
+    
+    //map some entries and remember the pointers, they must stay valid while the pattern grows
+    double* s1;
+    numeric::MatrixEntry<K> e1 = sparse.mapJacobi(0, 1, s1);
+    numeric::MatrixEntry<K> e2 = sparse.mapJacobi(2, 1);
+    numeric::MatrixEntry<K> e3 = sparse.mapJacobi(0, 39);
+    BOOST_CHECK(e1.Value == s1);
+    BOOST_CHECK(sparse.mapJacobi(0, 1).Value == s1);
+    BOOST_CHECK_EQUAL(sparse.jacobiEntryCount(), 3);
+    
+    for(int i=0; i<30; ++i) {
+        sparse.mapJacobi(i, i);
+        dense.mapJacobi(i, i);
+    }
+    BOOST_CHECK_EQUAL(sparse.jacobiEntryCount(), 33);
+    
+    *e1.Value = 1;
+    *e2.Value = 2;
+    *e3.Value = 3;
+    dense.jacobiAt(0,1) = 1;
+    dense.jacobiAt(2,1) = 2;
+    dense.jacobiAt(0,39) = 3;
+    for(int i=0; i<30; ++i) {
+        sparse.jacobiAt(i,i) = i+1;
+        dense.jacobiAt(i,i) = i+1;
+    }
+    BOOST_CHECK(e1.Value == &sparse.jacobiAt(0,1));
+    
+    auto& sj = sparse.sparseJacobi();
+    BOOST_CHECK_EQUAL(sj.rows(), 30);
+    BOOST_CHECK_EQUAL(sj.cols(), 40);
+    BOOST_CHECK_EQUAL(sj.nonZeros(), 33);
+    BOOST_CHECK(Eigen::MatrixXd(sj).isApprox(dense.jacobi()));
+    BOOST_CHECK(Eigen::MatrixXd(dense.sparseJacobi()).isApprox(dense.jacobi()));
+    
+    //changing values keeps the structure, only the values are updated
+    *e2.Value = 5;
+    dense.jacobiAt(2,1) = 5;
+    BOOST_CHECK_EQUAL(sparse.sparseJacobi().nonZeros(), 33);
+    BOOST_CHECK(Eigen::MatrixXd(sparse.sparseJacobi()).isApprox(dense.jacobi()));
+    
+    //setup resets the values but keeps the pattern
+    sparse.setupJacobi();
+    BOOST_CHECK_EQUAL(sparse.sparseJacobi().nonZeros(), 33);
+    BOOST_CHECK_SMALL(Eigen::MatrixXd(sparse.sparseJacobi()).norm(), 1e-12);
+    
+    //in dense mode all entries are structural, zero values must not change the pattern
+    const std::size_t signature = numeric::NormalEquations<K>::patternSignature(dense.sparseJacobi());
+    BOOST_CHECK_EQUAL(dense.sparseJacobi().nonZeros(), 30*40);
+    dense.jacobiAt(2,1) = 0;
+    BOOST_CHECK_EQUAL(dense.sparseJacobi().nonZeros(), 30*40);
+    BOOST_CHECK_EQUAL(numeric::NormalEquations<K>::patternSignature(dense.sparseJacobi()), signature);
+    BOOST_CHECK(Eigen::MatrixXd(dense.sparseJacobi()).isApprox(dense.jacobi()));
+};
+
+//three orthonormal vectors: underdetermined, 9 parameters and 6 equations
+template<typename Kernel>
+void orthonormal(numeric::LinearSystem<Kernel>& sys) {
+    
+    auto v = [&](int i) {return sys.parameter().template segment<3>(3*i);};
+    int eq = 0;
+    for(int i=0; i<3; ++i) {
+        for(int j=i+1; j<3; ++j, ++eq) {
+            sys.residuals()(eq) = v(i).dot(v(j));
+            for(int k=0; k<3; ++k) {
+                sys.jacobiAt(eq, 3*i+k) = v(j)(k);
+                sys.jacobiAt(eq, 3*j+k) = v(i)(k);
+            }
+        }
+        sys.residuals()(3+i) = v(i).squaredNorm() - 1;
+        for(int k=0; k<3; ++k)
+            sys.jacobiAt(3+i, 3*i+k) = 2*v(i)(k);
+    }
+};
+
+//point with given distances to three reference points: overdetermined, 2 parameters and 3 equations
+template<typename Kernel>
+void trilateration(numeric::LinearSystem<Kernel>& sys) {
+    
+    Eigen::Vector2d ref[3] = {Eigen::Vector2d(0,0), Eigen::Vector2d(4,0), Eigen::Vector2d(0,3)};
+    Eigen::Vector2d target(1,1);
+    Eigen::Vector2d p = sys.parameter();
+    for(int i=0; i<3; ++i) {
+        sys.residuals()(i) = (p-ref[i]).squaredNorm() - (target-ref[i]).squaredNorm();
+        sys.jacobiAt(i, 0) = 2*(p-ref[i])(0);
+        sys.jacobiAt(i, 1) = 2*(p-ref[i])(1);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(dogleg) {
+
+    K kernel;
+    
+    for(auto storage : {numeric::JacobiStorage::Dense, numeric::JacobiStorage::Sparse}) {
+        
+        numeric::LinearSystem<K> sys(9, 6, storage);
+        sys.parameter() << 1, 0.2, 0.1,  0.3, 1, -0.2,  0.1, 0.4, 1;
+        auto functor = [&]() {orthonormal(sys);};
+        
+        BOOST_CHECK_EQUAL(kernel.solve(sys, functor), 1);
+        BOOST_CHECK_SMALL(sys.residuals().norm(), 1e-10);
+        BOOST_CHECK_GT(kernel.solver().iter, 0);
+        
+        Eigen::Matrix3d m = Eigen::Map<Eigen::Matrix3d>(sys.parameter().data());
+        BOOST_CHECK((m.transpose()*m).isApprox(Eigen::Matrix3d::Identity(), 1e-8));
+        
+        numeric::LinearSystem<K> sys2(2, 3, storage);
+        sys2.parameter() << 3, 2;
+        auto functor2 = [&]() {trilateration(sys2);};
+        
+        BOOST_CHECK_EQUAL(kernel.solve(sys2, functor2), 1);
+        BOOST_CHECK_SMALL((sys2.parameter() - Eigen::Vector2d(1,1)).norm(), 1e-8);
+    }
+};
+
+//rosenbrock valley: badly scaled, the solution lies at the end of a long curved valley
+template<typename Kernel>
+void rosenbrock(numeric::LinearSystem<Kernel>& sys) {
+    
+    const double x = sys.parameter()(0), y = sys.parameter()(1);
+    sys.residuals()(0) = 100*(y - x*x);
+    sys.residuals()(1) = 1 - x;
+    sys.jacobiAt(0, 0) = -200*x;
+    sys.jacobiAt(0, 1) = 100;
+    sys.jacobiAt(1, 0) = -1;
+};
+
+BOOST_AUTO_TEST_CASE(levenberg_marquardt) {
+
+    typedef dcm::Eigen3Kernel<double, numeric::LevenbergMarquardt> LMK;
+    LMK kernel;
+    
+    for(auto storage : {numeric::JacobiStorage::Dense, numeric::JacobiStorage::Sparse}) {
+        for(bool geodesic : {true, false}) {
+            
+            kernel.solver().geodesic = geodesic;
+            
+            numeric::LinearSystem<LMK> sys(9, 6, storage);
+            sys.parameter() << 1, 0.2, 0.1,  0.3, 1, -0.2,  0.1, 0.4, 1;
+            auto functor = [&]() {orthonormal(sys);};
+            
+            BOOST_CHECK_EQUAL(kernel.solve(sys, functor), 1);
+            BOOST_CHECK_SMALL(sys.residuals().norm(), 1e-10);
+            BOOST_CHECK_GT(kernel.solver().iter, 0);
+            BOOST_CHECK_GE(kernel.solver().evaluations, kernel.solver().iter);
+            
+            numeric::LinearSystem<LMK> sys2(2, 3, storage);
+            sys2.parameter() << 3, 2;
+            auto functor2 = [&]() {trilateration(sys2);};
+            
+            BOOST_CHECK_EQUAL(kernel.solve(sys2, functor2), 1);
+            BOOST_CHECK_SMALL((sys2.parameter() - Eigen::Vector2d(1,1)).norm(), 1e-8);
+            
+            numeric::LinearSystem<LMK> sys3(2, 2, storage);
+            sys3.parameter() << -1.2, 1;
+            auto functor3 = [&]() {rosenbrock(sys3);};
+            
+            BOOST_CHECK_EQUAL(kernel.solve(sys3, functor3), 1);
+            BOOST_CHECK_SMALL((sys3.parameter() - Eigen::Vector2d(1,1)).norm(), 1e-8);
+            BOOST_CHECK_SMALL(sys3.residuals().norm(), 1e-10);
+            BOOST_CHECK_EQUAL(kernel.solver().accelerated > 0, geodesic);
+        }
+    }
+};
+
+BOOST_AUTO_TEST_CASE(normal_equations) {
+
+    typedef numeric::NormalEquations<K> Normal;
+    
+    //regular systems give the exact gauss-newton step, no regularization is added
+    Eigen::MatrixXd J(2,2);
+    J << 2, 1, 
+         1, 3;
+    Eigen::VectorXd F(2), h;
+    F << 1, -2;
+    const Eigen::VectorXd exact = -J.fullPivLu().solve(F);
+    
+    Normal normal;
+    BOOST_CHECK(normal.solve(J, F, 0., h));
+    BOOST_CHECK_SMALL((h - exact).norm(), 1e-14);
+    Eigen::SparseMatrix<double> sparseJ = J.sparseView();
+    BOOST_CHECK(normal.solve(sparseJ, F, 0., h));
+    BOOST_CHECK_SMALL((h - exact).norm(), 1e-14);
+    
+    //redundant systems are regularized and still give a usable step
+    Eigen::MatrixXd R(3,2);
+    R << 1, 1, 
+         1, 1,
+         0, 1;
+    Eigen::VectorXd G(3);
+    G << 1, 1, 2;
+    BOOST_CHECK(normal.solve(R, G, 0., h));
+    BOOST_CHECK((R*h).isApprox(-G, 1e-6));
+    Eigen::SparseMatrix<double> sparseR = R.sparseView();
+    BOOST_CHECK(normal.solve(sparseR, G, 0., h));
+    BOOST_CHECK((R*h).isApprox(-G, 1e-6));
+    BOOST_CHECK_EQUAL(normal.factorizeCount(), 4);
+    
+    //the dogleg solver factorizes every accepted jacobi once, rejected steps reuse the last step
+    for(auto storage : {numeric::JacobiStorage::Dense, numeric::JacobiStorage::Sparse}) {
+    
+        K kernel;
+        numeric::LinearSystem<K> sys(2, 2, storage);
+        sys.parameter() << -1.2, 1;
+        auto functor = [&]() {rosenbrock(sys);};
+        
+        BOOST_CHECK_EQUAL(kernel.solve(sys, functor), 1);
+        BOOST_CHECK_GT(kernel.solver().unused, 0);
+        BOOST_CHECK_EQUAL(kernel.solver().m_normal.factorizeCount(), 
+                          kernel.solver().iter - kernel.solver().unused);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(symbolic_reuse) {
+
+    K kernel;
+    
+    numeric::LinearSystem<K> sys(9, 6, numeric::JacobiStorage::Sparse);
+    sys.parameter() << 1, 0.2, 0.1,  0.3, 1, -0.2,  0.1, 0.4, 1;
+    auto functor = [&]() {orthonormal(sys);};
+    
+    BOOST_CHECK_EQUAL(kernel.solve(sys, functor), 1);
+    BOOST_CHECK_GT(kernel.solver().iter, 1);
+    BOOST_CHECK_EQUAL(kernel.solver().m_normal.analyzeCount(), 1);
+    
+    //a new system with the same structure reuses the analysis
+    numeric::LinearSystem<K> sys2(9, 6, numeric::JacobiStorage::Sparse);
+    sys2.parameter() << 1, -0.2, 0.3,  0.1, 1, 0.2,  -0.1, 0.3, 1;
+    auto functor2 = [&]() {orthonormal(sys2);};
+    
+    BOOST_CHECK_EQUAL(kernel.solve(sys2, functor2), 1);
+    BOOST_CHECK_EQUAL(kernel.solver().m_normal.analyzeCount(), 1);
+    BOOST_CHECK_EQUAL(numeric::NormalEquations<K>::patternSignature(sys.sparseJacobi()),
+                      numeric::NormalEquations<K>::patternSignature(sys2.sparseJacobi()));
+    
+    //a different structure needs a new analysis
+    numeric::LinearSystem<K> sys3(2, 3, numeric::JacobiStorage::Sparse);
+    sys3.parameter() << 3, 2;
+    auto functor3 = [&]() {trilateration(sys3);};
+    
+    BOOST_CHECK_EQUAL(kernel.solve(sys3, functor3), 1);
+    BOOST_CHECK_EQUAL(kernel.solver().m_normal.analyzeCount(), 2);
+    
+    BOOST_CHECK_EQUAL(kernel.solve(sys, functor), 1);
+    BOOST_CHECK_EQUAL(kernel.solver().m_normal.analyzeCount(), 2);
+};
+
+BOOST_AUTO_TEST_CASE(parallel_components) {
+
+    //many independent components, each with its own system and solver, solved concurrently
+    const int count = 64;
+    shedule::ParallelVector vector;
+    std::vector<solver::ComponentSystem<K>*> components;
+    
+    for(int i=0; i<count; ++i) {
+        
+        auto component = new solver::ComponentSystem<K>();
+        component->setupSystem(2, 3);
+        numeric::LinearSystem<K>& sys = component->system();
+        sys.parameter() << 3+0.1*i, 2-0.05*i;
+        component->flow().newInitialActionNode([&sys](const tbb::flow::continue_msg&) {
+            trilateration(sys);
+            return tbb::flow::continue_msg();
+        });
+        
+        components.push_back(component);
+        vector.addExecutable(component);
+    }
+    
+    vector.execute();
+    
+    for(auto component : components) {
+        BOOST_CHECK_EQUAL(component->result(), 1);
+        BOOST_CHECK_SMALL((component->system().parameter() - Eigen::Vector2d(1,1)).norm(), 1e-8);
+        BOOST_CHECK_GT(component->solver().iter, 0);
+    }
+};
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -20,6 +20,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <opendcm/core/reduction.hpp>
+#include <opendcm/core/solver.hpp>
 
 using namespace dcm;
 
@@ -59,26 +60,352 @@ struct PointLineGlider : public numeric::DependendGeometry<K, TDirection3, TScal
     };
 };
 
+//the minimal system type needed for the reducer
+struct TestFinal {
+    
+    typedef K Kernel;
+    typedef mpl::vector<TDirection3<K>, TScalar<K>> GeometryList;
+    typedef mpl::vector0<>                          ConstraintList;
+    
+    template<typename G>
+    struct geometryIndex : mpl::find<GeometryList, G>::type::pos {};
+};
+
+typedef graph::ClusterGraph<mpl::vector1<symbolic::ResultProperty>, mpl::vector1<symbolic::ConstraintProperty>,
+        mpl::vector1<symbolic::GeometryProperty>, mpl::vector0<>> ReductionGraph;
+
 BOOST_AUTO_TEST_SUITE(Reduction);
 
 BOOST_AUTO_TEST_CASE(tree) {
 
+    typedef dcm::symbolic::reduction::ConstraintWalker<K, TDirection3, TDirection3> Walker;
+    
+    //a dependend geometry node, only reached if the edge has constraints
+    dcm::symbolic::reduction::DerivedGeometryNode<PointLineGlider, TDirection3> node;
+    
     //build up an example reduction tree
     dcm::symbolic::reduction::GeometryEdgeReductionTree<K, TDirection3, TDirection3> tree;
+    tree.getSourceNode().connect(node, [](dcm::symbolic::reduction::TreeWalker* walker)->bool {
+        return !static_cast<Walker*>(walker)->getConstraintPool().empty();
+    });
+    
+    TDirection3<K> p;
+    p.value() << 1, 2, 2;
+    dcm::symbolic::TypeGeometry<K, TDirection3> g1, g2;
+    g2.setPrimitiveGeometry(p);
+    
+    //without constraints the edge is rejected, only the target geometry is created 
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> w1(tree.apply(&g1, &g2, {}));
+    BOOST_CHECK(w1->getPath().empty());
+    
+    Walker* cw1 = static_cast<Walker*>(w1.get());
+    BOOST_CHECK(!cw1->getGeometry());
+    w1->create();
+    BOOST_REQUIRE(cw1->getGeometry());
+    BOOST_CHECK(cw1->getGeometry()->output().value().isApprox(p.value()));
+    BOOST_CHECK(cw1->getCummulativeInputEquation() == cw1->getGeometry());
+    
+    //with constraints the derived geometry is calculated from the target geometry
+    dcm::symbolic::Constraint c;
+    c.type = 0;
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> w2(tree.apply(&g1, &g2, {&c}));
+    BOOST_CHECK_EQUAL(w2->getPath().size(), 1u);
+    
+    Walker* cw2 = static_cast<Walker*>(w2.get());
+    w2->create();
+    auto derived = std::dynamic_pointer_cast<PointLineGlider>(cw2->getCummulativeInputEquation());
+    BOOST_REQUIRE(derived);
+    BOOST_REQUIRE(cw2->getGeometry());
+    BOOST_CHECK(derived->inputEquation() == cw2->getGeometry());
+    BOOST_CHECK(derived->input().value().isApprox(p.value()));
+    
+    //the actions are executed once only
+    w2->create();
+    BOOST_CHECK(cw2->getCummulativeInputEquation() == derived);
+}
+
+BOOST_AUTO_TEST_CASE(equation_cache) {
+
+    typedef numeric::Geometry<K, TDirection3>   Geometry;
+    typedef numeric::Equation<K, double>        Equation;
+    
+    dcm::symbolic::reduction::EquationCache cache;
+    int a, b;
     
-    //add a dependend geometry node 
-    dcm::symbolic::reduction::Node node = tree.getTreeNode<PointLineGlider>();
+    //equal type and inputs give the same equation
+    auto e1 = cache.get<Equation>({&a}, []() {return std::make_shared<Equation>(1.);});
+    auto e2 = cache.get<Equation>({&a}, []() {return std::make_shared<Equation>(2.);});
+    auto e3 = cache.get<Equation>({&b}, []() {return std::make_shared<Equation>(3.);});
+    auto e4 = cache.get<Equation>({&a, &b}, []() {return std::make_shared<Equation>(4.);});
+    auto g1 = cache.get<Geometry>({&a}, []() {return std::make_shared<Geometry>();});
     
-    //try to add a edge
-    tree.getSourceNode().connect(node, [](dcm::symbolic::reduction::TreeWalker* walker)->bool{
-        
-        auto cwalker = static_cast<dcm::symbolic::reduction::ConstraintWalker<K, TDirection3, TDirection3>*>(walker);
-        
-        
+    BOOST_CHECK(e1 == e2);
+    BOOST_CHECK(e1 != e3);
+    BOOST_CHECK(e1 != e4);
+    BOOST_CHECK(static_cast<void*>(g1.get()) != static_cast<void*>(e1.get()));
+    BOOST_CHECK_EQUAL(e2->output(), 1);
+    BOOST_CHECK_EQUAL(cache.createdCount(), 4);
+    BOOST_CHECK_EQUAL(cache.sharedCount(), 1);
+    
+    //the cache does not own the equations
+    e3.reset();
+    auto e5 = cache.get<Equation>({&b}, []() {return std::make_shared<Equation>(5.);});
+    BOOST_CHECK_EQUAL(e5->output(), 5);
+    
+    //concurrent requests of the same equation create it once
+    cache.clear();
+    std::vector<std::shared_ptr<Equation>> results(100);
+    tbb::parallel_for(0, 100, [&](int i) {
+        results[i] = cache.get<Equation>({&a}, []() {return std::make_shared<Equation>(1.);});
+    });
+    BOOST_CHECK_EQUAL(cache.createdCount(), 1);
+    for(auto& r : results)
+        BOOST_CHECK(r == results.front());
+    
+    //geometry nodes of different edges share the geometry of the same primitive
+    TDirection3<K> p1;
+    p1.value() << 1, 2, 3;
+    dcm::symbolic::TypeGeometry<K, TDirection3> s1, s2;
+    s1.setPrimitiveGeometry(p1);
+    dcm::symbolic::reduction::GeometryNode<K, TDirection3> node;
+    dcm::symbolic::reduction::GeometryWalker<K, TDirection3> w1(&s1), w2(&s1), w3(&s2), w4(&s1);
+    w1.setEquationCache(&cache);
+    w2.setEquationCache(&cache);
+    w3.setEquationCache(&cache);
+    node.apply(&w1);
+    node.apply(&w2);
+    node.apply(&w3);
+    node.apply(&w4);
+    
+    //traversal alone does not create any equation
+    BOOST_CHECK(!w1.getGeometry());
+    BOOST_CHECK_EQUAL(w1.getPath().size(), 0);
+    w1.create();
+    w2.create();
+    w3.create();
+    w4.create();
+    w4.create();
+    
+    BOOST_CHECK_EQUAL(cache.createdCount(), 3);
+    BOOST_CHECK(w1.getGeometry() == w2.getGeometry());
+    BOOST_CHECK(w1.getGeometry() != w3.getGeometry());
+    BOOST_CHECK(w1.getGeometry() != w4.getGeometry());
+    BOOST_CHECK(w1.getGeometry()->output().value() == p1.value());
+    
+    //the walkers outlive the symbolic geometries and hence do not reference them after creation
+    BOOST_CHECK(!w1.getSymbolicGeometry());
+    BOOST_CHECK(!w4.getSymbolicGeometry());
+}
+
+BOOST_AUTO_TEST_CASE(path_memoization) {
+
+    typedef dcm::symbolic::reduction::GeometryEdgeReductionTree<K, TDirection3, TDirection3> Tree;
+    typedef dcm::symbolic::reduction::ConstraintWalker<K, TDirection3, TDirection3>         Walker;
+    
+    symbolic::TypeGeometry<K, TDirection3> g1, g2;
+    symbolic::TypeConstraint<Distance> c1, c2, c3;
+    c1.setConstraintID(0);
+    c2.setConstraintID(0);
+    c3.setConstraintID(0);
+    c1.getPrimitveConstraint() = 1.;
+    c2.getPrimitveConstraint() = 1.;
+    c3.getPrimitveConstraint() = 0.;
+    
+    BOOST_CHECK(c1.optionHash() == c2.optionHash());
+    BOOST_CHECK(c1.optionHash() != c3.optionHash());
+    
+    //the first edge is only valid for zero distance, hence memoizable, the second one always
+    const std::size_t zero = c3.optionHash();
+    Tree tree;
+    dcm::symbolic::reduction::Node& n1 = tree.getTreeNode<int>();
+    dcm::symbolic::reduction::Node& n2 = tree.getTreeNode<double>();
+    std::atomic<int> checks1(0), checks2(0);
+    tree.getSourceNode().connect(n1, [&](dcm::symbolic::reduction::TreeWalker* walker)->bool {
+        ++checks1;
+        return static_cast<Walker*>(walker)->getConstraintPool().front()->optionHash() == zero;
+    }, true);
+    tree.getSourceNode().connect(n2, [&](dcm::symbolic::reduction::TreeWalker*)->bool {
+        ++checks2;
         return true;
-    }
-    );
+    });
+    
+    //the first reduction searches the path
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> w1(tree.apply(&g1, &g2, {&c1}));
+    BOOST_CHECK_EQUAL(checks1, 1);
+    BOOST_CHECK_EQUAL(checks2, 1);
+    BOOST_REQUIRE_EQUAL(w1->getPath().size(), 1);
+    BOOST_CHECK_EQUAL(w1->getPath().front(), 1);
+    BOOST_CHECK_EQUAL(tree.replayCount(), 0);
+    
+    //equal constraints replay the path without checking the first edge
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> w2(tree.apply(&g1, &g2, {&c2}));
+    BOOST_CHECK_EQUAL(checks1, 1);
+    BOOST_CHECK_EQUAL(checks2, 2);
+    BOOST_CHECK(w1->getPath() == w2->getPath());
+    BOOST_CHECK_EQUAL(tree.replayCount(), 1);
+    
+    //different options give a different signature and take their own path
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> w3(tree.apply(&g1, &g2, {&c3}));
+    BOOST_CHECK_EQUAL(checks1, 2);
+    BOOST_CHECK_EQUAL(checks2, 2);
+    BOOST_CHECK_EQUAL(w3->getPath().front(), 0);
+    BOOST_CHECK_EQUAL(tree.replayCount(), 1);
+    
+    //concurrent reductions of known signatures all replay
+    tbb::parallel_for(0, 50, [&](int i) {
+        std::unique_ptr<dcm::symbolic::reduction::TreeWalker> w(tree.apply(&g1, &g2, {i%2 ? &c1 : &c3}));
+    });
+    BOOST_CHECK_EQUAL(tree.replayCount(), 51);
+    BOOST_CHECK_EQUAL(checks1, 27);
+    
+    //conditions on the geometry values are checked also when replaying, hence the taken path does not
+    //depend on which edge recorded it first
+    Tree valueTree;
+    dcm::symbolic::reduction::Node& v1 = valueTree.getTreeNode<int>();
+    dcm::symbolic::reduction::Node& v2 = valueTree.getTreeNode<double>();
+    dcm::symbolic::reduction::Node& v3 = valueTree.getTreeNode<float>();
+    int never = 0;
+    valueTree.getSourceNode().connect(v1, [&](dcm::symbolic::reduction::TreeWalker*)->bool {
+        ++never;
+        return false;
+    }, true);
+    valueTree.getSourceNode().connect(v2, [](dcm::symbolic::reduction::TreeWalker* walker)->bool {
+        return static_cast<Walker*>(walker)->getSymbolicGeometry()->getPrimitveGeometry().value()(0) > 0;
+    });
+    valueTree.getSourceNode().connect(v3, [](dcm::symbolic::reduction::TreeWalker*)->bool {
+        return true;
+    });
+    
+    TDirection3<K> negative, positive;
+    negative.value() << -1, 0, 0;
+    positive.value() << 1, 0, 0;
+    symbolic::TypeGeometry<K, TDirection3> gn, gp;
+    gn.setPrimitiveGeometry(negative);
+    gp.setPrimitiveGeometry(positive);
+    
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> wn(valueTree.apply(&g1, &gn, {&c1}));
+    BOOST_CHECK_EQUAL(wn->getPath().front(), 2);
+    BOOST_CHECK_EQUAL(never, 1);
+    
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> wp(valueTree.apply(&g1, &gp, {&c1}));
+    BOOST_CHECK_EQUAL(wp->getPath().front(), 1);
+    BOOST_CHECK_EQUAL(valueTree.replayCount(), 1);
+    BOOST_CHECK_EQUAL(never, 1);
+    
+    //a failing recorded edge continues with the following edges only
+    Tree failTree;
+    failTree.getSourceNode().connect(failTree.getTreeNode<int>(), [&](dcm::symbolic::reduction::TreeWalker*)->bool {
+        ++never;
+        return false;
+    }, true);
+    failTree.getSourceNode().connect(failTree.getTreeNode<double>(), [](dcm::symbolic::reduction::TreeWalker* walker)->bool {
+        return static_cast<Walker*>(walker)->getSymbolicGeometry()->getPrimitveGeometry().value()(0) > 0;
+    });
+    failTree.getSourceNode().connect(failTree.getTreeNode<float>(), [](dcm::symbolic::reduction::TreeWalker*)->bool {
+        return true;
+    });
+    
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> fp(failTree.apply(&g1, &gp, {&c1}));
+    BOOST_CHECK_EQUAL(fp->getPath().front(), 1);
+    BOOST_CHECK_EQUAL(never, 2);
+    
+    std::unique_ptr<dcm::symbolic::reduction::TreeWalker> fn(failTree.apply(&g1, &gn, {&c1}));
+    BOOST_CHECK_EQUAL(fn->getPath().front(), 2);
+    BOOST_CHECK_EQUAL(failTree.replayCount(), 1);
+    BOOST_CHECK_EQUAL(never, 2);
+}
+
+BOOST_AUTO_TEST_CASE(shared_table) {
+
+    typedef dcm::symbolic::ReductionTable<TestFinal> Table;
+    
+    //the table is build once, also for concurrent first use
+    std::vector<const Table*> tables(50);
+    tbb::parallel_for(0, 50, [&](int i) {tables[i] = &Table::instance();});
+    for(const Table* t : tables)
+        BOOST_CHECK(t == &Table::instance());
+    
+    //all reducers share the trees but have their own equations
+    dcm::symbolic::Reducer<TestFinal> r1, r2;
+    BOOST_CHECK(&r1.reductionTable() == &r2.reductionTable());
+    BOOST_CHECK(&r1.equationCache() != &r2.equationCache());
+    
+    const Table& table = Table::instance();
+    BOOST_CHECK((dynamic_cast<dcm::symbolic::reduction::GeometryEdgeReductionTree<K, TDirection3, TDirection3>*>(table.tree(0,0))));
+    BOOST_CHECK((dynamic_cast<dcm::symbolic::reduction::GeometryEdgeReductionTree<K, TDirection3, TScalar>*>(table.tree(0,1))));
+    BOOST_CHECK((dynamic_cast<dcm::symbolic::reduction::GeometryEdgeReductionTree<K, TScalar, TDirection3>*>(table.tree(1,0))));
+    BOOST_CHECK((dynamic_cast<dcm::symbolic::reduction::GeometryEdgeReductionTree<K, TScalar, TScalar>*>(table.tree(1,1))));
 }
 
+BOOST_AUTO_TEST_CASE(reducer) {
+
+    typedef dcm::symbolic::ResultProperty Result;
+    
+    auto g = std::make_shared<ReductionGraph>();
+    dcm::symbolic::TypeGeometry<K, TDirection3> g1, g2;
+    g1.type = g2.type = 0;
+    graph::LocalVertex v1 = fusion::at_c<0>(g->addVertex());
+    graph::LocalVertex v2 = fusion::at_c<0>(g->addVertex());
+    g->setProperty<dcm::symbolic::GeometryProperty>(v1, &g1);
+    g->setProperty<dcm::symbolic::GeometryProperty>(v2, &g2);
+    
+    dcm::symbolic::Constraint c;
+    c.type = 0;
+    auto edge = g->addEdge(v1, v2);
+    g->setProperty<dcm::symbolic::ConstraintProperty>(fusion::at_c<1>(edge), &c);
+    
+    //the accepted walker is stored and has created its equations
+    dcm::symbolic::Reducer<TestFinal> reducer;
+    BOOST_CHECK(!g->getProperty<Result>(fusion::at_c<0>(edge)));
+    reducer.reduce(g, fusion::at_c<0>(edge));
+    
+    auto result = g->getProperty<Result>(fusion::at_c<0>(edge));
+    BOOST_REQUIRE(result);
+    BOOST_CHECK((static_cast<dcm::symbolic::reduction::GeometryWalker<K, TDirection3>*>(result.get())->getGeometry()));
+    BOOST_CHECK_EQUAL(reducer.equationCache().createdCount(), 1);
+    
+    //reducing again replaces the result but shares the equations of the still existing one
+    reducer.reduce(g, fusion::at_c<0>(edge));
+    BOOST_CHECK(g->getProperty<Result>(fusion::at_c<0>(edge)) != result);
+    BOOST_CHECK_EQUAL(reducer.equationCache().createdCount(), 1);
+    BOOST_CHECK_EQUAL(reducer.equationCache().sharedCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(rigid_counting) {
+
+    auto g = std::make_shared<ReductionGraph>();
+    dcm::symbolic::TypeGeometry<K, TDirection3> geometry;
+    geometry.type = 0;
+    dcm::symbolic::Constraint c;
+    c.type = 0;
+    
+    std::vector<graph::LocalVertex> v;
+    for(int i=0; i<4; ++i) {
+        v.push_back(fusion::at_c<0>(g->addVertex()));
+        g->setProperty<dcm::symbolic::GeometryProperty>(v.back(), &geometry);
+    }
+    auto connect = [&](int s, int t) {
+        g->setProperty<dcm::symbolic::ConstraintProperty>(fusion::at_c<1>(g->addEdge(v[s], v[t])), &c);
+    };
+    
+    //a rigid triangle of points and a point loosely connected to it
+    connect(0, 1);
+    connect(1, 2);
+    connect(0, 2);
+    connect(2, 3);
+    
+    //without counting no rigid subsystems are searched
+    dcm::symbolic::Reducer<TestFinal> reducer;
+    BOOST_CHECK_EQUAL(reducer.bodyDof(), 0);
+    BOOST_CHECK_EQUAL(dcm::symbolic::clusterRigidSubsystems(g, reducer, 0), 0);
+    
+    reducer.setDofCounting(6, [](const dcm::symbolic::Geometry&) {return 3;},
+                              [](const dcm::symbolic::Constraint&) {return 1;});
+    BOOST_CHECK_EQUAL(reducer.geometryDof(g, v[0]), 3);
+    BOOST_CHECK_EQUAL(reducer.constraintDof(g, g->edge(v[0], v[1]).first), 1);
+    BOOST_CHECK_EQUAL(dcm::symbolic::clusterRigidSubsystems(g, reducer, 0), 1);
+    BOOST_CHECK_EQUAL(g->numClusters(), 1);
+    BOOST_CHECK_EQUAL(g->vertexCount(), 2);
+}
 
 BOOST_AUTO_TEST_SUITE_END();
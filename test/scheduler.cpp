@@ -17,250 +17,175 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
-#define DCM_USE_MULTITHREADING
-
 #include "opendcm/core/scheduler.hpp"
 #include <boost/test/unit_test.hpp>
-#include <boost/atomic.hpp>
 #include <boost/chrono.hpp>
 
-#include <tbb/parallel_for.h>
-#include "tbb/blocked_range.h"
-#include <tbb/flow_graph.h>
+#include <atomic>
+#include <list>
+#include <cmath>
+#include <stdexcept>
 
 #define NUM_SQRT 1000
-#define DCM_DEBUG_THROW_AT_ASSERT
 
-using namespace dcm::details::shedule;
+using namespace dcm::shedule;
 
 BOOST_AUTO_TEST_SUITE(Scheduler_test_suit);
 
-volatile boost::atomic<int> count;
-volatile boost::atomic<int> dummy;
-tbb::atomic<int> tbbcount;
+std::atomic<int> count;
 
 struct Test {
        
     void execute() const {  
-        volatile int c;
+        volatile double c;
         for ( long i = 0; i < NUM_SQRT; ++i )
            c = std::sqrt(125.34L);// burn some time
+        (void)c;
             
-        count.fetch_add(1, boost::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
     };
-};
-
-struct TBBTest {
-
-    void operator() ( int& i ) const {
-      
-        volatile int c;
-        for ( long i = 0; i < NUM_SQRT; ++i )
-           c = std::sqrt(125.34L);// burn some time
-            
-        tbbcount+= 1;
+    
+    void operator()() const {
+        execute();
     };
     
-    void operator() ( tbb::blocked_range<int>& r ) const {
-      
-        for ( int i = r.begin(); i != r.end(); ++i )
-            operator()(i);
+    void operator()(int) const {
+        execute();
     };
     
-    void operator()(const tbb::flow::continue_msg & msg) {
-        
-        volatile int c;
-        for ( long i = 0; i < NUM_SQRT; ++i )
-           c = std::sqrt(125.34L);// burn some time
-            
-        tbbcount+= 1;
+    tbb::flow::continue_msg operator()(const tbb::flow::continue_msg&) const {
+        execute();
+        return tbb::flow::continue_msg();
     };
 };
 
-typedef const tbb::flow::continue_msg & msg_t;
-typedef tbb::flow::continue_node< tbb::flow::continue_msg > node_t;
+typedef boost::chrono::duration<double> seconds;
 
-struct TBBGraphBody {
-
-    int nested;
+template<typename Callable>
+seconds measure(Callable c) {
     
-    TBBGraphBody(int i) : nested(i) { }
+    count = 0;
+    boost::chrono::system_clock::time_point start = boost::chrono::system_clock::now();
+    c();
+    return boost::chrono::system_clock::now() - start;
+};
+
+BOOST_AUTO_TEST_CASE(parallel_for_each) {
     
-    void operator()(const tbb::flow::continue_msg & msg) {
-        
-        tbb::flow::graph g;
-        tbb::flow::broadcast_node<tbb::flow::continue_msg> start(g);
+    //every element must be processed exactly once, no matter how the range is split
+    for(int size : {0, 1, 15, 16, 1000}) {
         
-        node_t A(g, TBBTest() );
-        node_t B(g, TBBTest() );
-        node_t C(g, TBBTest() );
-        node_t D(g, TBBTest() );
-        node_t E(g, TBBTest() );
-        node_t F(g, TBBTest() );
-        node_t G(g, TBBTest() );
-        node_t H(g, TBBTest() );
-        node_t I(g, TBBTest() );
-        node_t J(g, TBBTest() );
-        
-        tbb::flow::make_edge(start, A);
-        tbb::flow::make_edge(start, B);
-        tbb::flow::make_edge(A, C);
-        tbb::flow::make_edge(A, D);
-        tbb::flow::make_edge(C, E);
-        tbb::flow::make_edge(C, F);
-        tbb::flow::make_edge(E, G);
-        tbb::flow::make_edge(E, H);
-        tbb::flow::make_edge(C, I);
-        tbb::flow::make_edge(C, J);
-        
-        if(nested>0) {
-            node_t G1(g, TBBGraphBody(nested-1));
-            node_t G2(g, TBBGraphBody(nested-1));  
+        std::vector<int> vec(size);
+        std::list<int>   list(size);
+        for(Partition p : {Partition(), Partition(1), Partition(7), Partition(3, 0)}) {
             
-            tbb::flow::make_edge(C, G1);
-            tbb::flow::make_edge(C, G2);
+            count = 0;
+            dcm::shedule::for_each(vec.begin(), vec.end(), Test(), p);
+            BOOST_CHECK_EQUAL(count, size);
             
-            start.try_put(tbb::flow::continue_msg());
-            g.wait_for_all();
+            count = 0;
+            dcm::shedule::for_each(list.begin(), list.end(), Test(), p);
+            BOOST_CHECK_EQUAL(count, size);
         }
-        else {
-            start.try_put(tbb::flow::continue_msg());
-            g.wait_for_all();
-        }
-
-        
-    };
-};
-  
-Test t;
-
-struct TestGroup : public Group {
+    }
+}
 
-    int  nested;
+BOOST_AUTO_TEST_CASE(vectors) {
     
-    TestGroup(int i) : Group(), nested(i) {
-        
-        //create some nodes
-        std::vector<Node*> nodes(15);
-        
-        nodes[0] = createNode(boost::bind(&Test::execute, &t));
-        nodes[1] = createNode(boost::bind(&Test::execute, &t));
-        nodes[2] = createDependendNode(nodes[0], boost::bind(&Test::execute, &t));
-        nodes[3] = createDependendNode(nodes[0], boost::bind(&Test::execute, &t));
-        nodes[4] = createDependendNode(nodes[2], boost::bind(&Test::execute, &t));
-        nodes[5] = createDependendNode(nodes[2], boost::bind(&Test::execute, &t));
-        nodes[6] = createDependendNode(nodes[4], boost::bind(&Test::execute, &t));
-        nodes[7] = createDependendNode(nodes[4], boost::bind(&Test::execute, &t));
-        nodes[8] = createDependendNode(nodes[2], boost::bind(&Test::execute, &t));
-        nodes[9] = createDependendNode(nodes[2], boost::bind(&Test::execute, &t));
-        
-        if(nested>0) {
-            TestGroup* group1 = new TestGroup(nested-1);
-            TestGroup* group2 = new TestGroup(nested-1);
-            setupDependendGroupNode(group1, nodes[2]);
-            setupDependendGroupNode(group2, nodes[2]);
-        };
-    };
-};
-
-
-BOOST_AUTO_TEST_CASE(creation) {
+    const int size = 10000;
+    Vector sequential;
+    ParallelVector parallel;
+    HugeParallelVector huge;
+    for(int i=0; i<size; ++i) {
+        sequential.add(Test());
+        parallel.add(Test());
+        huge.add(Test());
+    }
     
+    seconds seq = measure([&]() {sequential.execute();});
+    BOOST_CHECK_EQUAL(count, size);
+    std::cout<<count<<" counts in " << seq.count() << "s sequential" << std::endl;
     
-};
+    seconds par = measure([&]() {parallel.execute();});
+    BOOST_CHECK_EQUAL(count, size);
+    std::cout<<count<<" counts in " << par.count() << "s by ParallelVector" << std::endl;
+    
+    seconds hpar = measure([&]() {huge.execute();});
+    BOOST_CHECK_EQUAL(count, size);
+    std::cout<<count<<" counts in " << hpar.count() << "s by HugeParallelVector" << std::endl;
+    
+    //timing depends on the machine load, hence a missing speedup is only reported
+    BOOST_WARN_LE(par.count(), seq.count());
+    BOOST_WARN_LE(hpar.count(), seq.count());
+    
+    //small vectors are executed in the calling thread
+    HugeParallelVector small;
+    small.add(Test());
+    measure([&]() {small.execute();});
+    BOOST_CHECK_EQUAL(count, 1);
+}
 
-BOOST_AUTO_TEST_CASE(sheduler) {
+BOOST_AUTO_TEST_CASE(flow_graph) {
 
-    typedef boost::chrono::microseconds us;
-    typedef boost::chrono::milliseconds ms;
-    typedef boost::chrono::seconds s;
+    FlowGraph graph;
     
-    try {
-        int loop;
-        count = 0;
-        
-        TestGroup* group = new TestGroup(10);
-        TBBGraphBody body(10);
+    //a tree of dependencies with two initial nodes
+    std::vector<FlowGraph::Node*> nodes;
+    nodes.push_back(&graph.newInitialActionNode(Test()));
+    nodes.push_back(&graph.newInitialActionNode(Test()));
+    const int parents[] = {0, 0, 2, 2, 4, 4, 2, 2};
+    for(int parent : parents) {
+        nodes.push_back(&graph.newActionNode(Test()));
+        graph.connect(*nodes[parent], *nodes.back());
+    }
+    
+    seconds sec = measure([&]() {graph.execute();});
+    BOOST_CHECK_EQUAL(count, 10);
+    std::cout<<count<<" counts in " << sec.count() << "s by FlowGraph" << std::endl;
+    
+    //the graph can be executed multiple times
+    measure([&]() {graph.execute();});
+    BOOST_CHECK_EQUAL(count, 10);
+}
 
-        Scheduler sh(2);
-        
-        boost::chrono::system_clock::time_point start = boost::chrono::system_clock::now();
-        sh.execute(group);
-        sh.join();
-        boost::chrono::duration<double> sec = boost::chrono::system_clock::now() - start;   
-           
-        std::cout<<count.load(boost::memory_order_relaxed)<<" counts in " << sec.count() << "s"
-        << " with 2 threads" << std::endl;
-        loop = count;
-         
-        Scheduler sh2(3);
-        count = 0;
-        
-        start = boost::chrono::system_clock::now();
-        sh2.execute(group);
-        sh2.join();
-        sec = boost::chrono::system_clock::now() - start;   
-           
-        std::cout<<count.load(boost::memory_order_relaxed)<<" counts in " << sec.count() << "s"
-        << " with 3 threads" << std::endl;
-        
-        Scheduler sh3(4);
-        count = 0;
-        
-        start = boost::chrono::system_clock::now();
-        sh3.execute(group);
-        sh3.join();
-        sec = boost::chrono::system_clock::now() - start;   
-           
-        std::cout<<count.load(boost::memory_order_relaxed)<<" counts in " << sec.count() << "s"
-        << " with 4 threads" << std::endl;
-        
-        count = 0;
-        Test* der = new Test;
-        start = boost::chrono::system_clock::now();
-        for(int i=0; i<loop; i++)
-            der->execute();
-        
-        sec = boost::chrono::system_clock::now() - start;   
-           
-        std::cout<<count.load(boost::memory_order_relaxed)<<" counts in " << sec.count() << "s"
-        << " by derived" << std::endl;
-        
-        int c = count.load(boost::memory_order_relaxed);
-        tbbcount = 0;
-        start = boost::chrono::system_clock::now();
-                
-        tbb::parallel_for(0,c,1, TBBTest());
-        
-        sec = boost::chrono::system_clock::now() - start;              
-        std::cout<<tbbcount<<" counts in " << sec.count() << "s"
-        << " by derived with tbb" << std::endl;
-        
-        tbbcount = 0;
-        start = boost::chrono::system_clock::now();
-                
-        tbb::parallel_for(tbb::blocked_range<int>(0,c), TBBTest());
-        
-        sec = boost::chrono::system_clock::now() - start;              
-        std::cout<<tbbcount<<" counts in " << sec.count() << "s"
-        << " by derived with tbb blocked range" << std::endl;
+BOOST_AUTO_TEST_CASE(flow_graph_storage) {
+
+    //node references must stay valid while the graph grows, with and without preallocation
+    for(std::size_t reserved : {0, 10, 1000}) {
         
-        tbbcount = 0;
-        start = boost::chrono::system_clock::now();
-                
-        body(tbb::flow::continue_msg());
+        FlowGraph graph(reserved);
+        FlowGraph::Node* last = &graph.newInitialActionNode(Test());
+        for(int i=1; i<1000; ++i) {
+            FlowGraph::Node* node = &graph.newActionNode(Test());
+            graph.connect(*last, *node);
+            last = node;
+        }
+        BOOST_CHECK_EQUAL(graph.size(), 1000);
         
-        sec = boost::chrono::system_clock::now() - start;              
-        std::cout<<tbbcount<<" counts in " << sec.count() << "s"
-        << " by tbb dependency" << std::endl;
-             
-        BOOST_CHECK(count.load(boost::memory_order_relaxed) == 11);
-
+        for(int run=0; run<3; ++run) {
+            measure([&]() {graph.execute();});
+            BOOST_CHECK_EQUAL(count, 1000);
+        }
     }
-    catch(...) {
-        BOOST_FAIL("Exception not expected");
-    };
+    
+    //an interrupted run does not break the following ones
+    FlowGraph graph;
+    bool fail = true;
+    FlowGraph::Node& first = graph.newInitialActionNode([&](const tbb::flow::continue_msg&) {
+        if(fail) {
+            fail = false;
+            throw std::runtime_error("failed run");
+        }
+        return tbb::flow::continue_msg();
+    });
+    graph.connect(first, graph.newActionNode(Test()));
+    
+    count = 0;
+    BOOST_CHECK_THROW(graph.execute(), std::runtime_error);
+    BOOST_CHECK_EQUAL(count, 0);
+    
+    measure([&]() {graph.execute();});
+    BOOST_CHECK_EQUAL(count, 1);
 }
 
-
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,850 @@
+/*
+    openDCM, dimensional constraint manager
+    Copyright (C) 2012  Stefan Troeger <stefantroeger@gmx.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along
+    with this library; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "opendcm/core/solver.hpp"
+#include "opendcm/module3d/constraint.hpp"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+
+using namespace dcm;
+namespace mpl = boost::mpl;
+
+struct test_result {
+    typedef int type;
+    struct default_value {
+        int operator()() {
+            return -1;
+        };
+    };
+};
+
+struct test_tracked {
+    typedef int type;
+    struct change_tracking {};
+};
+
+typedef graph::ClusterGraph<mpl::vector2<test_result, test_tracked>, mpl::vector0<>,
+        mpl::vector0<>, mpl::vector0<> > Graph;
+
+//vertices with tracked changes
+typedef graph::ClusterGraph<mpl::vector2<test_result, test_tracked>, mpl::vector0<>,
+        mpl::vector1<test_tracked>, mpl::vector0<> > TrackedGraph;
+
+//writes only the result of the given edge and counts how often it was called
+struct TestReducer {
+    
+    std::atomic<int> count;
+    
+    TestReducer() : count(0) {};
+    
+    template<typename G>
+    void reduce(std::shared_ptr<G> g, graph::LocalEdge e) {
+        g->template setProperty<test_result>(e, g->template getProperty<test_tracked>(e));
+        ++count;
+    };
+};
+
+//counts points in space, the constraints of an edge remove test_tracked degrees of freedom
+struct RigidReducer : public TestReducer {
+    
+    int bodyDof() {return 6;};
+    
+    template<typename G>
+    int geometryDof(std::shared_ptr<G>, graph::LocalVertex) {return 3;};
+    
+    template<typename G>
+    int constraintDof(std::shared_ptr<G> g, graph::LocalEdge e) {
+        return g->template getProperty<test_tracked>(e);
+    };
+};
+
+BOOST_AUTO_TEST_SUITE(Solver_test_suit);
+
+BOOST_AUTO_TEST_CASE(reduce_graph) {
+    
+    std::shared_ptr<Graph> g = std::make_shared<Graph>();
+    
+    //build two components, a long chain and a single edge
+    std::vector<graph::LocalVertex> vertices;
+    for(int i=0; i<102; ++i) 
+        vertices.push_back(fusion::at_c<0>(g->addVertex()));
+    
+    std::vector<graph::LocalEdge> edges;
+    for(int i=0; i<99; ++i)
+        edges.push_back(fusion::at_c<0>(g->addEdge(vertices[i], vertices[i+1])));
+    edges.push_back(fusion::at_c<0>(g->addEdge(vertices[100], vertices[101])));
+    
+    for(std::size_t i=0; i<edges.size(); ++i)
+        g->setProperty<test_tracked>(edges[i], i);
+    
+    TestReducer reducer;
+    BOOST_CHECK_EQUAL(symbolic::reduceGraph(g, reducer), 2);
+    BOOST_CHECK_EQUAL(reducer.count, 100);
+    
+    for(std::size_t i=0; i<edges.size(); ++i) {
+        BOOST_CHECK_EQUAL(g->getProperty<test_result>(edges[i]), int(i));
+        BOOST_CHECK(!g->edgeChanged(edges[i]));
+        BOOST_CHECK_EQUAL(g->getProperty<graph::Group>(edges[i]), 
+                          g->getProperty<graph::Group>(g->source(edges[i])));
+    }
+    BOOST_CHECK(g->getProperty<graph::Group>(edges.front()) != g->getProperty<graph::Group>(edges.back()));
+    
+    //unchanged edges are not reduced again
+    reducer.count = 0;
+    g->setProperty<test_tracked>(edges[5], 500);
+    BOOST_CHECK_EQUAL(symbolic::reduceGraph(g, reducer), 2);
+    BOOST_CHECK_EQUAL(reducer.count, 1);
+    BOOST_CHECK_EQUAL(g->getProperty<test_result>(edges[5]), 500);
+}
+
+BOOST_AUTO_TEST_CASE(rigid_subsystems) {
+    
+    std::shared_ptr<Graph> g = std::make_shared<Graph>();
+    std::vector<graph::LocalVertex> v;
+    for(int i=0; i<7; ++i) 
+        v.push_back(fusion::at_c<0>(g->addVertex()));
+    
+    auto connect = [&](int s, int t, int dof) {
+        g->setProperty<test_tracked>(fusion::at_c<0>(g->addEdge(v[s], v[t])), dof);
+    };
+    
+    //a underconstrained chain first, it must not be taken as rigid
+    connect(5, 6, 1);
+    connect(4, 5, 1);
+    connect(3, 4, 1);
+    //a triangle and a point fixed by three distances to it
+    connect(0, 1, 1);
+    connect(1, 2, 1);
+    connect(0, 2, 1);
+    connect(0, 3, 1);
+    connect(1, 3, 1);
+    connect(2, 3, 1);
+    
+    RigidReducer reducer;
+    symbolic::RigidDecomposition decomposition = symbolic::findRigidSubsystems(g, reducer);
+    BOOST_REQUIRE_EQUAL(decomposition.subsystems.size(), 1);
+    std::vector<graph::LocalVertex> rigid = decomposition.subsystems.front();
+    std::sort(rigid.begin(), rigid.end());
+    std::vector<graph::LocalVertex> expected(v.begin(), v.begin()+4);
+    std::sort(expected.begin(), expected.end());
+    BOOST_CHECK(rigid == expected);
+    
+    //the reduction moves the subsystem into a subcluster, which is not decomposed again
+    BOOST_CHECK_EQUAL(symbolic::reduceGraph(g, reducer), 1);
+    BOOST_CHECK_EQUAL(g->vertexCount(), 4);
+    BOOST_CHECK_EQUAL(g->edgeCount(), 3);
+    BOOST_REQUIRE_EQUAL(g->numClusters(), 1);
+    
+    std::shared_ptr<Graph> sub = g->clusters().first->second;
+    BOOST_CHECK_EQUAL(sub->vertexCount(), 4);
+    BOOST_CHECK_EQUAL(sub->edgeCount(), 6);
+    BOOST_CHECK_EQUAL(symbolic::findRigidSubsystems(sub, reducer).subsystems.size(), 0);
+    
+    //a cluster is already collapsed and never clustered again, even if a point is fully fixed to it. 
+    //Otherwise every reduction would nest the cluster one level deeper
+    auto edges = g->outEdges(v[4]);
+    for(; edges.first != edges.second; ++edges.first) 
+        g->setProperty<test_tracked>(*edges.first, g->isCluster(g->target(*edges.first)) ? 3 : 1);
+    
+    BOOST_CHECK_EQUAL(symbolic::findRigidSubsystems(g, reducer).subsystems.size(), 0);
+    symbolic::reduceGraph(g, reducer);
+    BOOST_CHECK_EQUAL(g->numClusters(), 1);
+    BOOST_CHECK_EQUAL(sub->numClusters(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(leaf_decomposition) {
+    
+    std::shared_ptr<Graph> g = std::make_shared<Graph>();
+    
+    std::vector<graph::LocalVertex> v;
+    for(int i=0; i<8; ++i) 
+        v.push_back(fusion::at_c<0>(g->addVertex()));
+    
+    //a triangle as cyclic core, a chain 2-3-4-5 with a branch 3-6 and a single leaf 0-7
+    g->addEdge(v[0], v[1]);
+    g->addEdge(v[1], v[2]);
+    g->addEdge(v[2], v[0]);
+    g->addEdge(v[2], v[3]);
+    g->addEdge(v[3], v[4]);
+    g->addEdge(v[4], v[5]);
+    g->addEdge(v[3], v[6]);
+    g->addEdge(v[0], v[7]);
+    
+    auto decomposition = solver::decomposeLeafs(g);
+    BOOST_CHECK_EQUAL(decomposition.core.size(), 3);
+    BOOST_REQUIRE_EQUAL(decomposition.leafs.size(), 5);
+    
+    std::map<graph::LocalVertex, int> index;
+    for(std::size_t i=0; i<decomposition.leafs.size(); ++i)
+        index[decomposition.leafs[i].vertex] = i;
+    
+    for(auto vertex : {v[0], v[1], v[2]})
+        BOOST_CHECK(index.find(vertex) == index.end());
+    
+    //parents always come before their children
+    for(std::size_t i=0; i<decomposition.leafs.size(); ++i) {
+        const auto& leaf = decomposition.leafs[i];
+        BOOST_CHECK(leaf.parentLeaf < int(i));
+        if(leaf.parentLeaf >= 0)
+            BOOST_CHECK(decomposition.leafs[leaf.parentLeaf].vertex == leaf.parent);
+        BOOST_CHECK(!leaf.independent);
+    }
+    BOOST_CHECK(decomposition.leafs[index[v[3]]].parent == v[2]);
+    BOOST_CHECK_EQUAL(decomposition.leafs[index[v[3]]].parentLeaf, -1);
+    BOOST_CHECK_EQUAL(decomposition.leafs[index[v[5]]].parentLeaf, index[v[4]]);
+    BOOST_CHECK_EQUAL(decomposition.leafs[index[v[6]]].parentLeaf, index[v[3]]);
+    BOOST_CHECK(decomposition.leafs[index[v[7]]].parent == v[0]);
+    
+    //a tree is fully peeled down to a single vertex
+    std::shared_ptr<Graph> tree = std::make_shared<Graph>();
+    auto t1 = fusion::at_c<0>(tree->addVertex());
+    auto t2 = fusion::at_c<0>(tree->addVertex());
+    auto t3 = fusion::at_c<0>(tree->addVertex());
+    tree->addEdge(t1, t2);
+    tree->addEdge(t2, t3);
+    auto treeDecomposition = solver::decomposeLeafs(tree);
+    BOOST_CHECK_EQUAL(treeDecomposition.core.size(), 1);
+    BOOST_CHECK_EQUAL(treeDecomposition.leafs.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(block_decomposition) {
+    
+    std::shared_ptr<Graph> g = std::make_shared<Graph>();
+    
+    std::vector<graph::LocalVertex> v;
+    for(int i=0; i<10; ++i) 
+        v.push_back(fusion::at_c<0>(g->addVertex()));
+    
+    //a square 0-1-2-3 as biggest block, a triangle 3-4-5 sharing vertex 3, a bridge 5-6 and a second 
+    //triangle 6-7-8 behind it. Vertex 9 is isolated
+    g->addEdge(v[0], v[1]);
+    g->addEdge(v[1], v[2]);
+    g->addEdge(v[2], v[3]);
+    g->addEdge(v[3], v[0]);
+    g->addEdge(v[3], v[4]);
+    g->addEdge(v[4], v[5]);
+    g->addEdge(v[5], v[3]);
+    g->addEdge(v[5], v[6]);
+    g->addEdge(v[6], v[7]);
+    g->addEdge(v[7], v[8]);
+    g->addEdge(v[8], v[6]);
+    
+    auto decomposition = solver::decomposeBlocks(g);
+    auto& blocks = decomposition.blocks;
+    BOOST_REQUIRE_EQUAL(blocks.size(), 4);
+    
+    BOOST_CHECK_EQUAL(blocks[0].edges.size(), 4);
+    BOOST_CHECK_EQUAL(blocks[0].vertices.size(), 4);
+    BOOST_CHECK_EQUAL(blocks[0].parentBlock, -1);
+    
+    BOOST_CHECK_EQUAL(blocks[1].edges.size(), 3);
+    BOOST_CHECK_EQUAL(blocks[1].parentBlock, 0);
+    BOOST_CHECK(blocks[1].articulation == v[3]);
+    
+    BOOST_CHECK_EQUAL(blocks[2].edges.size(), 1);
+    BOOST_CHECK_EQUAL(blocks[2].parentBlock, 1);
+    BOOST_CHECK(blocks[2].articulation == v[5]);
+    
+    BOOST_CHECK_EQUAL(blocks[3].edges.size(), 3);
+    BOOST_CHECK_EQUAL(blocks[3].parentBlock, 2);
+    BOOST_CHECK(blocks[3].articulation == v[6]);
+    
+    for(auto& block : blocks)
+        BOOST_CHECK(!block.independent);
+    
+    //a component of a filtered graph is decomposed on its own
+    g->setProperty<graph::Group>(v[9], 1);
+    auto filter = graph::make_filter_graph(g, 0);
+    BOOST_CHECK_EQUAL(solver::decomposeBlocks(filter).blocks.size(), 4);
+}
+
+typedef dcm::Eigen3Kernel<double> K;
+
+//a single parameter system which needs to be one bigger than the given value
+std::unique_ptr<solver::ComponentSystem<K>> offsetSystem(const double* base) {
+    
+    std::unique_ptr<solver::ComponentSystem<K>> component(new solver::ComponentSystem<K>());
+    component->setupSystem(1, 1);
+    numeric::LinearSystem<K>& sys = component->system();
+    component->flow().newInitialActionNode([&sys, base](const tbb::flow::continue_msg&) {
+        sys.residuals()(0) = sys.parameter()(0) - (base ? *base + 1 : 1);
+        sys.jacobiAt(0, 0) = 1;
+        return tbb::flow::continue_msg();
+    });
+    return component;
+};
+
+BOOST_AUTO_TEST_CASE(leaf_solving) {
+    
+    //core value 1, every leaf one bigger than its parent. Leaf 1 and 2 form a chain, 3 and 4 branch
+    //of from leaf 2, 5 is independent
+    solver::ComponentSystem<K> component;
+    component.setupSystem(1, 1);
+    numeric::LinearSystem<K>& sys = component.system();
+    component.flow().newInitialActionNode([&sys](const tbb::flow::continue_msg&) {
+        sys.residuals()(0) = sys.parameter()(0) - 1;
+        sys.jacobiAt(0, 0) = 1;
+        return tbb::flow::continue_msg();
+    });
+    
+    const int parents[] = {-1, 0, 1, 2, 2, -1};
+    std::vector<const double*> values = {&sys.parameter()(0)};
+    for(int i=0; i<6; ++i) {
+        const double* base = (parents[i] < 0) ? (i==5 ? nullptr : values[0]) : values[parents[i]+1];
+        auto leaf = offsetSystem(base);
+        values.push_back(&leaf->system().parameter()(0));
+        BOOST_CHECK_EQUAL(component.addLeaf(std::move(leaf), parents[i], i==5), i);
+    }
+    
+    component.execute();
+    
+    BOOST_CHECK_EQUAL(component.result(), 1);
+    const double expected[] = {1, 2, 3, 4, 5, 5, 1};
+    for(int i=0; i<7; ++i)
+        BOOST_CHECK_CLOSE(*values[i], expected[i], 1e-8);
+    for(int i=0; i<component.leafCount(); ++i)
+        BOOST_CHECK_EQUAL(component.leaf(i).result(), 1);
+}
+
+//records the execution position and checks that all inputs were executed before
+struct OrderedCalculatable : public numeric::Calculatable<K> {
+    
+    std::vector<numeric::Calculatable<K>*> in;
+    std::atomic<int>* counter;
+    int position = -1, executions = 0;
+    bool inputsDone = true;
+    
+    OrderedCalculatable(std::atomic<int>* c) : counter(c) {};
+    
+    virtual void collectInputs(std::vector<numeric::Calculatable<K>*>& inputs) {
+        inputs.insert(inputs.end(), in.begin(), in.end());
+    };
+    
+    virtual void execute() {
+        for(auto input : in) 
+            inputsDone &= static_cast<OrderedCalculatable*>(input)->position < *counter;
+        
+        position = (*counter)++;
+        ++executions;
+    };
+};
+
+BOOST_AUTO_TEST_CASE(recalculation_flow) {
+    
+    //a diamond 0 -> (1, 2) -> 3 followed by the chain 3 -> 4 -> 5, and the independent chain 6 -> 7. 
+    //Only 3, 5 and 7 are given to the flow, the others are inputs only.
+    std::atomic<int> counter(0);
+    std::vector<std::shared_ptr<OrderedCalculatable>> calcs;
+    for(int i=0; i<8; ++i)
+        calcs.push_back(std::make_shared<OrderedCalculatable>(&counter));
+    
+    const int inputs[][2] = {{1,0}, {2,0}, {3,1}, {3,2}, {4,3}, {5,4}, {7,6}};
+    for(auto& input : inputs)
+        calcs[input[0]]->in.push_back(calcs[input[1]].get());
+    
+    std::vector<std::shared_ptr<numeric::Calculatable<K>>> roots = {calcs[3], calcs[5], calcs[7]};
+    shedule::FlowGraph flow;
+    BOOST_CHECK_EQUAL(numeric::buildRecalculationFlow(roots, flow), 8);
+    
+    //0, 1, 2, 3 with 4 and 5, 6 with 7
+    BOOST_CHECK_EQUAL(flow.size(), 5);
+    
+    for(int run=1; run<4; ++run) {
+        flow.execute();
+        for(auto& calc : calcs) {
+            BOOST_CHECK_EQUAL(calc->executions, run);
+            BOOST_CHECK(calc->inputsDone);
+        }
+    }
+    
+    //owned inputs are not executed by their users anymore
+    auto fixed = std::make_shared<numeric::Equation<K, double>>(2.);
+    auto square = numeric::makeUnaryEquation<K, double, double>(fixed, 
+        [](const double& in, double& out) {out = in*in;},
+        [](const double& in, const double& din, double& out) {out = 2*in*din;});
+    BOOST_CHECK(square->hasInputOwnership());
+    
+    shedule::FlowGraph equationFlow;
+    BOOST_CHECK_EQUAL(numeric::buildRecalculationFlow<K>({square}, equationFlow), 2);
+    BOOST_CHECK(!square->hasInputOwnership());
+    equationFlow.execute();
+    BOOST_CHECK_CLOSE(square->output(), 4., 1e-10);
+}
+
+struct IncrementalFinal {
+    typedef K Kernel;
+};
+
+BOOST_AUTO_TEST_CASE(incremental_solve) {
+    
+    std::shared_ptr<Graph> g = std::make_shared<Graph>();
+    
+    //three components: a chain 0-1-2 and the single edges 3-4 and 5-6
+    std::vector<graph::LocalVertex> v;
+    for(int i=0; i<8; ++i) 
+        v.push_back(fusion::at_c<0>(g->addVertex()));
+    
+    std::vector<graph::LocalEdge> edges;
+    edges.push_back(fusion::at_c<0>(g->addEdge(v[0], v[1])));
+    edges.push_back(fusion::at_c<0>(g->addEdge(v[1], v[2])));
+    edges.push_back(fusion::at_c<0>(g->addEdge(v[3], v[4])));
+    edges.push_back(fusion::at_c<0>(g->addEdge(v[5], v[6])));
+    for(std::size_t i=0; i<edges.size(); ++i)
+        g->setProperty<test_tracked>(edges[i], i);
+    
+    TestReducer reducer;
+    solver::IncrementalSystem<IncrementalFinal, Graph> system;
+    auto update = [&]() {
+        std::unique_ptr<shedule::Executable> ex(system.update(g, reducer));
+        ex->execute();
+    };
+    
+    //vertex 7 has no edge and forms its own component
+    update();
+    BOOST_CHECK_EQUAL(system.componentCount(), 4);
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 4);
+    
+    //nothing changed, nothing to rebuild
+    update();
+    BOOST_CHECK_EQUAL(system.componentCount(), 4);
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 4);
+    
+    //a changed edge only rebuilds its own component
+    g->setProperty<test_tracked>(edges[2], 10);
+    update();
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 5);
+    
+    //connecting two components rebuilds the merged one only
+    g->setProperty<test_tracked>(fusion::at_c<0>(g->addEdge(v[6], v[7])), 11);
+    update();
+    BOOST_CHECK_EQUAL(system.componentCount(), 3);
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 6);
+}
+
+BOOST_AUTO_TEST_CASE(incremental_rigid) {
+    
+    std::shared_ptr<TrackedGraph> g = std::make_shared<TrackedGraph>();
+    
+    //a rigid triangle and a point loosely connected to it
+    std::vector<graph::LocalVertex> v;
+    for(int i=0; i<4; ++i) 
+        v.push_back(fusion::at_c<0>(g->addVertex()));
+    
+    auto connect = [&](int s, int t) {
+        g->setProperty<test_tracked>(fusion::at_c<0>(g->addEdge(v[s], v[t])), 1);
+    };
+    connect(0, 1);
+    connect(1, 2);
+    connect(0, 2);
+    connect(2, 3);
+    
+    //the changed vertex is moved into the subcluster during the update
+    g->setProperty<test_tracked>(v[0], 1);
+    
+    RigidReducer reducer;
+    solver::IncrementalSystem<IncrementalFinal, TrackedGraph> system;
+    auto update = [&]() {
+        std::unique_ptr<shedule::Executable> ex(system.update(g, reducer));
+        ex->execute();
+    };
+    
+    update();
+    BOOST_REQUIRE_EQUAL(g->numClusters(), 1);
+    BOOST_CHECK_EQUAL(g->vertexCount(), 2);
+    BOOST_CHECK_EQUAL(system.componentCount(), 1);
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 1);
+    
+    std::shared_ptr<TrackedGraph> sub = g->clusters().first->second;
+    auto vertices = sub->vertices();
+    for(; vertices.first != vertices.second; ++vertices.first)
+        BOOST_CHECK(!sub->hasPropertyChanges(*vertices.first));
+    
+    update();
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 1);
+    
+    //a change within the subcluster rebuilds the component of its cluster vertex
+    sub->setProperty<test_tracked>(*sub->vertices().first, 2);
+    update();
+    BOOST_CHECK_EQUAL(system.componentCount(), 1);
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(batch_solve) {
+    
+    //every built system gets its own value which is set per variant
+    std::mutex mutex;
+    std::map<solver::ComponentSystem<K>*, std::unique_ptr<double>> values;
+    std::atomic<int> built(0);
+    solver::BatchSolver<K> batch([&]() {
+        std::unique_ptr<double> value(new double(0));
+        auto component = offsetSystem(value.get());
+        std::lock_guard<std::mutex> lock(mutex);
+        values[component.get()] = std::move(value);
+        ++built;
+        return component;
+    }, 4);
+    
+    auto valueOf = [&](solver::ComponentSystem<K>& component) -> double& {
+        std::lock_guard<std::mutex> lock(mutex);
+        return *values[&component];
+    };
+    
+    //a system must never be used by two variants at the same time
+    std::set<solver::ComponentSystem<K>*> busy;
+    std::atomic<int> reused(0);
+    
+    const int variants = 200;
+    std::vector<double> solutions(variants, 0);
+    auto solve = [&]() {
+        return batch.solve(variants, 
+            [&](solver::ComponentSystem<K>& c, int i) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(!busy.insert(&c).second)
+                        ++reused;
+                }
+                valueOf(c) = i;
+            },
+            [&](solver::ComponentSystem<K>& c, int i) {
+                solutions[i] = c.system().parameter()(0);
+                std::lock_guard<std::mutex> lock(mutex);
+                busy.erase(&c);
+            });
+    };
+    
+    std::vector<int> results = solve();
+    BOOST_CHECK_EQUAL(reused, 0);
+    for(int i=0; i<variants; ++i) {
+        BOOST_CHECK_EQUAL(results[i], 1);
+        BOOST_CHECK_CLOSE(solutions[i], i+1, 1e-8);
+    }
+    
+    //systems are build at most once per thread of the arena and the sparsity analysis is shared by all 
+    //variants solved in them
+    BOOST_CHECK(batch.systemCount() >= 1);
+    BOOST_CHECK(batch.systemCount() <= 4);
+    BOOST_CHECK_EQUAL(built, batch.systemCount());
+    batch.forEachSystem([](solver::ComponentSystem<K>& c) {
+        BOOST_CHECK_EQUAL(c.solver().m_normal.analyzeCount(), 1);
+    });
+    
+    //further batches reuse the systems
+    solve();
+    BOOST_CHECK_EQUAL(built, batch.systemCount());
+    BOOST_CHECK_CLOSE(solutions[variants-1], variants, 1e-8);
+}
+
+//points with distance constraints, solved with the real equations created by the reduction
+struct PointFinal {
+    
+    typedef K Kernel;
+    typedef mpl::vector1<geometry::Point3<K>> GeometryList;
+    typedef mpl::vector1<Distance>            ConstraintList;
+    
+    template<typename G>
+    struct geometryIndex : mpl::find<GeometryList, G>::type::pos {};
+};
+
+typedef graph::ClusterGraph<mpl::vector1<symbolic::ResultProperty>, mpl::vector1<symbolic::ConstraintProperty>,
+        mpl::vector1<symbolic::GeometryProperty>, mpl::vector0<>> EquationGraph;
+
+struct PointGraph {
+    
+    std::shared_ptr<EquationGraph>                           graph = std::make_shared<EquationGraph>();
+    std::deque<symbolic::TypeGeometry<K, geometry::Point3>>  points;
+    std::deque<symbolic::TypeConstraint<Distance>>           distances;
+    std::vector<graph::LocalVertex>                          vertices;
+    std::vector<graph::GlobalEdge>                           constraints;
+    
+    void addPoint(double x, double y, double z) {
+        points.emplace_back();
+        points.back().setGeometryID(0);
+        points.back().getPrimitveGeometry().point() = Eigen::Vector3d(x, y, z);
+        vertices.push_back(fusion::at_c<0>(graph->addVertex()));
+        graph->setProperty<symbolic::GeometryProperty>(vertices.back(), &points.back());
+    };
+    
+    void addDistance(int p1, int p2, double d) {
+        distances.emplace_back();
+        distances.back().setConstraintID(0);
+        distances.back().getPrimitveConstraint().distance() = d;
+        auto edge = graph->addEdge(vertices[p1], vertices[p2]);
+        constraints.push_back(fusion::at_c<1>(edge));
+        graph->setProperty<symbolic::ConstraintProperty>(constraints.back(), &distances.back());
+    };
+    
+    //changes the value of the given distance and marks its edge as changed
+    void setDistance(int c, double d) {
+        distances[c].getPrimitveConstraint().distance() = d;
+        graph->setProperty<symbolic::ConstraintProperty>(constraints[c], &distances[c]);
+    };
+    
+    Eigen::Vector3d point(int p) {
+        return points[p].getPrimitveGeometry().point();
+    };
+    
+    double distance(int p1, int p2) {
+        return (point(p1) - point(p2)).norm();
+    };
+};
+
+BOOST_AUTO_TEST_CASE(solve_components) {
+    
+    //a triangle and a single distance form two components
+    PointGraph g;
+    g.addPoint(0, 0, 0);
+    g.addPoint(1, 0, 0);
+    g.addPoint(0, 1, 0);
+    g.addPoint(0, 0, 5);
+    g.addPoint(1, 1, 5);
+    g.addDistance(0, 1, 2);
+    g.addDistance(1, 2, 2);
+    g.addDistance(2, 0, 2);
+    g.addDistance(3, 4, 3);
+    
+    symbolic::Reducer<PointFinal> reducer;
+    std::unique_ptr<shedule::Executable> ex(solver::createSolvableSystem<PointFinal>(g.graph, reducer));
+    ex->execute();
+    
+    //the solved values are written back to the symbolic geometries
+    BOOST_CHECK_CLOSE(g.distance(0, 1), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(1, 2), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(2, 0), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(3, 4), 3, 1e-6);
+    
+    //the numeric geometries outlive the systems, they must keep their values
+    ex.reset();
+    auto walker = std::static_pointer_cast<symbolic::reduction::EquationWalker<K>>(
+                    g.graph->getProperty<symbolic::ResultProperty>(*g.graph->edges().first));
+    BOOST_REQUIRE(walker);
+    BOOST_CHECK_EQUAL(walker->getResiduals().size(), 1);
+    auto numeric = std::static_pointer_cast<numeric::Geometry<K, geometry::Point3>>(
+                    walker->getVertexGeometry(&g.points[0]).geometry);
+    BOOST_CHECK(numeric->output().point().isApprox(g.point(0)));
+}
+
+BOOST_AUTO_TEST_CASE(solve_blocks) {
+    
+    //a triangle with a chain attached to one of its points
+    PointGraph g;
+    g.addPoint(0, 0, 0);
+    g.addPoint(1, 0, 0);
+    g.addPoint(0, 1, 0);
+    g.addPoint(0, 2, 0);
+    g.addPoint(0, 3, 1);
+    g.addDistance(0, 1, 2);
+    g.addDistance(1, 2, 2);
+    g.addDistance(2, 0, 2);
+    g.addDistance(2, 3, 3);
+    g.addDistance(3, 4, 1);
+    
+    symbolic::Reducer<PointFinal> reducer;
+    BOOST_REQUIRE_EQUAL(symbolic::reduceGraph(g.graph, reducer), 1);
+    solver::ComponentSystem<K> component;
+    solver::buildGraphNumericSystem(graph::make_filter_graph(g.graph, 0), component);
+    
+    //the chain is peeled of, every leaf only holds the point it adds, the one it hangs off is fixed
+    BOOST_REQUIRE_EQUAL(component.leafCount(), 2);
+    BOOST_CHECK_EQUAL(component.system().parameterCount(), 9);
+    BOOST_CHECK_EQUAL(component.system().equationCount(), 3);
+    for(int i=0; i<component.leafCount(); ++i) {
+        BOOST_CHECK_EQUAL(component.leaf(i).system().parameterCount(), 3);
+        BOOST_CHECK_EQUAL(component.leaf(i).system().equationCount(), 1);
+        BOOST_CHECK(!component.leaf(i).system().isSparse());
+    }
+    
+    //the leafs are only solved for the final position of the point they hang off if they are solved 
+    //after the system it belongs to
+    component.execute();
+    BOOST_CHECK_EQUAL(component.result(), 1);
+    BOOST_CHECK_CLOSE(g.distance(0, 1), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(1, 2), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(2, 0), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(2, 3), 3, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(3, 4), 1, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(solve_leafs) {
+    
+    //two equilateral triangles form the root block, a triangle at one of their points is an additional
+    //block and a chain hangs off that triangle
+    PointGraph g;
+    g.addPoint(0, 0, 0);
+    g.addPoint(1, -1, 0);
+    g.addPoint(1.5, 0.5, 0);
+    g.addPoint(0.2, 1.2, 0);
+    g.addPoint(2, 2, 0);
+    g.addPoint(2.5, 0, 0.3);
+    g.addPoint(3, 0, 0);
+    g.addPoint(4, 0.5, 0);
+    g.addDistance(0, 1, 2);
+    g.addDistance(1, 2, 2);
+    g.addDistance(2, 3, 2);
+    g.addDistance(3, 0, 2);
+    g.addDistance(0, 2, 2);
+    g.addDistance(2, 4, 2);
+    g.addDistance(4, 5, 2);
+    g.addDistance(5, 2, 2);
+    g.addDistance(5, 6, 1);
+    g.addDistance(6, 7, 1);
+    
+    symbolic::Reducer<PointFinal> reducer;
+    BOOST_REQUIRE_EQUAL(symbolic::reduceGraph(g.graph, reducer), 1);
+    solver::ComponentSystem<K> component;
+    solver::buildGraphNumericSystem(graph::make_filter_graph(g.graph, 0), component);
+    
+    //the block comes first, the peeled chain after it
+    BOOST_REQUIRE_EQUAL(component.leafCount(), 3);
+    BOOST_CHECK_EQUAL(component.system().parameterCount(), 12);
+    BOOST_CHECK_EQUAL(component.system().equationCount(), 5);
+    BOOST_CHECK_EQUAL(component.leaf(0).system().parameterCount(), 6);
+    BOOST_CHECK_EQUAL(component.leaf(0).system().equationCount(), 3);
+    for(int i=1; i<3; ++i) {
+        BOOST_CHECK_EQUAL(component.leaf(i).system().parameterCount(), 3);
+        BOOST_CHECK_EQUAL(component.leaf(i).system().equationCount(), 1);
+    }
+    
+    //every system is solved after the one holding the geometry it depends on
+    std::vector<int> order;
+    component.addResultWriter([&]() {order.push_back(-1);});
+    for(int i=0; i<3; ++i)
+        component.leaf(i).addResultWriter([&order, i]() {order.push_back(i);});
+    
+    component.execute();
+    BOOST_CHECK((order == std::vector<int>{-1, 0, 1, 2}));
+    BOOST_CHECK_EQUAL(component.result(), 1);
+    for(int i=0; i<3; ++i)
+        BOOST_CHECK_EQUAL(component.leaf(i).result(), 1);
+    
+    BOOST_CHECK_CLOSE(g.distance(0, 1), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(1, 2), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(2, 3), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(3, 0), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(0, 2), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(2, 4), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(4, 5), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(5, 2), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(5, 6), 1, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(6, 7), 1, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(incremental_equations) {
+    
+    //two triangles form two components
+    PointGraph g;
+    g.addPoint(0, 0, 0);
+    g.addPoint(1, 0, 0);
+    g.addPoint(0, 1, 0);
+    g.addPoint(0, 0, 5);
+    g.addPoint(1, 0, 5);
+    g.addPoint(0, 1, 5);
+    g.addDistance(0, 1, 2);
+    g.addDistance(1, 2, 2);
+    g.addDistance(2, 0, 2);
+    g.addDistance(3, 4, 3);
+    g.addDistance(4, 5, 3);
+    g.addDistance(5, 3, 3);
+    
+    symbolic::Reducer<PointFinal> reducer;
+    solver::IncrementalSystem<PointFinal, EquationGraph> system;
+    auto update = [&]() {
+        std::unique_ptr<shedule::Executable> ex(system.update(g.graph, reducer));
+        ex->execute();
+    };
+    
+    update();
+    BOOST_CHECK_EQUAL(system.componentCount(), 2);
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 2);
+    for(int i=0; i<3; ++i) {
+        BOOST_CHECK_CLOSE(g.distance(i, (i+1)%3), 2, 1e-6);
+        BOOST_CHECK_CLOSE(g.distance(3+i, 3+(i+1)%3), 3, 1e-6);
+    }
+    
+    std::vector<Eigen::Vector3d> solved;
+    for(int i=3; i<6; ++i)
+        solved.push_back(g.point(i));
+    
+    //only the changed triangle is rebuilt and solved, the other one keeps its solution
+    g.setDistance(0, 4);
+    update();
+    BOOST_CHECK_EQUAL(system.componentCount(), 2);
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 3);
+    BOOST_CHECK_CLOSE(g.distance(0, 1), 4, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(1, 2), 2, 1e-6);
+    BOOST_CHECK_CLOSE(g.distance(2, 0), 2, 1e-6);
+    for(int i=3; i<6; ++i)
+        BOOST_CHECK(g.point(i) == solved[i-3]);
+    
+    //the old system of the changed component is dropped after the new one took over its geometries
+    g.setDistance(0, 3);
+    update();
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 4);
+    BOOST_CHECK_CLOSE(g.distance(0, 1), 3, 1e-6);
+    for(int i=3; i<6; ++i)
+        BOOST_CHECK(g.point(i) == solved[i-3]);
+}
+
+BOOST_AUTO_TEST_CASE(incremental_reload) {
+    
+    //a triangle with a point hanging off it
+    PointGraph g;
+    g.addPoint(0, 0, 0);
+    g.addPoint(1, 0, 0);
+    g.addPoint(0, 1, 0);
+    g.addPoint(0, 2, 1);
+    g.addDistance(0, 1, 2);
+    g.addDistance(1, 2, 2);
+    g.addDistance(2, 0, 2);
+    g.addDistance(2, 3, 3);
+    
+    symbolic::Reducer<PointFinal> reducer;
+    solver::IncrementalSystem<PointFinal, EquationGraph> system;
+    std::unique_ptr<shedule::Executable>(system.update(g.graph, reducer))->execute();
+    
+    //values changed without marking the graph are loaded into the existing systems, the core and the leaf
+    for(int i=1; i<10; ++i) {
+        
+        for(int c=0; c<3; ++c)
+            g.distances[c].getPrimitveConstraint().distance() = 2 + 0.5*i;
+        g.distances[3].getPrimitveConstraint().distance() = 3 + i;
+        
+        std::unique_ptr<shedule::Executable>(system.reload())->execute();
+        BOOST_CHECK_CLOSE(g.distance(0, 1), 2 + 0.5*i, 1e-6);
+        BOOST_CHECK_CLOSE(g.distance(1, 2), 2 + 0.5*i, 1e-6);
+        BOOST_CHECK_CLOSE(g.distance(2, 0), 2 + 0.5*i, 1e-6);
+        BOOST_CHECK_CLOSE(g.distance(2, 3), 3 + i, 1e-6);
+    }
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 1);
+    
+    //geometry values are loaded as start values, the hanging point is only moved towards its parent
+    const Eigen::Vector3d parent = g.point(2), start(5, 5, 5);
+    g.points[3].getPrimitveGeometry().point() = start;
+    std::unique_ptr<shedule::Executable>(system.reload())->execute();
+    BOOST_CHECK_CLOSE(g.distance(2, 3), 12, 1e-6);
+    BOOST_CHECK((g.point(3) - parent).normalized().isApprox((start - parent).normalized(), 1e-6));
+    BOOST_CHECK_EQUAL(system.rebuildCount(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END();